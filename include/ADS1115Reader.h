@@ -3,18 +3,78 @@
 #include <Arduino.h>
 #include <Adafruit_ADS1X15.h>
 
+// ADS1115 4-channel I2C ADC.
+//
+// Acquisition is a state machine driven by poll() from the I2cBus task: once the conversion
+// in flight has had its data-rate time, read it, publish it, start the next channel, return.
+// Nothing waits on a conversion. Each sample costs one config write and one result read.
+//
+// Sampling plan: a channel joins the rotation the first time it is read, or when it is given
+// a period. The next conversion goes to the most overdue channel; period 0 = every turn.
+//
+// readMillivolts() returns the latest published sample — 0 until the first one lands.
+// Each channel's sample is published under a sequence count (seqlock, like the CrankSensor
+// angle snapshot): readers on any task retry until they copy it between two equal even
+// counts, so they never see a half-written sample however long they are preempted, and
+// never touch the bus.
 class ADS1115Reader {
-    static constexpr uint32_t ADS_READ_TIMEOUT_MS = 10;  // Max wait for conversion
-
 public:
+    static const uint8_t NO_CHANNEL = 0xFF;
+
+    struct Sample {
+        int16_t raw;
+        int64_t timeUs;     // esp_timer time the conversion was started
+    };
+
     ADS1115Reader();
     bool begin(uint8_t addr = 0x48, adsGain_t gain = GAIN_ONE,
                uint16_t rate = RATE_ADS1115_128SPS);
-    int16_t readChannel(uint8_t ch);
-    float readMillivolts(uint8_t ch);
+    void setSamplePeriodMs(uint8_t ch, uint16_t ms);    // Plan: sample ch at most this often, joins the rotation
+
+    // Bus side — I2cBus task only
+    bool poll();                                // false = I2C error
+    void abort() { _busyCh = NO_CHANNEL; }      // Conversion in flight lost (bus recovery)
+    uint8_t getErrorRun() const { return _errorRun; }
+
+    // Reader side — any task, never touches the bus
+    float readMillivolts(uint8_t ch);           // Latest sample; adds the channel to the rotation
+    bool getSample(uint8_t ch, Sample& out) const;  // Latest sample without joining the rotation
+    // Waits (vTaskDelay) for a sample converted after sinceUs, e.g. after a CJ125 calibrate
+    // command. 0 on timeout. Not for the update loop.
+    float readMillivoltsAfter(uint8_t ch, int64_t sinceUs, uint32_t timeoutMs);
+    float toMillivolts(int16_t raw) { return _ads.computeVolts(raw) * 1000.0f; }
     bool isReady() const { return _ready; }
 
+    // Stats
+    uint32_t getConversionCount() const { return _conversions; }
+    uint32_t getErrorCount() const { return _errors; }      // I2C NAK / short read in poll()
+
 private:
     Adafruit_ADS1115 _ads;
+    uint8_t _addr;
+    uint16_t _configBase;           // Gain | rate | single-shot | comparator off, OR'd with MUX + OS
+    uint32_t _convUs;               // Conversion time at the data rate, with oscillator margin
     bool _ready;
+
+    volatile uint8_t _used;         // Channels in the rotation — readers add theirs with __atomic_fetch_or
+    uint32_t _periodUs[4];          // Sampling plan, 0 = every turn
+    int64_t _lastStartUs[4];
+    uint8_t _busyCh;                // Conversion in flight, NO_CHANNEL if none
+    int64_t _startUs;
+    uint8_t _errorRun;              // Consecutive failed polls
+
+    Sample _samples[4];             // Latest sample per channel
+    volatile uint32_t _seq[4];      // Odd while publish() is writing _samples[ch]
+    // Publish inside a critical section: the bus task can't be preempted with a count odd,
+    // so a reader on the same core never spins on a half-finished write
+    portMUX_TYPE _publishLock = portMUX_INITIALIZER_UNLOCKED;
+    volatile bool _hasSample[4];
+
+    volatile uint32_t _conversions;
+    volatile uint32_t _errors;
+
+    uint8_t nextChannel(int64_t nowUs) const;
+    bool startConversion(uint8_t ch);
+    bool readRegister(uint8_t reg, uint16_t& val);
+    void publish(uint8_t ch, int16_t raw, int64_t timeUs);
 };
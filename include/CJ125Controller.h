@@ -2,6 +2,7 @@
 
 #include <Arduino.h>
 #include <SPI.h>
+#include "PinExpander.h"
 
 class ADS1115Reader;
 
@@ -75,6 +76,7 @@ private:
         uint16_t uaValue = 0;      // Current UA ADC (10-bit equiv)
         uint16_t diagStatus = 0;
         uint16_t spiSS = 0;        // Chip select pin (MCP23S17)
+        PinHandle ss;              // spiSS resolved at begin()
         uint8_t heaterPin = 0;     // LEDC PWM output
         uint8_t ledcChannel = 0;   // LEDC channel number
         uint8_t uaPin = 0;         // ADC input
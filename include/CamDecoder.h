@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Cam wheel types (ProjectInfo::camType)
+enum CamType : uint8_t {
+    CAM_SINGLE   = 0,   // One pulse per cycle
+    CAM_4_PLUS_1 = 1,   // 4 even teeth (every 180 crank deg) + 1 extra sync tooth (Honda K-style)
+    CAM_3_TOOTH  = 2    // 3 unevenly spaced teeth — every gap is distinct
+};
+
+// Multi-tooth cam decoder. A pattern is a table of tooth angles; the decoder identifies
+// each edge by the ratio of its period to the previous one, so it syncs from cam edges
+// alone — at the first tooth whose ratio no other tooth can produce. Once synced, each
+// edge only has to match the next expected tooth: one division and one range check.
+//
+// Tooth angles are engine-cycle crank degrees ATDC #1 compression at zero cam advance.
+class CamDecoder {
+public:
+    static const uint8_t MAX_TEETH = 8;
+    static const uint16_t ANGLE_UNITS_PER_DEG = 32;    // Same fixed point as CrankSensor
+    static const uint16_t ANGLE_UNITS_PER_CYCLE = 720 * ANGLE_UNITS_PER_DEG;
+
+    static CamDecoder* create(uint8_t type);
+
+    CamDecoder(const char* name, const uint16_t* toothDeg, uint8_t count);
+
+    // Hot path (cam ISR). periodUs = time since the previous cam edge (0 = none / timed out).
+    // Returns the tooth index, or -1 while not synced.
+    int8_t IRAM_ATTR onEdge(uint32_t periodUs);
+
+    void reset() { _synced = false; _prevPeriodUs = 0; }
+
+    const char* name() const { return _name; }
+    bool isSynced() const { return _synced; }
+    uint8_t getToothCount() const { return _count; }
+    uint16_t getToothAngleUnits(uint8_t idx) const { return _toothUnits[idx]; }
+    uint32_t getSyncLossCount() const { return _syncLosses; }
+
+private:
+    // Ratio of a tooth's period to the one before, Q8. Window is +/-20% of nominal.
+    static const uint8_t RATIO_SHIFT = 8;
+
+    const char* _name;
+    uint8_t _count;
+    uint16_t _toothUnits[MAX_TEETH];
+    uint32_t _ratioLo[MAX_TEETH];
+    uint32_t _ratioHi[MAX_TEETH];
+    bool _unique[MAX_TEETH];            // Ratio window overlaps no other tooth — usable to sync
+
+    volatile bool _synced;
+    volatile uint8_t _tooth;
+    uint32_t _prevPeriodUs;
+    volatile uint32_t _syncLosses;
+};
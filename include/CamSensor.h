@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Arduino.h>
+#include "CamDecoder.h"
 
 class CrankSensor;
 
@@ -13,24 +14,39 @@ public:
     CamSensor();
     ~CamSensor();
 
-    void begin(uint8_t pin);
+    // offsetDeg: installed cam position, added to the pattern's nominal tooth angles
+    void begin(uint8_t pin, uint8_t camType = CAM_SINGLE, float offsetDeg = 0.0f);
     void setCrankSensor(CrankSensor* crank) { _crankSensor = crank; }
 
     bool isPresent() const;
     bool hasCamSignal() const;
     Phase getPhase() const { return _phase; }
     uint16_t getLastPulseToothPosition() const { return _lastPulseToothPos; }
+    uint16_t getLastPulseAngle() const { return _lastPulseAngle; }  // CrankSensor ANGLE_UNITS
+
+    // Multi-tooth pattern decoding and cam position
+    const CamDecoder* getDecoder() const { return _decoder; }
+    bool isSynced() const { return _decoder->isSynced(); }
+    int8_t getLastTooth() const { return _lastTooth; }
+    // Measured cam angle minus nominal, from the last identified tooth (+ = advanced)
+    float getVvtAngleDeg() const { return _vvtUnits / (float)CamDecoder::ANGLE_UNITS_PER_DEG; }
 
     void update();
 
 private:
     uint8_t _pin;
     CrankSensor* _crankSensor;
+    CamDecoder* _decoder;
+    uint16_t _offsetUnits;
     volatile Phase _phase;
     volatile uint16_t _lastPulseToothPos;
+    volatile uint16_t _lastPulseAngle;
     volatile int64_t _lastPulseTimeUs;
-    volatile bool _pulseReceived;
+    volatile int8_t _lastTooth;
+    volatile int16_t _vvtUnits;
 
     static CamSensor* _instance;
     static void IRAM_ATTR isrHandler();
+    float configure(uint8_t camType, float offsetDeg);    // Decoder + state, no ISR. Returns wrapped offset.
+    void IRAM_ATTR processEdge(int64_t nowUs);
 };
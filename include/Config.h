@@ -147,6 +147,19 @@ struct ProjectInfo {
     // CLT-dependent rev limit (6-point curve)
     float cltRevLimitAxis[6];       // CLT in F
     float cltRevLimitValues[6];     // RPM limits
+    // Trigger wheel
+    uint8_t triggerType;            // TriggerType: 0=N-M missing tooth, 1=4+1, 2=GM 24x, 3=Ford EDIS (default 0)
+    uint8_t camType;                // CamType: 0=single pulse, 1=4+1, 2=3-tooth (default 0)
+    float camOffsetDeg;             // Installed cam position added to the pattern angles (default 0.0)
+    uint8_t triggerBlankPct;        // Crank noise blanking, % of the predicted tooth period (default 25)
+
+    // MCP3204 SPI ADC
+    uint8_t mcp3204Oversample;      // Conversions averaged per channel per burst, 1-16 (default 4)
+
+    // Crank-synchronous MAP (MCP3204 MAP only)
+    uint8_t mapSyncSamples;         // Samples per cylinder-event window, 0 = off (default 4, max 8)
+    float mapSyncStartDeg;          // Window start after each cylinder's TDC (default 0)
+    float mapSyncWindowDeg;         // Window width, 0 = the whole event spacing (default 0)
 };
 
 class Config {
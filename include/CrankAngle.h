@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+// Fixed-point crank angle for the real-time path: 1/32 deg units in a uint16, one 720 deg
+// engine cycle = 23040 units. Add/subtract wrap modulo the cycle with a compare and one
+// add/subtract — no FPU, no fmodf, safe from ISR or timer-callback context.
+//
+// A 360 deg cycle (wasted spark / batch, phase unknown) uses the *In(cycleUnits) forms.
+// Degree conversion is for setup, config and display only.
+//
+// No Arduino/IDF dependency, like EventScheduler, so it builds on a host.
+struct CrankAngle {
+    static const uint16_t UNITS_PER_DEG = 32;
+    static const uint16_t UNITS_PER_REV = 360 * UNITS_PER_DEG;     // 11520
+    static const uint16_t UNITS_PER_CYCLE = 720 * UNITS_PER_DEG;   // 23040
+
+    uint16_t units;
+
+    CrankAngle() : units(0) {}
+    explicit CrankAngle(uint16_t u) : units(u) {}
+
+    // Any signed unit count into [0, cycleUnits)
+    static CrankAngle wrap(int32_t u, uint16_t cycleUnits = UNITS_PER_CYCLE) {
+        int32_t r = u % (int32_t)cycleUnits;
+        return CrankAngle((uint16_t)(r < 0 ? r + cycleUnits : r));
+    }
+    static CrankAngle fromDeg(float deg, uint16_t cycleUnits = UNITS_PER_CYCLE) {
+        return wrap((int32_t)(deg * UNITS_PER_DEG + (deg < 0 ? -0.5f : 0.5f)), cycleUnits);
+    }
+    float toDeg() const { return units / (float)UNITS_PER_DEG; }
+
+    // Time to travel this angle at usPerUnit (Q RATE_SHIFT)
+    static const uint8_t RATE_SHIFT = 12;
+    uint32_t travelUs(uint32_t usPerUnitQ) const {
+        return (uint32_t)(((uint64_t)units * usPerUnitQ + (1u << (RATE_SHIFT - 1))) >> RATE_SHIFT);
+    }
+
+    // Both operands already in [0, cycleUnits)
+    CrankAngle addIn(CrankAngle o, uint16_t cycleUnits) const {
+        uint32_t s = (uint32_t)units + o.units;
+        return CrankAngle((uint16_t)(s >= cycleUnits ? s - cycleUnits : s));
+    }
+    // Distance from 'from' forward to this angle, [0, cycleUnits)
+    CrankAngle subIn(CrankAngle from, uint16_t cycleUnits) const {
+        return CrankAngle((uint16_t)(units >= from.units ? units - from.units : units + cycleUnits - from.units));
+    }
+
+    CrankAngle operator+(CrankAngle o) const { return addIn(o, UNITS_PER_CYCLE); }
+    CrankAngle operator-(CrankAngle o) const { return subIn(o, UNITS_PER_CYCLE); }
+    bool operator==(CrankAngle o) const { return units == o.units; }
+    bool operator!=(CrankAngle o) const { return units != o.units; }
+    bool operator<(CrankAngle o) const { return units < o.units; }
+    bool operator<=(CrankAngle o) const { return units <= o.units; }
+    bool operator>(CrankAngle o) const { return units > o.units; }
+    bool operator>=(CrankAngle o) const { return units >= o.units; }
+};
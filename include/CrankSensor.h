@@ -1,62 +1,157 @@
 #pragma once
 
 #include <Arduino.h>
+#include "TriggerDecoder.h"
+#include "CrankAngle.h"
 
 class CrankSensor {
 public:
-    enum SyncState { LOST, SYNCING, SYNCED };
+    typedef TriggerDecoder::SyncState SyncState;
 
-    static const uint8_t TOOTH_HISTORY_SIZE = 8;
-    static const uint16_t TOOTH_LOG_SIZE = 720;
+    static const uint8_t TOOTH_HISTORY_SIZE = 8;      // Power of two — index wraps with a mask
+    static const uint8_t TOOTH_HISTORY_SHIFT = 3;
 
-    struct ToothLogEntry {
-        uint32_t periodUs;
-        uint8_t toothNum;
-    };
+    // Fixed-point crank angle (CrankAngle units): 1/32 deg, one revolution = 11520
+    static const uint16_t ANGLE_UNITS_PER_DEG = CrankAngle::UNITS_PER_DEG;
+    static const uint16_t ANGLE_UNITS_PER_REV = CrankAngle::UNITS_PER_REV;
+
+    // Stall: no tooth within STALL_PERIOD_MULTIPLE x the expected time to the next one
+    static const uint8_t STALL_PERIOD_MULTIPLE = 3;
+    static const uint32_t STALL_MIN_US = 2000;
+    static const uint32_t STALL_MAX_US = 500000;    // Before a period estimate exists / slowest crank
+
+    // Noise blanking: an edge sooner than this fraction of the predicted tooth period after
+    // the last tooth is rejected before it reaches the decoder or the period history
+    static const uint8_t DEFAULT_BLANK_PCT = 25;
+    static const uint32_t BLANK_MIN_US = 50;        // Floor, and the whole window before a period estimate
 
     CrankSensor();
     ~CrankSensor();
 
-    void begin(uint8_t pin, uint8_t teeth, uint8_t missing);
+    void begin(uint8_t pin, uint8_t triggerType, uint8_t teeth, uint8_t missing);
 
     uint16_t getRpm() const { return _rpm; }
     uint16_t getToothPosition() const { return _toothPosition; }
     SyncState getSyncState() const { return _syncState; }
-    bool isSynced() const { return _syncState == SYNCED; }
+    bool isSynced() const { return _syncState == TriggerDecoder::SYNCED; }
+    bool isPositionKnown() const { return _positionKnown; }  // Provisional sync at the first gap is enough to fire
     int64_t getLastToothTimeUs() const { return _lastToothTimeUs; }
-    uint8_t getTotalTeeth() const { return _totalTeeth; }
+    uint32_t getToothPeriodUs() const { return _toothPeriodUs; }
+    uint32_t getPredictedPeriodUs() const { return _predictedPeriodUs; }  // Expected next regular tooth period
+    int32_t getPeriodDeltaUs() const { return _periodDeltaQ4 >> 4; }      // Smoothed change per tooth (<0 = accelerating)
+
+    // Wheel geometry — shared angle base for ignition, injection and cam phase
+    const TriggerDecoder* getDecoder() const { return _decoder; }
+    const TriggerDecoder::Geometry& getGeometry() const { return _decoder->geometry(); }
+    uint8_t getTotalTeeth() const { return _decoder->geometry().teeth; }
+    float getDegreesPerTooth() const { return _decoder->geometry().degPerTooth; }
+    float getTdcOffsetDeg() const { return _decoder->geometry().tdcOffsetDeg; }
+    float getToothAngleDeg(uint16_t pos) const { return _decoder->toothAngleDeg(pos); }
+
+    // Sub-tooth crank angle ATDC #1 in ANGLE_UNITS, extrapolated from the last tooth with
+    // the predicted period and its rate of change. Never runs past the next expected tooth.
+    uint16_t getCrankAngleNow() const { return getCrankAngleAt(esp_timer_get_time()); }
+    uint16_t IRAM_ATTR getCrankAngleAt(int64_t nowUs) const;
+    // Predicted timestamp of the next time the crank reaches angle (ANGLE_UNITS ATDC #1).
+    // Returns 0 without a period estimate.
+    int64_t angleToTimestamp(uint16_t angle) const;
+
+    // Engine-cycle phase. The revolution flips each time the tooth angle wraps through
+    // TDC #1; a cam edge pins which revolution is 0-360 (compression TDC #1).
+    bool isPhaseKnown() const { return _phaseKnown; }
+    uint8_t getRevolution() const { return _revolution; }
+    void clearPhase() { _phaseKnown = false; }
+
+    // Consistent view of the last tooth for the real-time task, integer only. angle is the
+    // engine-cycle angle (0-720) once phase is known, crank angle (0-360) before.
+    // False without a period.
+    struct ToothReference {
+        int64_t timeUs;
+        uint16_t toothPos;
+        uint16_t cycleTooth;    // toothPos, + teeth in the second revolution of a 720 deg cycle
+        CrankAngle angle;
+        uint16_t cycleUnits;    // UNITS_PER_REV (wasted spark / batch) or UNITS_PER_CYCLE (sequential)
+        uint32_t usPerUnitQ;    // Predicted period per angle unit, Q CrankAngle::RATE_SHIFT
+        bool isSequential() const { return cycleUnits == CrankAngle::UNITS_PER_CYCLE; }
+    };
+    bool getToothReference(ToothReference& ref) const;
+
+    // Cam edge from CamSensor ISR. indexEdge (cam tooth 0) feeds cam-synced wheels (e.g. GM 24x).
+    // Returns the crank angle at the edge (ANGLE_UNITS).
+    uint16_t IRAM_ATTR onCamEdge(int64_t nowUs, bool indexEdge);
+    // Cam ISR: the edge at edgeAngle was in crank revolution edgeRevolution of the cycle
+    void IRAM_ATTR setCamPhase(uint16_t edgeAngle, uint8_t edgeRevolution);
+
+    // Blanking window as a percentage of the predicted tooth period, capped by the wheel pattern
+    void setNoiseBlanking(uint8_t pct);
+    uint8_t getNoiseBlankingPct() const { return _blankPct; }
+    uint32_t getRejectedEdgeCount() const { return _rejectedEdges; }
+
+    // Tooth-timeout stall detection on a dedicated hardware timer (after begin())
+    bool enableStallDetect(uint8_t timerNum);
+    uint32_t getStallCount() const { return _stallCount; }
 
-    // Tooth logging
-    void startToothLog();
-    void stopToothLog();
-    bool isToothLogComplete() const { return _toothLogComplete; }
-    bool isToothLogCapturing() const { return _toothLogCapturing; }
-    const volatile ToothLogEntry* getToothLog() const { return _toothLog; }
-    uint16_t getToothLogSize() const { return _toothLogIdx; }
+    // Real-time task notified (eSetBits) from the ISRs on every tooth and on a stall
+    void setNotifyTask(TaskHandle_t task, uint32_t toothBits, uint32_t stallBits) {
+        _notifyBits = toothBits;
+        _stallBits = stallBits;
+        _notifyTask = task;
+    }
 
 private:
     uint8_t _pin;
-    uint8_t _totalTeeth;
-    uint8_t _missingTeeth;
+    TriggerDecoder* _decoder;
     volatile uint16_t _rpm;
     volatile uint16_t _toothPosition;
     volatile SyncState _syncState;
     volatile int64_t _lastToothTimeUs;
+    volatile bool _positionKnown;
+    volatile bool _phaseKnown;
+    volatile uint8_t _revolution;       // 0 = first crank revolution of the cycle
+    uint16_t _wrapPos;                  // First tooth at or after TDC #1
 
     volatile uint32_t _toothPeriods[TOOTH_HISTORY_SIZE];
     volatile uint8_t _toothHistIdx;
     volatile uint32_t _lastPeriodUs;
-    volatile uint8_t _toothCount;
-    volatile bool _gapDetected;
+    volatile uint32_t _toothPeriodUs;   // Per-tooth period (gap period divided by missing+1)
+    volatile uint32_t _periodSum;       // Running sum of _toothPeriods
+    volatile uint8_t _histCount;        // Valid history entries (fills to TOOTH_HISTORY_SIZE)
+    volatile int32_t _periodDeltaQ4;    // First-order rate of change per tooth, 1/16 us
+    volatile uint32_t _predictedPeriodUs;
+    volatile uint32_t _snapSeq;         // Odd while the ISR is updating tooth state (angle snapshot)
+    uint16_t _tdcOffsetUnits;
+    uint32_t _unitScaleQ24;             // Teeth per angle unit, Q24: tooth period -> us per unit
+    uint8_t _blankPct;
+    uint8_t _blankQ8;                   // _blankPct as Q8, capped by the decoder
+    volatile uint32_t _rejectedEdges;
 
-    // Tooth log buffer (DRAM for ISR access)
-    volatile ToothLogEntry _toothLog[TOOTH_LOG_SIZE];
-    volatile uint16_t _toothLogIdx;
-    volatile bool _toothLogCapturing;
-    volatile bool _toothLogComplete;
+    volatile TaskHandle_t _notifyTask;
+    uint32_t _notifyBits;
+    uint32_t _stallBits;
+
+    hw_timer_t* _stallTimer;
+    uint32_t _stallAlarmUs;             // Current alarm value (only rewritten on >12.5% change)
+    volatile bool _stallArmed;
+    volatile uint32_t _stallCount;
 
     static CrankSensor* _instance;
     static void IRAM_ATTR isrHandler();
+    static void IRAM_ATTR stallIsr();
+    void configure(uint8_t triggerType, uint8_t teeth, uint8_t missing);   // Decoder + state, no ISR
+    void IRAM_ATTR armStallTimer(uint32_t timeoutUs);
+    void IRAM_ATTR handleStall();
+    void IRAM_ATTR resetTiming();
     void IRAM_ATTR processTooth(int64_t nowUs);
-    uint32_t averagePeriod() const;
+    void IRAM_ATTR updatePeriodModel(uint32_t toothPeriodUs);
+
+    struct AngleSnapshot {
+        int64_t toothTimeUs;
+        uint16_t toothPos;
+        uint32_t periodUs;
+        int32_t deltaQ4;
+        uint8_t revolution;
+        bool phaseKnown;
+    };
+    bool IRAM_ATTR snapshot(AngleSnapshot& s) const;
+    uint16_t IRAM_ATTR toothAngleUnits(uint16_t pos) const;
 };
@@ -1,6 +1,7 @@
 #pragma once
 #include <Arduino.h>
 #include <esp_timer.h>
+#include "PinExpander.h"
 
 class SensorManager;
 struct EngineState;
@@ -152,6 +153,8 @@ private:
     const EngineState* _engineState;
     esp_timer_handle_t _timers[MAX_CUSTOM_PINS];
     uint8_t _nextPwmChannel;
+    PinBatch* _batch;           // Set while update() evaluates rules
+    PinHandle _handles[MAX_CUSTOM_PINS];    // Digital pins resolved at initPin()
 
     void initPin(uint8_t slot);
     void deinitPin(uint8_t slot);
@@ -160,5 +163,7 @@ private:
     float interpolateCurve(const float* x, const float* y, uint8_t n, float input);
 
     static void IRAM_ATTR isrHandler(void* arg);
+    // Expander INT service task: pins with interrupt-on-change on that device
+    static void onExpanderInterrupt(void* arg, uint8_t index, uint16_t changed, uint16_t captured);
     static void timerCallback(void* arg);
 };
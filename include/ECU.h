@@ -17,6 +17,9 @@ class MCP3204Reader;
 class TransmissionManager;
 class TuneTable2D;
 class CustomPinManager;
+class EventScheduler;
+class HwTimerBackend;
+class MapSampler;
 struct ProjectInfo;
 
 struct EngineState {
@@ -78,8 +81,13 @@ public:
     ADS1115Reader* getADS1115_1() { return _ads1115_2; }
     MCP3204Reader* getMCP3204() { return _mcp3204; }
     CustomPinManager* getCustomPins() { return _customPins; }
+    EventScheduler* getScheduler() { return _scheduler; }
+    MapSampler* getMapSampler() { return _mapSampler; }
     uint32_t getUpdateTimeUs() const { return _updateTimeUs; }
     uint32_t getSensorTimeUs() const { return _sensorTimeUs; }
+    // CPU cycles of the last / worst ignition + injection update on a new tooth (Core 1)
+    uint32_t getRtCycles() const { return _rtCycles; }
+    uint32_t getRtMaxCycles() const { return _rtMaxCycles; }
     bool isLimpActive() const { return _limpActive; }
     uint8_t getLimpFaults() const { return _limpFaults; }
     uint8_t getCelFaults() const { return _celFaults; }
@@ -105,12 +113,23 @@ private:
     MCP3204Reader* _mcp3204;     // MCP3204 SPI ADC for MAP/TPS (alternative to ADS1115 @ 0x49)
     TransmissionManager* _trans;
     CustomPinManager* _customPins;
+    EventScheduler* _scheduler;
+    HwTimerBackend* _timerBackend;
+    MapSampler* _mapSampler;     // Crank-synchronous MAP windows (MCP3204 MAP only)
     bool _cj125Enabled;
     uint8_t _transType;
 
     uint8_t _firingOrder[12];
     uint8_t _crankTeeth;
     uint8_t _crankMissing;
+    uint8_t _triggerType;
+    uint8_t _camType;
+    float _camOffsetDeg;
+    uint8_t _triggerBlankPct;
+    uint8_t _mapSyncSamples = 4;
+    float _mapSyncStartDeg = 0.0f;
+    float _mapSyncWindowDeg = 0.0f;
+    uint8_t _mapMcpChannel = 0;
 
     // Configurable pin assignments (from ProjectInfo)
     uint8_t _pinAlternator;
@@ -129,6 +148,7 @@ private:
     uint8_t _pinHspiMiso;
     uint8_t _pinHspiCs;          // Shared CS for all MCP23S17 expanders
     uint8_t _pinMcp3204Cs;
+    uint8_t _mcp3204Oversample = 4;
     // Configurable expander/output pins (uint16_t: SPI expander pins 200-295)
     uint16_t _pinFuelPump;
     uint16_t _pinTachOut;
@@ -152,6 +172,8 @@ private:
 
     volatile uint32_t _updateTimeUs = 0;
     volatile uint32_t _sensorTimeUs = 0;
+    volatile uint32_t _rtCycles = 0;
+    volatile uint32_t _rtMaxCycles = 0;
 
     // Limp mode
     bool _limpActive = false;
@@ -183,11 +205,31 @@ private:
     uint32_t _fuelPumpPrimeStart = 0;
     bool _fuelPumpPriming = false;
     bool _fuelPumpRunning = false;
+
+    // Crank stall reporting (count changes in the ISR, logged from update())
+    uint32_t _lastStallCount = 0;
+    // Overdwell reporting (count changes in the real-time task, logged from update())
+    uint32_t _lastOverdwellCount = 0;
+    // Event plan overflows (plans rebuild in the real-time task, logged from update())
+    uint32_t _lastPlanOverflowCount = 0;
+
     void updateFuelPump();
 
+    // Crank-synchronous MAP: sample events start an MCP3204 conversion, the SPI bus task
+    // hands the result to the sampler
+    static bool convertMap(void* arg, uint8_t tag);
+    static void onMapSample(void* arg, uint8_t tag, float millivolts);
+
     // CLT-dependent rev limit
     TuneTable2D* _cltRevLimitTable = nullptr;
 
     TaskHandle_t _realtimeTaskHandle;
     static void realtimeTask(void* param);
+
+    // Real-time task notification bits (xTaskNotify eSetBits)
+    static const uint32_t RT_NOTIFY_TOOTH = 0x01;   // Crank ISR: new tooth
+    static const uint32_t RT_NOTIFY_TIMER = 0x02;   // Scheduler alarm: events due
+    static const uint32_t RT_NOTIFY_STALL = 0x04;   // Crank tooth timeout: engine stopped
+    static const uint8_t  RT_TIMER_NUM    = 0;      // Hardware timer for the event scheduler
+    static const uint8_t  STALL_TIMER_NUM = 1;      // Hardware timer for crank stall detection
 };
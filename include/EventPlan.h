@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+#include "TriggerDecoder.h"
+#include "CrankAngle.h"
+
+// Tooth-indexed event table for the real-time path.
+//
+// The owner lists its event angles once per change of advance, dwell or cycle mode; build()
+// files each event under every tooth whose lookahead window it falls in, together with its
+// angle past that tooth. On a tooth the real-time task then walks only that tooth's entries
+// and arms them as offsets from the tooth reference — no per-cylinder angle maths. Build and
+// walk are integer CrankAngle maths, so both can run in the real-time task.
+//
+// Tooth slots: the tooth position in the first revolution, + teeth in the second revolution
+// of a 720 deg cycle (CrankSensor::ToothReference::cycleTooth). Missing-tooth slots are kept
+// so the index is direct; they are never visited.
+//
+// Built and walked from the same task — no locking. build() never logs: it can run in the
+// real-time task, so a full table only counts, and the owner's caller reports it off that path.
+class EventPlan {
+public:
+    struct Entry {
+        uint8_t tag;            // Owner-defined: cylinder and event kind
+        CrankAngle offset;      // Crank angle after the tooth
+    };
+
+    EventPlan();
+    ~EventPlan();
+
+    // Sizes the table for the wheel: lookahead = the gap plus one tooth
+    void setGeometry(const TriggerDecoder::Geometry& geo, uint8_t maxEvents);
+
+    void clear(bool sequential);
+    void add(uint8_t tag, int32_t angleUnits);  // Engine-cycle angle in CrankAngle units, any range
+    void build();
+
+    bool isSequential() const { return _sequential; }
+    CrankAngle getLookahead() const { return _lookahead; }
+    uint16_t getEntryCount() const { return _slotStart ? _slotStart[_slots] : 0; }
+    uint16_t getMaxEntries() const { return _maxEntries; }
+    // Builds that ran out of entries and dropped events
+    uint32_t getOverflowCount() const { return __atomic_load_n(&_overflows, __ATOMIC_RELAXED); }
+
+    // Hot path: entries to arm on this tooth
+    const Entry* IRAM_ATTR entries(uint16_t cycleTooth, uint8_t& count) const {
+        if (!_slotStart || cycleTooth >= _slots) { count = 0; return nullptr; }
+        count = (uint8_t)(_slotStart[cycleTooth + 1] - _slotStart[cycleTooth]);
+        return &_entries[_slotStart[cycleTooth]];
+    }
+
+private:
+    TriggerDecoder::Geometry _geo;
+    uint16_t _tdcOffsetUnits;
+    CrankAngle _lookahead;
+    bool _sequential;
+    uint16_t _slots;            // teeth (360 deg cycle) or 2 x teeth (720)
+
+    // Pending event list, filled by add()
+    uint8_t _maxEvents;
+    uint8_t _eventCount;
+    uint8_t* _eventTag;
+    int32_t* _eventUnits;
+
+    // Entries grouped by slot: slot s owns [_slotStart[s], _slotStart[s + 1])
+    uint16_t* _slotStart;
+    Entry* _entries;
+    uint16_t _maxEntries;
+    uint32_t _overflows;
+
+    void release();
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include "CrankAngle.h"
+
+// Angle/time event scheduler for the real-time path.
+//
+// Consumers allocate a fixed event slot once (callback + arg), then arm it with
+// an absolute timestamp or a crank angle. One one-shot alarm is kept armed for
+// the earliest pending event; dispatch() runs everything that is due and re-arms.
+//
+// The core has no Arduino/IDF dependency so it builds on a host with a fake
+// TimerBackend. On the ECU the backend is a hardware timer (HwTimerBackend)
+// whose alarm wakes the Core 1 real-time task, which then calls dispatch().
+// schedule*/cancel/dispatch must all be called from that one task.
+
+class EventScheduler {
+public:
+    typedef void (*Callback)(void* arg);
+
+    class TimerBackend {
+    public:
+        virtual ~TimerBackend() {}
+        virtual int64_t nowUs() = 0;
+        virtual void armAt(int64_t whenUs) = 0;  // One-shot, replaces any pending alarm
+        virtual void disarm() = 0;
+    };
+
+    static const uint8_t MAX_EVENTS = 72;          // 12 cyl x (dwell, spark, overdwell, inj open, inj close) + batch open + 8 MAP samples
+    static const uint8_t INVALID_EVENT = 0xFF;
+    static const int64_t NO_ALARM = INT64_MAX;
+    static const uint8_t DISPATCH_SLACK_US = 2;    // Run events due within this window early
+
+    EventScheduler();
+
+    void begin(TimerBackend* backend);
+    bool isReady() const { return _backend != nullptr; }
+
+    // Event slots — allocated once at init, never freed
+    uint8_t allocate(Callback cb, void* arg);
+    void scheduleAt(uint8_t id, int64_t whenUs);
+    void scheduleAtAngle(uint8_t id, CrankAngle angle);
+    void scheduleAfterReference(uint8_t id, CrankAngle offset);  // Angle past the reference tooth, no wrap
+    void cancel(uint8_t id);
+    void cancelAll();
+    bool isPending(uint8_t id) const { return id < _count && _events[id].pending; }
+    int64_t getScheduledUs(uint8_t id) const { return id < _count ? _events[id].whenUs : 0; }
+
+    // Angle base — updated on every crank tooth from the latest tooth timestamp and period.
+    // Integer only: usPerUnitQ is us per CrankAngle unit, Q CrankAngle::RATE_SHIFT.
+    void setAngleReference(int64_t toothTimeUs, CrankAngle toothAngle, uint32_t usPerUnitQ, uint16_t cycleUnits);
+    int64_t angleToTimeUs(CrankAngle angle) const;
+    int64_t offsetToTimeUs(CrankAngle offset) const { return _refTimeUs + offset.travelUs(_usPerUnitQ); }
+    CrankAngle getReferenceAngle() const { return _refAngle; }
+    uint32_t getUsPerUnitQ() const { return _usPerUnitQ; }
+
+    // Run all due events and re-arm the backend for the next one
+    void dispatch();
+
+    // Dispatch statistics (latency = actual run time - scheduled time)
+    uint32_t getFiredCount() const { return _firedCount; }
+    uint32_t getLastLatencyUs() const { return _lastLatencyUs; }
+    uint32_t getMaxLatencyUs() const { return _maxLatencyUs; }
+    void resetStats() { _firedCount = 0; _lastLatencyUs = 0; _maxLatencyUs = 0; }
+
+private:
+    struct Event {
+        Callback cb;
+        void* arg;
+        int64_t whenUs;
+        bool pending;
+    };
+
+    TimerBackend* _backend;
+    Event _events[MAX_EVENTS];
+    uint8_t _count;
+    int64_t _armedAtUs;
+
+    int64_t _refTimeUs;
+    CrankAngle _refAngle;
+    uint32_t _usPerUnitQ;
+    uint16_t _cycleUnits;
+
+    uint32_t _firedCount;
+    uint32_t _lastLatencyUs;
+    uint32_t _maxLatencyUs;
+
+    void rearm();
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Arduino.h>
+#include <soc/soc.h>
+#include <soc/gpio_reg.h>
+#include "PinExpander.h"
+
+// Timing-critical output channel (coil, injector).
+//
+// A native GPIO is written through the GPIO set/clear registers: one 32-bit store per edge,
+// no driver call, no lock and no shared bus, so the edge lands a bounded few cycles after
+// the scheduler callback runs — from the real-time task, a timer callback or an ISR alike.
+// Expander pins (200+) can't be made fast; they fall back to a resolved PinHandle and pay
+// for an SPI transaction on the shared HSPI bus (queued urgent on SpiBus, ahead of ADC and
+// health reads). That queueing is task context only: in an ISR an expander write is refused.
+// Wire timing-critical channels to native GPIO.
+//
+// Resolved once at begin(); write() is the per-edge cost.
+class FastPin {
+public:
+    FastPin() : _pin(0), _mask(0), _setReg(0), _clrReg(0) {}
+
+    // Configures the pin as an output driven LOW. Returns true if it took the fast path.
+    bool attach(uint16_t pin);
+
+    bool isFast() const { return _mask != 0; }
+    uint16_t getPin() const { return _pin; }
+
+    inline void IRAM_ATTR write(uint8_t val) const {
+        if (_mask) REG_WRITE(val ? _setReg : _clrReg, _mask);
+        else if (!xPortInIsrContext()) _slow.write(val);    // SpiBus can't queue from an ISR
+    }
+    // Multi-pin edges (cut all, batch open): native pins are written now, expander pins
+    // join the batch and go out in its single OLAT write per device
+    inline void stage(PinBatch& batch, uint8_t val) const {
+        if (_mask) REG_WRITE(val ? _setReg : _clrReg, _mask);
+        else batch.stage(_slow, val);
+    }
+
+private:
+    uint16_t _pin;
+    uint32_t _mask;         // Bit in the GPIO 0-31 or 32-48 output bank, 0 = not fast
+    uint32_t _setReg;
+    uint32_t _clrReg;
+    PinHandle _slow;        // Everything that isn't a native output GPIO
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Arduino.h>
+#include "EventScheduler.h"
+
+// EventScheduler backend on an ESP32 general-purpose hardware timer.
+// The timer free-runs at 1 MHz; armAt() converts the esp_timer timestamp into an
+// absolute alarm value. The alarm ISR only notifies the real-time task — event
+// callbacks run in task context so they may use the SPI expander outputs.
+class HwTimerBackend : public EventScheduler::TimerBackend {
+public:
+    HwTimerBackend();
+    ~HwTimerBackend();
+
+    bool begin(uint8_t timerNum, TaskHandle_t notifyTask, uint32_t notifyBits);
+    void setNotifyTask(TaskHandle_t task) { _notifyTask = task; }
+
+    int64_t nowUs() override { return esp_timer_get_time(); }
+    void armAt(int64_t whenUs) override;
+    void disarm() override;
+
+private:
+    hw_timer_t* _timer;
+    volatile TaskHandle_t _notifyTask;
+    uint32_t _notifyBits;
+
+    static HwTimerBackend* _instance;
+    static void IRAM_ATTR onAlarm();
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+
+class ADS1115Reader;
+
+// I2C bus manager. Once start() has run, one Core 0 task owns Wire and is the only code that
+// touches it: it polls every registered ADS1115 round robin (each device's own per-channel
+// sampling plan) every millisecond, so a conversion is collected as soon as it can be done.
+// Readers never touch the bus — they read the devices' double-buffered samples.
+//
+// A NAKing or stuck device costs this task the Wire timeout, not the ECU update. When a
+// device keeps failing the task frees the bus: SDA released, SCL clocked until a slave
+// stuck mid-byte lets SDA go, a STOP, then Wire is re-initialised.
+class I2cBus {
+public:
+    static const uint8_t MAX_DEVICES = 2;           // ADS1115 @ 0x48, 0x49
+    static const uint32_t CLOCK_HZ = 400000;        // ADS1115 fast mode
+    static const uint8_t RECOVER_AFTER_ERRORS = 3;  // Consecutive failed polls on one device
+    static const uint32_t RECOVER_BACKOFF_MS = 1000;
+
+    static I2cBus& instance();
+
+    // Wire up (probe time: devices' begin() may use Wire until start())
+    bool begin(uint8_t sdaPin, uint8_t sclPin);
+    bool addDevice(ADS1115Reader* dev);
+    bool start();           // Hands Wire to the bus task
+    bool isRunning() const { return _task != nullptr; }
+
+    // Stats
+    uint32_t getPollCount() const { return _polls; }
+    uint32_t getRecoveryCount() const { return _recoveries; }
+    uint32_t getPollMaxUs() const { return _pollMaxUs; }    // Longest pass over all devices
+    void resetStats() { _pollMaxUs = 0; }
+
+private:
+    I2cBus() = default;
+
+    uint8_t _sda = 0;
+    uint8_t _scl = 0;
+    bool _wireUp = false;
+    ADS1115Reader* _dev[MAX_DEVICES] = {};
+    uint8_t _deviceCount = 0;
+    TaskHandle_t _task = nullptr;
+    uint32_t _lastRecoverMs = 0;
+
+    volatile uint32_t _polls = 0;
+    volatile uint32_t _recoveries = 0;
+    volatile uint32_t _pollMaxUs = 0;
+
+    void initWire();
+    bool recover();
+    static void busTask(void* param);
+};
@@ -1,51 +1,101 @@
 #pragma once
 
 #include <Arduino.h>
+#include "CrankSensor.h"
+#include "EventPlan.h"
+#include "FastPin.h"
+
+class EventScheduler;
 
 class IgnitionManager {
 public:
     static const uint8_t MAX_CYLINDERS = 12;
     static constexpr float DEFAULT_DWELL_MS = 3.0f;
     static const uint16_t DEFAULT_REV_LIMIT = 6000;
+    static const uint16_t REPLAN_DWELL_UNITS = 16;    // Dwell angle drift (RPM change) that rebuilds the plan: 0.5 deg
 
     IgnitionManager();
     ~IgnitionManager();
 
+    void setScheduler(EventScheduler* sched) { _scheduler = sched; }  // Before begin()
+    void setTriggerGeometry(const TriggerDecoder::Geometry& geo);     // From CrankSensor after its begin()
     void begin(uint8_t numCylinders, const uint16_t* coilPins, const uint8_t* firingOrder);
 
     void setAdvance(float deg);
     void setDwellMs(float ms);
     void setRevLimit(uint16_t rpm);
     void setConfigRevLimit(uint16_t rpm) { _configRevLimit = rpm; }
-    void setMaxDwellMs(float ms) { _maxDwellMs = ms; }
+    void setMaxDwellMs(float ms) { _maxDwellMs = ms; _maxDwellUs = (uint32_t)(ms * 1000.0f); }
 
     float getAdvance() const { return _advanceDeg; }
     float getDwellMs() const { return _dwellMs; }
     uint16_t getRevLimit() const { return _revLimit; }
     uint16_t getConfigRevLimit() const { return _configRevLimit; }
     bool isRevLimiting() const { return _revLimiting; }
-    uint32_t getOverdwellCount() const { return _overdwellCount; }
-    void resetOverdwellCount() { _overdwellCount = 0; }
+    // Overdwell cutoffs, counted from the real-time task. The warning is logged by the caller
+    // (ECU::update on Core 0) when the count moves — never from the real-time path.
+    uint32_t getOverdwellCount() const { return __atomic_load_n(&_overdwellCount, __ATOMIC_RELAXED); }
+    void resetOverdwellCount() { __atomic_store_n(&_overdwellCount, 0, __ATOMIC_RELAXED); }
+    uint8_t getLastOverdwellCyl() const { return _lastOverdwellCyl; }
+    uint32_t getLastOverdwellUs() const { return _lastOverdwellUs; }      // Coil on-time at cutoff
+    // Scheduled spark time -> coil pin written (last / worst), and coils on the fast path
+    uint32_t getSparkLatencyUs() const { return _sparkLatencyUs; }
+    uint32_t getSparkMaxLatencyUs() const { return _sparkMaxLatencyUs; }
+    void resetSparkLatency() { _sparkLatencyUs = 0; _sparkMaxLatencyUs = 0; }
+    uint8_t getFastCoilCount() const { return _fastCoils; }
+    uint32_t getPlanOverflowCount() const { return _plan.getOverflowCount(); }
 
-    void update(uint16_t rpm, uint16_t toothPos, bool sequential);
+    // ref: the last tooth (cycleDeg 720 = sequential). Events are armed from the event plan
+    // only when newTooth — re-arming from an old reference would put an event that already
+    // fired back in the past. Safety checks run on every call.
+    void update(uint16_t rpm, const CrankSensor::ToothReference& ref, bool newTooth);
+    void cutSpark();    // Release all coils and cancel armed events (rev limit, stall)
 
 private:
     uint8_t _numCylinders;
     uint16_t _coilPins[MAX_CYLINDERS];
+    FastPin _coilOut[MAX_CYLINDERS];
+    uint8_t _fastCoils;
+    volatile uint32_t _sparkLatencyUs;
+    volatile uint32_t _sparkMaxLatencyUs;
     uint8_t _firingOrder[MAX_CYLINDERS];
     float _advanceDeg;
     float _dwellMs;
     float _maxDwellMs;
+    // Integer copies for the real-time path, converted by the setters
+    int16_t _advanceUnits;
+    uint32_t _dwellUnitsPerRpmQ16;    // CrankAngle units of dwell per RPM, Q16
+    uint32_t _maxDwellUs;
     uint16_t _revLimit;
     uint16_t _configRevLimit;
     bool _revLimiting;
     uint32_t _overdwellCount;
+    volatile uint8_t _lastOverdwellCyl;
+    volatile uint32_t _lastOverdwellUs;
+    EventScheduler* _scheduler;
+
+    // Dwell start and spark per cylinder by tooth. Setters only mark it dirty; the
+    // real-time task rebuilds it before its next walk.
+    static const uint8_t PLAN_SPARK = 0x80;     // Entry tag: cylinder | PLAN_SPARK, else dwell start
+    EventPlan _plan;
+    volatile bool _planDirty;
+    uint16_t _planDwellUnits;
+    void rebuildPlan(uint16_t dwellUnits, bool sequential);
 
     struct CoilState {
-        bool charging;
-        int64_t dwellStartUs;
+        IgnitionManager* owner;
+        uint8_t cyl;
+        uint8_t dwellEvent;     // EventScheduler slot: start charging
+        uint8_t sparkEvent;     // EventScheduler slot: release coil
+        uint8_t overdwellEvent; // EventScheduler slot: max dwell cutoff, armed at dwell start
+        volatile bool charging;
+        volatile int64_t dwellStartUs;
     };
     CoilState _coilState[MAX_CYLINDERS];
 
-    void cutSpark();
+    // Scheduler callbacks (real-time task context), arg = CoilState*
+    static void onDwellStart(void* arg);
+    static void onSpark(void* arg);
+    static void onOverdwell(void* arg);
+    void releaseOverdwell(CoilState& cs, int64_t nowUs);
 };
@@ -1,6 +1,11 @@
 #pragma once
 
 #include <Arduino.h>
+#include "CrankSensor.h"
+#include "EventPlan.h"
+#include "FastPin.h"
+
+class EventScheduler;
 
 class InjectionManager {
 public:
@@ -11,6 +16,8 @@ public:
     InjectionManager();
     ~InjectionManager();
 
+    void setScheduler(EventScheduler* sched) { _scheduler = sched; }  // Before begin()
+    void setTriggerGeometry(const TriggerDecoder::Geometry& geo);     // From CrankSensor after its begin()
     void begin(uint8_t numCylinders, const uint16_t* injectorPins, const uint8_t* firingOrder);
 
     void setPulseWidthUs(float pw);
@@ -22,24 +29,82 @@ public:
     float getTrim(uint8_t cyl) const;
     float getEffectivePulseWidthUs(uint8_t cyl) const;
 
-    void update(uint16_t rpm, uint16_t toothPos, bool sequential);
+    // ref: the last tooth (cycleDeg 720 = sequential). Opens are armed from the event plan
+    // only when newTooth — re-arming from an old reference would put an event that already
+    // fired back in the past. Safety checks run on every call.
+    void update(uint16_t rpm, const CrankSensor::ToothReference& ref, bool newTooth);
     void cutFuel();
+    void closeAll();    // Close injectors and cancel armed opens without latching fuel cut (stall)
     void resumeFuel();
     bool isFuelCut() const { return _fuelCut; }
+    // Scheduled open time -> injector pin written (last / worst), and injectors on the fast path
+    uint32_t getOpenLatencyUs() const { return _openLatencyUs; }
+    uint32_t getOpenMaxLatencyUs() const { return _openMaxLatencyUs; }
+    void resetOpenLatency() { _openLatencyUs = 0; _openMaxLatencyUs = 0; }
+    // Delivered pulse (open written -> close written) minus commanded pulse: last (signed) /
+    // worst magnitude, and closes the update() backstop had to make because the event was lost
+    int32_t getPulseErrorUs() const { return _pulseErrorUs; }
+    uint32_t getPulseMaxErrorUs() const { return _pulseMaxErrorUs; }
+    uint32_t getLateCloseCount() const { return _lateCloseCount; }
+    void resetPulseError() { _pulseErrorUs = 0; _pulseMaxErrorUs = 0; }
+    uint8_t getFastInjectorCount() const { return _fastInjectors; }
+    uint32_t getPlanOverflowCount() const { return _plan.getOverflowCount(); }
 
 private:
     uint8_t _numCylinders;
     uint16_t _injectorPins[MAX_CYLINDERS];
+    FastPin _injOut[MAX_CYLINDERS];
+    uint8_t _fastInjectors;
+    volatile uint32_t _openLatencyUs;
+    volatile uint32_t _openMaxLatencyUs;
+    volatile int32_t _pulseErrorUs;
+    volatile uint32_t _pulseMaxErrorUs;
+    volatile uint32_t _lateCloseCount;
     uint8_t _firingOrder[MAX_CYLINDERS];
     float _basePulseWidthUs;
     float _deadTimeMs;
     float _trimPercent[MAX_CYLINDERS];
     bool _fuelCut;
+    EventScheduler* _scheduler;
+
+    // Injector open per cylinder by tooth. Only geometry, cylinders, pins and firing order
+    // shape it — those mark it dirty and the real-time task rebuilds it before its next walk.
+    // The pulse is read from _cylPulseUs when an open is armed, so fuelling changes every
+    // 10ms never touch the plan.
+    EventPlan _plan;
+    volatile uint32_t _cylPulseUs[MAX_CYLINDERS];   // base x trim + dead time, converted by the setters
+    volatile bool _planDirty;
+    // Batch mode opens every injector on one event so the expander pins share one SPI write
+    static const uint8_t PLAN_BATCH = 0xFF;     // Entry tag: batch open, else cylinder
+    uint16_t _batchMask;                        // Cylinders in the batch open
+    uint8_t _batchEvent;
+    void updatePulses();
+    void rebuildPlan(bool sequential);
+    // Pulse an open latches: full (sequential) or half (batch, fires twice per cycle)
+    uint32_t armPulseUs(uint8_t cyl) const {
+        return _plan.isSequential() ? _cylPulseUs[cyl] : _cylPulseUs[cyl] / 2;
+    }
 
     struct InjectorState {
-        bool open;
-        int64_t openTimeUs;
-        float scheduledPulseUs;
+        InjectionManager* owner;
+        uint8_t cyl;
+        uint8_t openEvent;          // EventScheduler slot: open injector
+        uint8_t closeEvent;         // EventScheduler slot: close, armed by markOpen()
+        volatile bool open;
+        volatile int64_t openTimeUs;
+        uint32_t scheduledPulseUs;
+        uint32_t pendingPulseUs;    // Pulse width latched when the open event is armed
     };
     InjectorState _injState[MAX_CYLINDERS];
+
+    // Scheduler callbacks (real-time task context), arg = InjectorState* / InjectionManager*
+    static void onOpen(void* arg);
+    static void onBatchOpen(void* arg);
+    static void onClose(void* arg);
+    void markOpen(InjectorState& st, int64_t nowUs, int64_t scheduledUs);
+    void closeDue(int64_t dueByUs);
+
+    // update() closes an injector itself only this far past its pulse — the close event
+    // was cancelled (sync loss) or the real-time task is not dispatching
+    static const uint32_t CLOSE_BACKSTOP_US = 1000;
 };
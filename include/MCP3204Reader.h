@@ -1,22 +1,74 @@
 #pragma once
 
 #include <Arduino.h>
-#include <SPI.h>
+#include "SpiBus.h"
 
+// MCP3204 4-channel 12-bit SPI ADC.
+//
+// Channels are read from a snapshot. refresh() converts every channel in use in one SpiBus
+// burst — oversample x channels conversions, channels interleaved so each average spans the
+// whole burst — and publishes the averages. Only ECU::update calls it, at the top of each
+// tick, so one task writes the snapshot. Readers on any task never touch the bus: a channel
+// joins the burst on its first read, which returns 0 until that channel's first average.
 class MCP3204Reader {
 public:
+    static const uint8_t MAX_OVERSAMPLE = 16;               // 16 x 12-bit sums fit 16 bits
+    static const uint32_t SNAPSHOT_MAX_AGE_US = 20000;      // Two update ticks: older reads aren't hits
+
     MCP3204Reader();
-    bool begin(SPIClass* spi, uint8_t csPin, float vRef = 5.0f);
-    int16_t readChannel(uint8_t ch);       // Raw 12-bit value (0-4095)
-    float readMillivolts(uint8_t ch);      // (raw / 4095.0) * vRef * 1000
+    bool begin(uint8_t csPin, float vRef = 5.0f);   // On the HSPI SpiBus (already begun)
+    void setOversampling(uint8_t n);       // Conversions averaged per channel, 1-16
+    bool refresh();                        // One burst over every channel in use, waits on the bus. ECU::update only.
+    int16_t readChannel(uint8_t ch);       // Raw 12-bit value (0-4095) of one conversion, bypasses the snapshot
+    float readMillivolts(uint8_t ch);      // Snapshot average x vRef, joins the burst; any task
+
+    // One conversion without waiting: fn(arg, tag, mV) runs in the SPI bus task when it is done.
+    // One in flight at a time — false while the last is still queued (or the queue is full).
+    // Safe from the real-time task.
+    typedef void (*SampleFn)(void* arg, uint8_t tag, float millivolts);
+    bool convertAsync(uint8_t ch, uint8_t tag, SampleFn fn, void* arg);
     bool isReady() const { return _ready; }
     uint8_t getCsPin() const { return _cs; }
     float getVRef() const { return _vRef; }
+    uint8_t getOversampling() const { return _oversample; }
+
+    // Stats
+    uint32_t getBurstCount() const { return _bursts; }
+    uint32_t getSnapshotHits() const { return _snapHits; }
 
 private:
-    SPIClass* _spi;
+    uint8_t _dev;           // SpiBus device
     uint8_t _cs;
     float _vRef;
     bool _ready;
+    uint8_t _oversample;
     static constexpr uint32_t SPI_SPEED = 1000000; // 1MHz (MCP3204 max 2MHz @ 5V)
+
+    volatile uint8_t _used;         // Channels in the burst
+    float _snapMv[4];
+    volatile uint8_t _snapValid;    // Channels with a published average
+    volatile int64_t _snapUs;
+    volatile uint32_t _bursts;
+    volatile uint32_t _snapHits;
+
+    struct Burst {
+        uint8_t ch[4];
+        uint8_t count;
+        uint16_t sum[4];
+        uint8_t samples[4];     // Conversions collected per channel
+    };
+    struct AsyncSample {
+        SampleFn fn;
+        void* arg;
+        uint8_t ch;
+        uint8_t tag;
+    };
+    AsyncSample _async;
+    SpiFuture _asyncDone;           // Never waited on while pending — polled before reuse
+    static uint8_t asyncStep(void* arg, uint8_t i, uint8_t* tx);
+    static void asyncCollect(void* arg, uint8_t i, const uint8_t* rx);
+
+    static uint8_t burstStep(void* arg, uint8_t i, uint8_t* tx);
+    static void burstCollect(void* arg, uint8_t i, const uint8_t* rx);
+    static void command(uint8_t ch, uint8_t* tx);
 };
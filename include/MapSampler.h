@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+#include "CrankSensor.h"
+#include "EventPlan.h"
+
+class EventScheduler;
+
+// Crank-angle-synchronous MAP sampling.
+//
+// Every cylinder event (720 / cylinders deg) has an intake window that starts startDeg after
+// that cylinder's TDC and is widthDeg wide. `samples` conversions are spread evenly across
+// the window. The sample angles go into an EventPlan, like the injector opens, so the
+// real-time task arms them from the tooth reference and the scheduler fires them on angle.
+//
+// A sample event only starts a conversion (ConvertFn). Its result comes back through
+// addSample() from whichever task completes it. A window's mean is published when its last
+// sample lands, or when the first sample of the next window arrives. That gives one load
+// value per cylinder event, with the intake pulsation averaged over the window. A sample
+// every 10 ms would beat against the pulsation instead.
+//
+// Without cam phase the windows repeat every revolution: exact for even cylinder counts,
+// approximate for odd ones.
+class MapSampler {
+public:
+    static const uint8_t MAX_CYLINDERS = 12;
+    static const uint8_t MAX_SAMPLES = 8;               // Per window; one scheduler slot each
+    static const uint32_t LOAD_MAX_AGE_US = 100000;     // Older window = no load (stalled, not armed)
+
+    // Start a conversion for a sample; false = refused (converter busy). The result has to
+    // come back as addSample(tag, value), always from the same task.
+    typedef bool (*ConvertFn)(void* arg, uint8_t tag);
+
+    MapSampler();
+
+    void setScheduler(EventScheduler* sched) { _scheduler = sched; }  // Before begin()
+    void setTriggerGeometry(const TriggerDecoder::Geometry& geo);     // From CrankSensor after its begin()
+    void setConverter(ConvertFn fn, void* arg) { _convertArg = arg; _convert = fn; }
+    void begin(uint8_t numCylinders);
+
+    // Window after each cylinder's TDC; widthDeg 0 = the whole event spacing. samples 0 = off.
+    void setWindow(float startDeg, float widthDeg, uint8_t samples);
+    uint8_t getSamples() const { return _samples; }
+    bool isEnabled() const { return _samples > 0 && _convert != nullptr; }
+
+    // Real-time task: arm this tooth's sample events (newTooth only, as the injection plan)
+    void update(uint16_t rpm, const CrankSensor::ToothReference& ref, bool newTooth);
+
+    // Conversion side: result for a tag handed to ConvertFn
+    void addSample(uint8_t tag, float value);
+
+    // Reader side — any task. The last complete window is published as a whole under a
+    // sequence count; a reader that keeps catching it mid-write gets no load this call.
+    struct Window {
+        float load;             // Mean of the window's samples
+        int64_t timeUs;         // esp_timer time it was published
+        uint32_t count;         // Windows published so far
+        uint8_t samples;        // Samples behind the mean
+    };
+    bool readWindow(Window& out) const;
+    // Mean of the last window, if one is younger than LOAD_MAX_AGE_US
+    bool getLoad(int64_t nowUs, float& load) const;
+    bool hasLoad(int64_t nowUs) const { float l; return getLoad(nowUs, l); }
+    uint32_t getWindowCount() const { Window w; return readWindow(w) ? w.count : 0; }
+    uint8_t getLastWindowSamples() const { Window w; return readWindow(w) ? w.samples : 0; }
+    uint32_t getRefusedCount() const { return _refused; }   // Sample events the converter turned down
+    uint32_t getPlanOverflowCount() const { return _plan.getOverflowCount(); }
+
+private:
+    EventScheduler* _scheduler;
+    ConvertFn _convert;
+    void* _convertArg;
+    uint8_t _numCylinders;
+    float _startDeg;
+    float _widthDeg;
+    uint8_t _samples;
+
+    // Sample angles by tooth. Tag = window (cylinder event in firing order) x MAX_SAMPLES + sample.
+    // setWindow() only marks it dirty; the real-time task rebuilds it before its next walk.
+    EventPlan _plan;
+    volatile bool _planDirty;
+
+    struct SampleSlot {
+        MapSampler* owner;
+        uint8_t event;          // EventScheduler slot
+        uint8_t tag;            // Latched when armed
+    };
+    SampleSlot _slot[MAX_SAMPLES];
+    static void onSample(void* arg);    // Scheduler callback (real-time task), arg = SampleSlot*
+    void rebuildPlan(bool sequential);
+
+    // Window being averaged (conversion side only)
+    float _accSum;
+    uint8_t _accCount;
+    uint8_t _accWindow;
+    void publish();
+
+    // Published window: 64-bit time and load can't be stored in one go on this core, so
+    // readers copy it between two equal even counts (odd while publish() writes)
+    Window _window;
+    volatile uint32_t _windowSeq;
+    volatile uint32_t _refused;
+};
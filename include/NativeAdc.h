@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ESP32-S3 native ADC in continuous (DMA) mode.
+//
+// Every ADC1 pin registered with addPin() goes into one hardware scan pattern, sampled at
+// SAMPLE_HZ in total by the ADC's digital controller and written to memory by DMA. A Core 0
+// task takes each DMA frame, averages every channel's samples in it and publishes the mean —
+// ~FRAME_RESULTS / channels samples behind each value, a fresh value every few ms. Readers
+// get the latest mean from memory and never wait on a conversion.
+//
+// ADC2 pins are shared with Wi-Fi and never scanned; read() falls back to analogRead() for
+// them, and for every pin before start(). Once the scan runs ADC1 belongs to the digital
+// controller: IDF 4.4 doesn't support oneshot ADC1 reads during a DMA scan, so ADC1 readers
+// must go through read() rather than analogRead(), and read() itself never falls back.
+class NativeAdc {
+public:
+    static const uint8_t ADC1_CHANNELS = 10;        // GPIO1-10
+    static const uint32_t SAMPLE_HZ = 20000;        // Whole scan, shared by the channels
+    static const uint16_t FRAME_RESULTS = 128;      // Conversions per DMA frame (6.4 ms)
+
+    static NativeAdc& instance();
+
+    bool addPin(uint8_t pin);   // false = not an ADC1 pin; joins a running scan at the next frame
+    bool start();
+    bool isRunning() const { return _task != nullptr; }
+    bool isScanned(uint8_t pin) const;     // Has a published mean — read() is live
+
+    // Latest frame mean, 12-bit counts with the fraction kept. analogRead() for ADC2 pins and
+    // before start(); once the scan runs, 0 for an ADC1 pin until its first frame is in
+    // (isScanned() false) — add the pin with addPin() to get it sampled.
+    float readAverage(uint8_t pin);
+    uint16_t read(uint8_t pin) { return (uint16_t)(readAverage(pin) + 0.5f); }
+
+    // Stats
+    uint32_t getFrameCount() const { return _frames; }
+    uint32_t getOverrunCount() const { return _overruns; }  // DMA results dropped before the task read them
+    uint8_t getSamplesPerValue() const { return _samplesPerValue; }  // Fewest samples behind a value, last frame
+
+private:
+    NativeAdc() = default;
+
+    static const uint16_t FRAME_BYTES = FRAME_RESULTS * 4;    // S3 type-2 results are 4 bytes
+
+    TaskHandle_t _task = nullptr;
+    volatile uint16_t _scanMask = 0;        // ADC1 channels wanted
+    uint16_t _activeMask = 0;               // ADC1 channels in the running pattern (task only)
+
+    volatile uint16_t _mean16[ADC1_CHANNELS] = {};  // Frame mean x 16 (4095 x 16 fits 16 bits)
+    volatile uint16_t _validMask = 0;               // Channels with a published mean
+
+    volatile uint32_t _frames = 0;
+    volatile uint32_t _overruns = 0;
+    volatile uint8_t _samplesPerValue = 0;
+
+    static int8_t channelOf(uint8_t pin);
+    bool configure(uint16_t mask);
+    void decimate(const uint8_t* buf, uint32_t len);
+    static void dmaTask(void* param);
+};
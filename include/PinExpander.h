@@ -1,7 +1,7 @@
 #pragma once
 
 #include <Arduino.h>
-#include <SPI.h>
+#include "SpiBus.h"
 
 // Pin convention:
 //   0-99    = native ESP32 GPIO  (digitalWrite / digitalRead)
@@ -60,17 +60,49 @@ class PinExpander {
 public:
     static PinExpander& instance();
 
-    // Initialize a single MCP23S17 on shared SPI bus + shared CS pin
+    // Initialize a single MCP23S17 on the shared HSPI bus (SpiBus, already begun) + shared CS pin
     // index: 0-5, hwAddr: hardware address (A2/A1/A0 pins, 0-7)
-    bool begin(uint8_t index, SPIClass* spi, uint8_t csPin, uint8_t hwAddr);
+    bool begin(uint8_t index, uint8_t csPin, uint8_t hwAddr);
 
     bool isReady(uint8_t index) const { return index < SPI_EXP_MAX && _ready[index]; }
 
     // Pin operations — pin is local offset (0 to SPI_EXP_MAX*16-1)
+    // Output writes update the shadow and queue an OLAT flush on the bus (fire-and-forget);
+    // the flush sends the shadow as it is when the bus gets to it, and one pending flush per
+    // device covers any number of writes before it goes out.
     void setPinMode(uint8_t pin, uint8_t mode);
     void writePin(uint8_t pin, uint8_t val);
+    // Like writePin, but returns once the new level is on the pin (chip selects driven
+    // through the expander ahead of a transfer on another bus)
+    void writePinSync(uint8_t pin, uint8_t val);
+    // Apply set/clear masks to a device's output shadow and queue one OLATA/B write (PinBatch)
+    void writeMasked(uint8_t index, uint16_t setMask, uint16_t clearMask);
+    // Resolved writes/reads for PinHandle — index and mask already validated at attach
+    void writeResolved(uint8_t index, uint16_t mask, uint8_t val) {
+        queueFlush(index, val ? mask : 0, val ? 0 : mask);
+    }
+    void writeResolvedSync(uint8_t index, uint16_t mask, uint8_t val);
+    uint8_t readResolved(uint8_t index, uint16_t mask) { return (inputs(index) & mask) ? HIGH : LOW; }
+    // Flushes for this device go on the bus's urgent queue (coil / injector outputs)
+    void setUrgent(uint8_t pin);
+    bool isUrgent(uint8_t index) const { return index < SPI_EXP_MAX && (_urgent & (1 << index)); }
+    // Input reads come from a per-device GPIO snapshot: a memory load while it is younger
+    // than SNAPSHOT_MAX_AGE_US and no shared interrupt has fired since, else one bus read
     uint8_t readPin(uint8_t pin);
     uint16_t readAll(uint8_t index);
+    // OLAT on the wire when the snapshot was sampled — compare outputs against this, not the
+    // live shadow, which may already hold writes the bus has not flushed
+    uint16_t getSnapshotOlat(uint8_t index) const {
+        return index < SPI_EXP_MAX ? (uint16_t)(__atomic_load_n(&_snapshot[index], __ATOMIC_ACQUIRE) >> 16) : 0;
+    }
+    // Once per ECU tick: re-read every device read since the last call, all in one bus burst
+    void refreshInputs();
+    // Once per ECU tick: re-queue OLAT flushes the bus refused (queue full, bus not running)
+    void retryFlushes();
+    uint32_t getFlushRetryCount() const { return _flushRetries; }
+    static const uint32_t SNAPSHOT_MAX_AGE_US = 20000;  // Two 10ms ticks
+    uint32_t getSnapshotHits() const { return _snapHits; }
+    uint32_t getSnapshotReads() const { return _snapReads; }
 
     // Health check — returns bitmask of failed devices (bits 0-5)
     uint8_t healthCheck();
@@ -78,14 +110,21 @@ public:
     // Shared open-drain interrupt — all INTA pins wired to one ESP32 GPIO + 10k pull-up
     bool attachSharedInterrupt(uint8_t espGpioPin);
     bool hasSharedInterrupt() const { return _sharedIntFlag; }
-    void clearSharedInterrupt() { _sharedIntFlag = false; }
     uint8_t getIntGpio() const { return _sharedIntGpio; }
 
+    // Interrupt service: the shared-INT ISR wakes a Core 0 task that burst-reads INTF+INTCAP
+    // of every device with GPINTEN set (one transaction each, all queued before the first
+    // wait) and calls the handler once per device with a change. Handler runs in that task.
+    typedef void (*InterruptHandler)(void* arg, uint8_t index, uint16_t changedPins, uint16_t capturedValues);
+    void setInterruptHandler(InterruptHandler fn, void* arg) { _intArg = arg; _intHandler = fn; }
+    uint32_t getInterruptServiceCount() const { return _intServiced; }
+
     // Enable/disable interrupt-on-change for a specific expander pin (globalPin 200-295)
     void enablePinInterrupt(uint8_t globalPin);
     void disablePinInterrupt(uint8_t globalPin);
 
-    // Check a specific device for pending interrupt — reads INTF + INTCAP, clears interrupt
+    // Check a specific device for pending interrupt — reads INTF + INTCAP (one 4-register
+    // burst), clears interrupt
     bool checkInterrupt(uint8_t index, uint16_t& changedPins, uint16_t& capturedValues);
 
     // Check if any pins have interrupt-on-change enabled for a device
@@ -101,30 +140,124 @@ public:
 private:
     PinExpander() = default;
 
-    SPIClass* _spi = nullptr;
+    uint8_t _dev = SpiBus::INVALID_DEVICE;  // SpiBus device: shared CS, all 6 expanders
     uint8_t _csPin = 0xFF;              // Shared CS pin for all 6 devices
     bool _ready[SPI_EXP_MAX] = {};
     uint8_t _hwAddr[SPI_EXP_MAX] = {};
     uint16_t _shadow[SPI_EXP_MAX] = {}; // Output latch shadow (OLAT)
     uint16_t _dir[SPI_EXP_MAX] = {0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF};
+    // Shadow writers run on both cores; the bus task reads the shadow when it flushes
+    portMUX_TYPE _shadowLock = portMUX_INITIALIZER_UNLOCKED;
+    uint8_t _flushPending = 0;          // Bit per device with an OLAT flush queued
+    uint8_t _flushRetry = 0;            // Bit per device whose flush the bus refused
+    volatile uint32_t _flushRetries = 0;
+    uint8_t _urgent = 0;                // Bit per device flushed on the urgent queue
+    uint16_t _sentOlat[SPI_EXP_MAX] = {};   // Last OLAT value put on the wire (bus task)
+
+    // Input snapshot per device: OLAT << 16 | GPIOA|B in one word, so the pair is stored and
+    // loaded atomically. Refreshed from the update and interrupt-service tasks, read from any.
+    uint32_t _snapshot[SPI_EXP_MAX] = {};
+    uint16_t _readOlat[SPI_EXP_MAX] = {};   // _sentOlat captured by the bus task at sample time
+    uint32_t _snapUs[SPI_EXP_MAX] = {};
+    uint8_t _snapValid = 0;             // Bit masks: __atomic read-modify-write only
+    uint8_t _snapUsed = 0;              // Read since the last refreshInputs()
+    volatile uint8_t _inputsDirty = 0;  // Set by the shared INT ISR and checkInterrupt()
+    volatile uint32_t _snapHits = 0;
+    volatile uint32_t _snapReads = 0;
+    uint16_t inputs(uint8_t index);
+    void refresh(uint8_t mask);
+    static uint8_t fillGpioRead(void* arg, uint8_t* tx);
 
     // Shared interrupt state
     uint8_t _sharedIntGpio = 0xFF;
     volatile bool _sharedIntFlag = false;
+    TaskHandle_t _intTask = nullptr;
+    InterruptHandler _intHandler = nullptr;
+    void* _intArg = nullptr;
+    volatile uint32_t _intServiced = 0;
+    static const uint8_t INT_SERVICE_PASSES = 4;    // Re-reads while the line stays low
+    void serviceInterrupts();
+    static void intServiceTask(void* param);
+    void queueIntBurst(uint8_t index, SpiFuture& f);
     uint16_t _gpinten[SPI_EXP_MAX] = {};  // Shadow of GPINTENA|B per device
 
-    // SPI register helpers (10MHz, direct transfer)
+    // SPI register helpers (10MHz, queued on SpiBus — writes return at once, reads wait)
     void spiWriteReg(uint8_t index, uint8_t reg, uint8_t val);
     uint8_t spiReadReg(uint8_t index, uint8_t reg);
     void spiWriteReg16(uint8_t index, uint8_t reg, uint16_t val);
     uint16_t spiReadReg16(uint8_t index, uint8_t reg);
 
-    // Generic ISR handler — arg points to volatile bool flag
+    // OLAT flush: mark the shadow dirty, queue a deferred write unless one is pending
+    void queueFlush(uint8_t index, uint16_t setMask, uint16_t clearMask, SpiFuture* done = nullptr);
+    static uint8_t fillOlat(void* arg, uint8_t* tx);
+
+    // Shared INT ISR — arg = PinExpander*: flags the interrupt, invalidates the snapshots
     static void IRAM_ATTR intISR(void* arg);
 };
 
+// Coalesced output writes: begin (construct), stage any number of pins, commit. Expander
+// pins are collected per device and flushed as one 16-bit OLAT write per touched device
+// instead of one SPI transaction per pin; native GPIO pins are written at stage time.
+// A stack object — batches from different tasks share no state. The destructor commits
+// anything still staged.
+class PinHandle;
+
+class PinBatch {
+public:
+    PinBatch() : _touched(0) {
+        memset(_set, 0, sizeof(_set));
+        memset(_clear, 0, sizeof(_clear));
+    }
+    ~PinBatch() { commit(); }
+
+    void stage(uint16_t pin, uint8_t val);
+    void stage(const PinHandle& pin, uint8_t val);
+    void commit();
+
+private:
+    uint16_t _set[SPI_EXP_MAX];
+    uint16_t _clear[SPI_EXP_MAX];
+    uint8_t _touched;       // Bit per device with staged pins
+
+    PinBatch(const PinBatch&) = delete;
+    PinBatch& operator=(const PinBatch&) = delete;
+};
+
+// A pin resolved once (at the owner's begin()): backend, device index and bit mask. A write
+// is one indirect call — digitalWrite for native GPIO, a shadow update + queued flush for an
+// expander pin — with no range checks, divide or ready check per call. A pin that is 0,
+// out of range or on an expander that failed its probe resolves to a no-op.
+// Does not configure the pin; owners still call xPinMode() once.
+class PinHandle {
+public:
+    PinHandle() : _write(writeNone), _exp(nullptr), _pin(0), _mask(0), _index(0) {}
+
+    bool attach(uint16_t pin);      // false = resolved to a no-op
+    uint16_t getPin() const { return _pin; }
+    bool isExpander() const { return _exp != nullptr; }
+    bool isValid() const { return _write != writeNone; }
+
+    inline void write(uint8_t val) const { _write(*this, val); }
+    void writeSync(uint8_t val) const;  // Expander: returns once the level is on the pin
+    uint8_t read() const;
+
+private:
+    friend class PinBatch;
+    typedef void (*WriteFn)(const PinHandle& h, uint8_t val);
+    WriteFn _write;
+    PinExpander* _exp;              // nullptr = native GPIO
+    uint16_t _pin;
+    uint16_t _mask;                 // Bit within the device's 16-bit port pair
+    uint8_t _index;                 // Expander device
+
+    static void writeNone(const PinHandle& h, uint8_t val);
+    static void writeNative(const PinHandle& h, uint8_t val);
+    static void writeExpander(const PinHandle& h, uint8_t val);
+};
+
 // Global helpers — route by pin number (native GPIO / SPI MCP23S17)
 // uint16_t pin: 0-48 = native GPIO, 200-295 = MCP23S17 expander
 void xDigitalWrite(uint16_t pin, uint8_t val);
+void xDigitalWriteSync(uint16_t pin, uint8_t val);  // Expander pin: waits for the SPI write
 uint8_t xDigitalRead(uint16_t pin);
 void xPinMode(uint16_t pin, uint8_t mode);
@@ -64,6 +64,8 @@ public:
     float getOilPressurePsi() const { return _desc[SLOT_OIL].value; }
     bool isOilPressureLow() const { return _desc[SLOT_OIL].inError; }
     uint16_t getRawAdc(uint8_t channel) const;
+    // MAP calibration applied to a voltage sampled elsewhere (crank-synchronous windows)
+    float calibrateMap(float voltage) { return calibrate(_desc[SLOT_MAP], voltage); }
 
     // --- Backward-compatible setters (update descriptor calibration) ---
     void setMapCalibration(float vMin, float vMax, float pMin, float pMax);
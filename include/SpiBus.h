@@ -0,0 +1,137 @@
+#pragma once
+
+#include <Arduino.h>
+#include <driver/spi_master.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+
+class SpiFuture;
+
+// HSPI bus manager. One Core 0 task owns the bus and is the only code that touches it;
+// everyone else queues transactions. Two queues: URGENT (coil/injector expander writes)
+// is always drained before NORMAL (ADC reads, health checks, relays, config writes), so
+// an output edge waits behind at most the one transaction (or burst chunk) already on the wire.
+//
+// Transactions go out through the ESP-IDF master driver with DMA and hardware CS
+// (spi_device_queue_trans / get_trans_result) — the bus task sleeps while the bytes move.
+// Up to 4 bytes ride in the transaction's inline TX/RX words; longer ones (MCP23S17 INTF+
+// INTCAP burst) use the bus's own word-aligned DMA buffers, so nothing is allocated.
+//
+// Writes are fire-and-forget. A deferred write builds its bytes when the bus task reaches
+// it, so a value written late (an OLAT shadow) is never overtaken by an older copy still in
+// a queue. Reads complete a SpiFuture the caller waits on.
+//
+// A burst is one queue entry for a run of short transactions on one device (MCP3204 channel
+// scan with oversampling): built and collected by callbacks in the bus task, queued to the
+// driver BURST_CHUNK at a time and run back to back from its interrupt while the task sleeps
+// — no request queue round trip per conversion, and no busy-wait. Urgent writes queued
+// meanwhile are served between chunks, never behind the whole burst.
+//
+// Queueing is safe from any task, including the Core 1 real-time task; not from an ISR.
+class SpiBus {
+public:
+    static const uint8_t MAX_DEVICES = 3;       // Hardware CS lines on SPI3 (HSPI)
+    static const uint8_t MAX_LEN = 6;           // Longest transaction: MCP23S17 4-register burst
+    static const uint8_t INVALID_DEVICE = 0xFF;
+    static const uint8_t URGENT_QUEUE_LEN = 16;
+    static const uint8_t NORMAL_QUEUE_LEN = 32;
+    static const uint8_t BURST_CHUNK = 4;       // Burst steps on the wire between urgent checks
+
+    enum Priority : uint8_t {
+        PRIO_NORMAL = 0,
+        PRIO_URGENT = 1
+    };
+
+    // Deferred write: fill the TX bytes at send time, return the length (0 = skip)
+    typedef uint8_t (*FillFn)(void* arg, uint8_t* tx);
+    // Burst step: build TX for step i (length, 1-4; 0 = skip) / take its RX
+    typedef uint8_t (*StepFn)(void* arg, uint8_t i, uint8_t* tx);
+    typedef void (*CollectFn)(void* arg, uint8_t i, const uint8_t* rx);
+
+    static SpiBus& instance();
+
+    // Claims HSPI with DMA and starts the bus task. Call before any device begin().
+    bool begin(uint8_t sckPin, uint8_t misoPin, uint8_t mosiPin);
+    bool isRunning() const { return _task != nullptr; }
+
+    // Hardware CS device; returns a handle for the calls below, INVALID_DEVICE on failure
+    uint8_t addDevice(uint8_t csPin, uint32_t clockHz, uint8_t mode);
+
+    // false = not queued (bus not running, bad device, queue full); counted as dropped
+    bool write(uint8_t dev, const uint8_t* tx, uint8_t len, Priority prio = PRIO_NORMAL);
+    bool writeDeferred(uint8_t dev, FillFn fill, void* arg, Priority prio = PRIO_NORMAL,
+                       SpiFuture* done = nullptr);
+    bool transfer(uint8_t dev, const uint8_t* tx, uint8_t len, SpiFuture& result,
+                  Priority prio = PRIO_NORMAL);
+    // arg must outlive the burst — wait on done before releasing it
+    bool burst(uint8_t dev, uint8_t steps, StepFn step, CollectFn collect, void* arg,
+               SpiFuture& done, Priority prio = PRIO_NORMAL);
+
+    // Stats
+    uint32_t getTransactionCount() const { return _transactions; }
+    uint32_t getDroppedCount() const { return _dropped; }
+    uint32_t getUrgentWaitMaxUs() const { return _urgentWaitMaxUs; }     // Queued -> on the wire
+    void resetStats() { _urgentWaitMaxUs = 0; _dropped = 0; }
+
+private:
+    SpiBus() = default;
+
+    struct Request {
+        uint8_t dev;
+        uint8_t len;
+        uint8_t prio;
+        uint8_t tx[MAX_LEN];
+        FillFn fill;
+        void* fillArg;          // Also the burst callbacks' arg
+        StepFn step;            // Burst: len = steps
+        CollectFn collect;
+        SpiFuture* future;
+        int64_t queuedUs;
+    };
+
+    spi_device_handle_t _dev[MAX_DEVICES] = {};
+    uint8_t _deviceCount = 0;
+    QueueHandle_t _urgentQueue = nullptr;
+    QueueHandle_t _normalQueue = nullptr;
+    SemaphoreHandle_t _pending = nullptr;   // Counts requests across both queues
+    TaskHandle_t _task = nullptr;
+    WORD_ALIGNED_ATTR uint8_t _dmaTx[8] = {};  // Bus task only: transactions over 4 bytes
+    WORD_ALIGNED_ATTR uint8_t _dmaRx[8] = {};
+    spi_transaction_t _burstTrans[BURST_CHUNK] = {};    // Bus task only: a burst chunk in the driver
+
+    volatile uint32_t _transactions = 0;
+    volatile uint32_t _dropped = 0;
+    volatile uint32_t _urgentWaitMaxUs = 0;
+
+    bool enqueue(Request& r);
+    void serve(Request& r);
+    void serveBurst(Request& r);
+    void serveUrgent();
+    static void busTask(void* param);
+};
+
+// Completion of one queued transaction. A stack object owned by the caller: wait() blocks
+// until the bus task has run the transaction, and the destructor waits too, so the bus task
+// never writes into a dead frame. The master driver always completes a queued transaction.
+class SpiFuture {
+public:
+    SpiFuture();
+    ~SpiFuture();
+
+    bool wait();            // false if the transaction was never queued
+    bool isDone() const { return _done; }
+    bool isPending() const { return _queued && !_done; }   // Queued, not yet completed
+    const uint8_t* rx() const { return _rx; }
+    uint8_t operator[](uint8_t i) const { return i < SpiBus::MAX_LEN ? _rx[i] : 0; }
+
+private:
+    friend class SpiBus;
+    StaticSemaphore_t _semBuf;
+    SemaphoreHandle_t _sem;
+    volatile bool _queued;
+    volatile bool _done;
+    uint8_t _rx[SpiBus::MAX_LEN];
+
+    SpiFuture(const SpiFuture&) = delete;
+    SpiFuture& operator=(const SpiFuture&) = delete;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Arduino.h>
+#include "PinExpander.h"
 
 class ADS1115Reader;
 struct ProjectInfo;
@@ -80,6 +81,7 @@ private:
 
     // Pin assignments
     uint16_t _ssAPin = 0, _ssBPin = 0, _ssCPin = 0, _ssDPin = 0;
+    PinHandle _ssA, _ssB, _ssC, _ssD;   // Resolved at begin()
     uint8_t _tccPin = 0, _epcPin = 0;
     uint8_t _ossPin = 0, _tssPin = 0;
 
@@ -131,7 +133,7 @@ private:
     void applyShiftSolenoids();
     void updateTCC(uint16_t engineRpm);
     void updateEPC(float tps);
-    void setSolenoid(uint16_t pin, bool on);
+    void setSolenoid(PinBatch& batch, const PinHandle& pin, bool on);
 
     // TFT thermistor conversion
     static float tftAdcToTempF(float millivolts);
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <Arduino.h>
+#include "CrankAngle.h"
+
+// Trigger wheel types (ProjectInfo::triggerType)
+enum TriggerType : uint8_t {
+    TRIG_MISSING_TOOTH = 0,   // N-M wheel from crankTeeth/crankMissing (36-1, 60-2, 24-1, 12-1, ...)
+    TRIG_4_PLUS_1      = 1,   // 4 even teeth + 1 extra sync tooth
+    TRIG_GM_24X        = 2,   // 24 even teeth, position from the 1x cam edge
+    TRIG_FORD_EDIS     = 3    // 36-1, missing tooth 90 deg BTDC #1
+};
+
+// Crank trigger decoder. One specialized implementation per wheel pattern is picked
+// once by create(); the crank ISR then makes a single virtual call per edge, and each
+// implementation has its tooth count and gap ratio as compile-time constants.
+//
+// Angle convention shared by every consumer: tooth position 0 is the sync tooth, which
+// sits tdcOffsetDeg before TDC #1. Crank angle ATDC of tooth n = n * degPerTooth - tdcOffsetDeg.
+class TriggerDecoder {
+public:
+    enum SyncState : uint8_t { LOST, SYNCING, SYNCED };
+
+    enum Edge : uint8_t {
+        EDGE_TOOTH,   // Regular tooth
+        EDGE_GAP,     // First tooth after the missing-tooth gap (period spans missing+1 teeth)
+        EDGE_EXTRA    // Extra sync tooth — not an angle tooth, ignore for timing
+    };
+
+    struct Geometry {
+        uint8_t teeth;          // Tooth positions per crank revolution (including missing)
+        uint8_t missing;        // Missing teeth at the gap (0 = evenly spaced)
+        float degPerTooth;
+        float tdcOffsetDeg;     // Sync tooth is this many degrees BTDC #1
+
+        // tdcOffsetDeg in CrankAngle units, wrapped into [0, 360) deg (negative offsets allowed)
+        uint16_t tdcOffsetUnits() const {
+            return CrankAngle::fromDeg(tdcOffsetDeg, CrankAngle::UNITS_PER_REV).units;
+        }
+    };
+
+    virtual ~TriggerDecoder() {}
+
+    static TriggerDecoder* create(uint8_t type, uint8_t teeth, uint8_t missing);
+
+    // Hot path (crank ISR). refPeriodUs = recent regular tooth period (0 = unknown)
+    virtual Edge IRAM_ATTR onTooth(uint32_t periodUs, uint32_t refPeriodUs) = 0;
+    // Cam edge (cam ISR) — used by cam-synced wheels, ignored otherwise
+    virtual void IRAM_ATTR onCamEdge() {}
+
+    void reset() { _sync = LOST; _toothPos = 0; _count = 0; }
+
+    const char* name() const { return _name; }
+    const Geometry& geometry() const { return _geo; }
+    SyncState getSyncState() const { return _sync; }
+    // Tooth position is usable for firing: after the first gap for self-syncing wheels,
+    // only once SYNCED for wheels that need the cam to find position
+    bool isPositionKnown() const { return _sync >= _positionFrom; }
+    uint16_t getToothPosition() const { return _toothPos; }
+    // Largest noise-blanking window this pattern tolerates, fraction of a tooth period in Q8
+    uint8_t getMaxBlankQ8() const { return _maxBlankQ8; }
+
+    // Crank angle ATDC #1 of a tooth position, [0, 360)
+    float toothAngleDeg(uint16_t pos) const {
+        float a = pos * _geo.degPerTooth - _geo.tdcOffsetUnits() / (float)CrankAngle::UNITS_PER_DEG;
+        return (a < 0) ? a + 360.0f : a;
+    }
+
+protected:
+    TriggerDecoder(const char* name, uint8_t teeth, uint8_t missing, float tdcOffsetDeg,
+                   SyncState positionFrom = SYNCING)
+        : _name(name), _sync(LOST), _positionFrom(positionFrom), _toothPos(0), _count(0),
+          _maxBlankQ8(128) {
+        _geo.teeth = teeth;
+        _geo.missing = missing;
+        _geo.degPerTooth = 360.0f / teeth;
+        _geo.tdcOffsetDeg = tdcOffsetDeg;
+    }
+
+    // N-M sync state machine. gapNum = 2 x gap threshold ratio, e.g. 3 -> gap if period > 1.5x ref.
+    // Never below 3: an evenly spaced wheel would otherwise see a gap in every slow tooth.
+    // Compile-time wheels pass constants so the comparisons fold.
+    inline Edge IRAM_ATTR missingToothStep(uint32_t periodUs, uint32_t refPeriodUs,
+                                           uint8_t expectedTeeth, uint8_t gapNum) {
+        bool isGap = (refPeriodUs > 0) && (periodUs * 2 > refPeriodUs * gapNum);
+
+        switch (_sync) {
+            case LOST:
+                if (isGap) {
+                    _sync = SYNCING;
+                    _count = 0;
+                    _toothPos = 0;
+                }
+                break;
+
+            case SYNCING:
+                _count++;
+                _toothPos = _count;
+                if (isGap) {
+                    // Verify: gap should come after (teeth - missing) real teeth
+                    if (_count == expectedTeeth) _sync = SYNCED;
+                    _count = 0;
+                    _toothPos = 0;
+                }
+                break;
+
+            case SYNCED:
+                _count++;
+                _toothPos = _count;
+                if (isGap) {
+                    if (_count != expectedTeeth) _sync = LOST;
+                    _count = 0;
+                    _toothPos = 0;
+                }
+                break;
+        }
+        return isGap ? EDGE_GAP : EDGE_TOOTH;
+    }
+
+    const char* _name;
+    Geometry _geo;
+    volatile SyncState _sync;
+    SyncState _positionFrom;
+    volatile uint16_t _toothPos;
+    uint8_t _count;
+    uint8_t _maxBlankQ8;
+};
+
+// N-M missing-tooth wheel with the pattern fixed at compile time
+template <uint8_t TEETH, uint8_t MISSING>
+class MissingToothDecoder : public TriggerDecoder {
+public:
+    explicit MissingToothDecoder(const char* name, float tdcOffsetDeg = 0.0f)
+        : TriggerDecoder(name, TEETH, MISSING, tdcOffsetDeg) {}
+
+    Edge IRAM_ATTR onTooth(uint32_t periodUs, uint32_t refPeriodUs) override {
+        // Gap threshold halfway between one tooth and the gap: (1 + (MISSING+1)) / 2
+        return missingToothStep(periodUs, refPeriodUs, TEETH - MISSING, MISSING + 2);
+    }
+};
+
+// Any other N-M wheel from config — same state machine with runtime constants
+class GenericMissingToothDecoder : public TriggerDecoder {
+public:
+    GenericMissingToothDecoder(uint8_t teeth, uint8_t missing)
+        : TriggerDecoder("N-M", teeth, missing, 0.0f), _gapNum(missing < 1 ? 3 : missing + 2) {}
+
+    Edge IRAM_ATTR onTooth(uint32_t periodUs, uint32_t refPeriodUs) override {
+        return missingToothStep(periodUs, refPeriodUs, _geo.teeth - _geo.missing, _gapNum);
+    }
+
+private:
+    uint8_t _gapNum;
+};
+
+// TEETH even teeth plus one extra tooth just after position 0
+template <uint8_t TEETH>
+class PlusOneDecoder : public TriggerDecoder {
+public:
+    explicit PlusOneDecoder(const char* name, float tdcOffsetDeg = 0.0f)
+        : TriggerDecoder(name, TEETH, 0, tdcOffsetDeg) {
+        _maxBlankQ8 = 26;   // The extra tooth can sit anywhere under half a tooth — blank 10% at most
+    }
+
+    Edge IRAM_ATTR onTooth(uint32_t periodUs, uint32_t refPeriodUs) override {
+        // Extra tooth: well under half a regular tooth period
+        if (refPeriodUs > 0 && periodUs < (refPeriodUs >> 1)) {
+            if (_sync == LOST) {
+                _sync = SYNCING;
+            } else if (_sync == SYNCING) {
+                if (_count == TEETH) _sync = SYNCED;
+            } else if (_count != TEETH) {
+                _sync = LOST;
+            }
+            // The tooth just before the extra one was position 0
+            _count = 0;
+            _toothPos = 0;
+            return EDGE_EXTRA;
+        }
+        if (_sync != LOST) {
+            _count++;
+            if (_count > TEETH) _sync = LOST;  // Extra tooth never came
+            _toothPos = (_count >= TEETH) ? 0 : _count;
+        }
+        return EDGE_TOOTH;
+    }
+};
+
+// TEETH even teeth, position 0 = first crank tooth after the cam edge
+template <uint8_t TEETH>
+class CamSyncDecoder : public TriggerDecoder {
+public:
+    explicit CamSyncDecoder(const char* name, float tdcOffsetDeg = 0.0f)
+        : TriggerDecoder(name, TEETH, 0, tdcOffsetDeg, SYNCED) {}
+
+    Edge IRAM_ATTR onTooth(uint32_t, uint32_t) override {
+        if (_sync == LOST) {
+            _sync = SYNCING;  // Turning — wait for the cam edge
+            _count = 0;
+        } else {
+            _count = (_count + 1 >= TEETH) ? 0 : _count + 1;
+        }
+        _toothPos = _count;
+        return EDGE_TOOTH;
+    }
+
+    void IRAM_ATTR onCamEdge() override {
+        if (_sync == LOST) return;
+        // Cam edge once per 720 deg must land just before a wrap to position 0
+        bool aligned = (_count == TEETH - 1);
+        _count = TEETH - 1;
+        _toothPos = _count;
+        if (_sync == SYNCING) _sync = SYNCED;
+        else if (!aligned) _sync = SYNCING;
+    }
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SD.h>
+
+class AsyncWebSocket;
+
+// Single-producer/single-consumer ring. Producer and consumer each own one index;
+// acquire/release on the indices is the only synchronization — no locks, no critical sections.
+template <typename T, uint16_t SIZE>
+class SpscRing {
+    static_assert((SIZE & (SIZE - 1)) == 0, "SpscRing size must be a power of two");
+public:
+    SpscRing() : _head(0), _tail(0) {}
+
+    inline bool IRAM_ATTR push(const T& item) {
+        uint16_t head = _head;
+        uint16_t next = (head + 1) & (SIZE - 1);
+        if (next == __atomic_load_n(&_tail, __ATOMIC_ACQUIRE)) return false;  // Full
+        _buf[head] = item;
+        __atomic_store_n(&_head, next, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    inline bool peek(T& item) const {
+        uint16_t tail = _tail;
+        if (tail == __atomic_load_n(&_head, __ATOMIC_ACQUIRE)) return false;
+        item = _buf[tail];
+        return true;
+    }
+
+    inline void drop() { __atomic_store_n(&_tail, (uint16_t)((_tail + 1) & (SIZE - 1)), __ATOMIC_RELEASE); }
+
+    // Consumer side only
+    void clear() { __atomic_store_n(&_tail, __atomic_load_n(&_head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE); }
+
+private:
+    T _buf[SIZE];
+    uint16_t _head;   // Written by producer
+    uint16_t _tail;   // Written by consumer
+};
+
+// Continuous tooth/composite logger. Crank and cam ISRs (same interrupt level, never
+// nest) feed one ring; the Core 1 real-time task (spark, injector) feeds another, so each
+// ring has exactly one producer context. A low-priority Core 0 task merges both by
+// timestamp and streams binary frames to the /ws/trigger WebSocket and/or an SD file.
+//
+// Frame: FrameHeader followed by count x Record, little endian.
+class TriggerLogger {
+public:
+    enum EventType : uint8_t {
+        EVT_CRANK     = 0,    // id = tooth position, value = sync state | EVT_FLAG_*
+        EVT_CAM       = 1,    // id = cam tooth (0xFF = not synced), value = crank angle (CrankSensor ANGLE_UNITS)
+        EVT_DWELL     = 2,    // id = cylinder
+        EVT_SPARK     = 3,    // id = cylinder, value 1 = overdwell cutoff
+        EVT_INJ_OPEN  = 4,    // id = cylinder
+        EVT_INJ_CLOSE = 5,    // id = cylinder
+        EVT_STALL     = 6     // No tooth within the crank stall timeout
+    };
+    static const uint16_t EVT_FLAG_GAP   = 0x0100;
+    static const uint16_t EVT_FLAG_EXTRA = 0x0200;
+    static const uint16_t EVT_FLAG_NOISE = 0x0400;   // Edge rejected by the blanking window
+
+    struct __attribute__((packed)) Record {
+        uint32_t timeUs;      // esp_timer_get_time() low 32 bits (wraps every ~71 min)
+        uint8_t type;
+        uint8_t id;
+        uint16_t value;
+    };
+
+    struct __attribute__((packed)) FrameHeader {
+        uint8_t magic;        // 'T'
+        uint8_t version;      // FRAME_VERSION
+        uint16_t count;
+        uint32_t dropped;     // Records lost (full ring or slow client) since start()
+    };
+
+    static const uint8_t FRAME_VERSION = 1;
+    static const uint16_t ISR_RING_SIZE = 2048;     // ~58 revs of 36-1: 580 ms at 6000 RPM vs a 20 ms drain
+    static const uint16_t TASK_RING_SIZE = 512;
+    static const uint16_t FRAME_RECORDS = 256;
+    static const uint32_t DRAIN_INTERVAL_MS = 20;
+
+    TriggerLogger();
+
+    void begin();
+    void setWebSocket(AsyncWebSocket* ws) { _ws = ws; }
+
+    // sdFile = nullptr streams to WebSocket only
+    bool start(const char* sdFile = nullptr);
+    void stop();
+    bool isActive() const { return _active; }
+    uint32_t getRecordCount() const { return _records; }
+    uint32_t getDroppedCount() const { return _isrDropped + _taskDropped + _sinkDropped; }
+    const char* getSdFile() const { return _sdFile[0] ? _sdFile : ""; }
+
+    // Producers — a single flag test when logging is off
+    inline void IRAM_ATTR logIsrAt(int64_t timeUs, EventType type, uint8_t id, uint16_t value) {
+        if (!_active) return;
+        Record r = { (uint32_t)timeUs, type, id, value };
+        if (!_isrRing.push(r)) _isrDropped++;
+    }
+    inline void logTask(EventType type, uint8_t id, uint16_t value) {
+        if (!_active) return;
+        Record r = { (uint32_t)esp_timer_get_time(), type, id, value };
+        if (!_taskRing.push(r)) _taskDropped++;
+    }
+
+private:
+    SpscRing<Record, ISR_RING_SIZE> _isrRing;
+    SpscRing<Record, TASK_RING_SIZE> _taskRing;
+    volatile bool _active;
+    volatile bool _closePending;    // stop() requested — final drain, then close the file
+    volatile uint32_t _isrDropped;  // One counter per producer context
+    volatile uint32_t _taskDropped;
+    uint32_t _sinkDropped;          // Frames the WebSocket couldn't take (drain task)
+    uint32_t _records;
+    AsyncWebSocket* _ws;
+    char _sdFile[32];
+    fs::File _file;
+    TaskHandle_t _drainTask;
+    uint8_t* _frame;
+
+    static void drainTask(void* param);
+    void drain();
+    void flush(uint16_t count);
+};
+
+extern TriggerLogger TrigLog;
@@ -36,6 +36,7 @@ public:
 private:
     AsyncWebServer _server;
     AsyncWebSocket _ws;
+    AsyncWebSocket _wsTrigger;    // Binary composite-log frames (TriggerLogger)
 
     Scheduler* _ts;
     ECU* _ecu;
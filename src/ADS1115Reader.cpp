@@ -2,9 +2,21 @@
 #include "Logger.h"
 #include <Wire.h>
 
-ADS1115Reader::ADS1115Reader() : _ready(false) {}
+// Samples per second by config DR field (RATE_ADS1115_* >> 5)
+static const uint16_t ADS1115_SPS[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+
+ADS1115Reader::ADS1115Reader()
+    : _addr(0), _configBase(0), _convUs(0), _ready(false), _used(0), _busyCh(NO_CHANNEL),
+      _startUs(0), _errorRun(0), _conversions(0), _errors(0) {
+    memset(_periodUs, 0, sizeof(_periodUs));
+    memset(_lastStartUs, 0, sizeof(_lastStartUs));
+    memset(_samples, 0, sizeof(_samples));
+    memset((void*)_seq, 0, sizeof(_seq));
+    memset((void*)_hasSample, 0, sizeof(_hasSample));
+}
 
 bool ADS1115Reader::begin(uint8_t addr, adsGain_t gain, uint16_t rate) {
+    _addr = addr;
     _ready = _ads.begin(addr);
     if (_ready) {
         // Verify the device is real — floating I2C bus can cause false positive ACK
@@ -31,26 +43,142 @@ bool ADS1115Reader::begin(uint8_t addr, adsGain_t gain, uint16_t rate) {
         }
         _ads.setGain(gain);
         _ads.setDataRate(rate);
-        Log.info("ADS", "ADS1115 initialized at 0x%02X (config=0x%04X)", addr, configVal);
+
+        // Round-robin config word: single-shot, comparator (ALERT/RDY) disabled
+        _configBase = ADS1X15_REG_CONFIG_CQUE_NONE | ADS1X15_REG_CONFIG_CLAT_NONLAT |
+                      ADS1X15_REG_CONFIG_CPOL_ACTVLOW | ADS1X15_REG_CONFIG_CMODE_TRAD |
+                      ADS1X15_REG_CONFIG_MODE_SINGLE | (uint16_t)gain | rate;
+        // Internal oscillator is +/-10%, plus the wakeup from power-down
+        _convUs = 1100000UL / ADS1115_SPS[(rate >> 5) & 7] + 50;
+        Log.info("ADS", "ADS1115 initialized at 0x%02X (config=0x%04X, %d SPS)",
+                 addr, configVal, ADS1115_SPS[(rate >> 5) & 7]);
     } else {
         Log.warn("ADS", "ADS1115 not found at 0x%02X", addr);
     }
     return _ready;
 }
 
-int16_t ADS1115Reader::readChannel(uint8_t ch) {
-    if (!_ready || ch > 3) return 0;
-    _ads.startADCReading(MUX_BY_CHANNEL[ch], false);
-    uint32_t start = millis();
-    while (!_ads.conversionComplete()) {
-        if (millis() - start > ADS_READ_TIMEOUT_MS) {
-            return 0;
+// ---- Acquisition (I2cBus task) ----
+
+void ADS1115Reader::setSamplePeriodMs(uint8_t ch, uint16_t ms) {
+    if (ch > 3) return;
+    _periodUs[ch] = (uint32_t)ms * 1000;
+    __atomic_fetch_or(&_used, (uint8_t)(1 << ch), __ATOMIC_RELAXED);
+}
+
+bool ADS1115Reader::poll() {
+    if (!_ready) return true;
+    int64_t nowUs = esp_timer_get_time();
+
+    // Collect the conversion in flight once its data-rate time has passed
+    if (_busyCh != NO_CHANNEL) {
+        if (nowUs - _startUs < (int64_t)_convUs) return true;
+        uint16_t raw;
+        bool ok = readRegister(ADS1X15_REG_POINTER_CONVERT, raw);
+        if (ok) publish(_busyCh, (int16_t)raw, _startUs);
+        _busyCh = NO_CHANNEL;
+        if (!ok) {
+            _errors++;
+            _errorRun++;
+            return false;
+        }
+    }
+
+    uint8_t ch = nextChannel(nowUs);
+    if (ch == NO_CHANNEL) return true;
+    if (!startConversion(ch)) {
+        _errors++;
+        _errorRun++;
+        return false;
+    }
+    _busyCh = ch;
+    _startUs = nowUs;
+    _lastStartUs[ch] = nowUs;
+    _errorRun = 0;
+    return true;
+}
+
+// Most overdue channel in the plan, NO_CHANNEL if none is due. Period-0 channels are always
+// due, so they share the bus evenly.
+uint8_t ADS1115Reader::nextChannel(int64_t nowUs) const {
+    uint8_t used = _used;
+    uint8_t best = NO_CHANNEL;
+    int64_t bestLate = -1;
+    for (uint8_t ch = 0; ch < 4; ch++) {
+        if (!(used & (1 << ch))) continue;
+        int64_t late = nowUs - _lastStartUs[ch] - (int64_t)_periodUs[ch];
+        if (late > bestLate) {
+            bestLate = late;
+            best = ch;
         }
     }
-    return _ads.getLastConversionResults();
+    return best;
 }
 
+void ADS1115Reader::publish(uint8_t ch, int16_t raw, int64_t timeUs) {
+    // Single writer (this task): count odd, write, count even
+    portENTER_CRITICAL(&_publishLock);
+    uint32_t seq = _seq[ch];
+    __atomic_store_n(&_seq[ch], seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    _samples[ch].raw = raw;
+    _samples[ch].timeUs = timeUs;
+    __atomic_store_n(&_seq[ch], seq + 2, __ATOMIC_RELEASE);
+    portEXIT_CRITICAL(&_publishLock);
+    _hasSample[ch] = true;
+    _conversions++;
+}
+
+bool ADS1115Reader::startConversion(uint8_t ch) {
+    uint16_t cfg = _configBase | MUX_BY_CHANNEL[ch] | ADS1X15_REG_CONFIG_OS_SINGLE;
+    Wire.beginTransmission(_addr);
+    Wire.write(ADS1X15_REG_POINTER_CONFIG);
+    Wire.write((uint8_t)(cfg >> 8));
+    Wire.write((uint8_t)(cfg & 0xFF));
+    return Wire.endTransmission() == 0;
+}
+
+bool ADS1115Reader::readRegister(uint8_t reg, uint16_t& val) {
+    Wire.beginTransmission(_addr);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0) return false;  // repeated start
+    if (Wire.requestFrom(_addr, (uint8_t)2) != 2) return false;
+    uint8_t hi = Wire.read();
+    uint8_t lo = Wire.read();
+    val = ((uint16_t)hi << 8) | lo;
+    return true;
+}
+
+// ---- Readers (any task) ----
+
 float ADS1115Reader::readMillivolts(uint8_t ch) {
     if (!_ready || ch > 3) return 0.0f;
-    return _ads.computeVolts(readChannel(ch)) * 1000.0f;
+    if (!(_used & (1 << ch))) __atomic_fetch_or(&_used, (uint8_t)(1 << ch), __ATOMIC_RELAXED);
+    Sample s;
+    if (!getSample(ch, s)) return 0.0f;
+    return toMillivolts(s.raw);
+}
+
+bool ADS1115Reader::getSample(uint8_t ch, Sample& out) const {
+    if (!_ready || ch > 3 || !_hasSample[ch]) return false;
+    // Seqlock read — the bus task may publish on the other core mid-copy
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&_seq[ch], __ATOMIC_ACQUIRE);
+        out = _samples[ch];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&_seq[ch], __ATOMIC_RELAXED));
+    return true;
+}
+
+float ADS1115Reader::readMillivoltsAfter(uint8_t ch, int64_t sinceUs, uint32_t timeoutMs) {
+    if (!_ready || ch > 3) return 0.0f;
+    if (!(_used & (1 << ch))) __atomic_fetch_or(&_used, (uint8_t)(1 << ch), __ATOMIC_RELAXED);
+    uint32_t start = millis();
+    Sample s;
+    while (!getSample(ch, s) || s.timeUs < sinceUs) {
+        if (millis() - start > timeoutMs) return 0.0f;
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    return toMillivolts(s.raw);
 }
@@ -1,6 +1,7 @@
 #include "CJ125Controller.h"
 #include "ADS1115Reader.h"
 #include "PinExpander.h"
+#include "NativeAdc.h"
 #include "Logger.h"
 
 // Bosch LSU 4.9 characteristic curve: 10-bit ADC values and corresponding lambda.
@@ -52,9 +53,12 @@ void CJ125Controller::begin(uint16_t spiSS1, uint16_t spiSS2,
     _banks[1].ledcChannel = 2;
 
     for (uint8_t i = 0; i < 2; i++) {
+        _banks[i].ss.attach(_banks[i].spiSS);
+
         // Configure UA ADC pins
         pinMode(_banks[i].uaPin, INPUT);
         analogSetPinAttenuation(_banks[i].uaPin, ADC_11db);
+        NativeAdc::instance().addPin(_banks[i].uaPin);
 
         // Configure heater PWM: 100Hz, 8-bit resolution via LEDC
         ledcSetup(_banks[i].ledcChannel, 100, 8);
@@ -75,18 +79,19 @@ void CJ125Controller::begin(uint16_t spiSS1, uint16_t spiSS2,
 
 uint16_t CJ125Controller::spiTransfer(uint8_t bank, uint16_t data) {
     _spi->beginTransaction(SPISettings(125000, MSBFIRST, SPI_MODE1));
-    xDigitalWrite(_banks[bank].spiSS, LOW);
+    // SS is an expander pin: wait for it to reach the pin before clocking the CJ125
+    _banks[bank].ss.writeSync(LOW);
     delayMicroseconds(1);
     uint8_t msb = _spi->transfer((data >> 8) & 0xFF);
     uint8_t lsb = _spi->transfer(data & 0xFF);
-    xDigitalWrite(_banks[bank].spiSS, HIGH);
+    _banks[bank].ss.writeSync(HIGH);
     _spi->endTransaction();
     return (msb << 8) | lsb;
 }
 
 uint16_t CJ125Controller::readUA(uint8_t bank) const {
     // Read 12-bit 3.3V ADC through 2:3 voltage divider, convert to 10-bit 5V equivalent
-    uint16_t adc12bit = analogRead(_banks[bank].uaPin);
+    uint16_t adc12bit = NativeAdc::instance().read(_banks[bank].uaPin);
     int val = (int)(adc12bit * (5.0f / 3.3f) * (1023.0f / 4095.0f));
     return (uint16_t)constrain(val, 0, 1023);
 }
@@ -161,7 +166,9 @@ void CJ125Controller::updateBank(uint8_t bank, float batteryVoltage) {
             // Read reference values
             b.uaRef = readUA(bank);
             if (_ads && _ads->isReady()) {
-                float urMv = _ads->readMillivolts(bank);
+                // A conversion started after the settle delay — the last published sample
+                // may predate the calibrate command. UR is planned at 100ms.
+                float urMv = _ads->readMillivoltsAfter(bank, esp_timer_get_time(), 150);
                 int ur10 = (int)(urMv * 1023.0f / 5000.0f);
                 b.urRef = (uint16_t)constrain(ur10, 0, 1023);
             }
@@ -0,0 +1,84 @@
+#include "CamDecoder.h"
+
+// Tooth angles, engine-cycle degrees ATDC #1 compression at zero cam advance
+static const uint16_t CAM_SINGLE_TEETH[]   = { 0 };
+static const uint16_t CAM_4_PLUS_1_TEETH[] = { 0, 30, 180, 360, 540 };   // Extra tooth 30 deg after tooth 0
+static const uint16_t CAM_3_TOOTH_TEETH[]  = { 0, 90, 330 };              // Gaps 90 / 240 / 390
+
+template <uint8_t N>
+static CamDecoder* pattern(const char* name, const uint16_t (&teeth)[N]) {
+    return new CamDecoder(name, teeth, N);
+}
+
+CamDecoder* CamDecoder::create(uint8_t type) {
+    switch (type) {
+        case CAM_4_PLUS_1: return pattern("4+1", CAM_4_PLUS_1_TEETH);
+        case CAM_3_TOOTH:  return pattern("3-tooth", CAM_3_TOOTH_TEETH);
+        default:           return pattern("single", CAM_SINGLE_TEETH);
+    }
+}
+
+CamDecoder::CamDecoder(const char* name, const uint16_t* toothDeg, uint8_t count)
+    : _name(name), _count(count < MAX_TEETH ? count : MAX_TEETH), _synced(false), _tooth(0),
+      _prevPeriodUs(0), _syncLosses(0) {
+    uint16_t gap[MAX_TEETH];
+    for (uint8_t i = 0; i < _count; i++) {
+        _toothUnits[i] = toothDeg[i] * ANGLE_UNITS_PER_DEG;
+        uint16_t prevDeg = toothDeg[(i + _count - 1) % _count];
+        gap[i] = (toothDeg[i] + 720 - prevDeg) % 720;
+        if (gap[i] == 0) gap[i] = 720;
+    }
+    // Expected period ratio on arrival at each tooth, with a +/-20% window for acceleration
+    for (uint8_t i = 0; i < _count; i++) {
+        uint32_t ratio = ((uint32_t)gap[i] << RATIO_SHIFT) / gap[(i + _count - 1) % _count];
+        _ratioLo[i] = ratio * 4 / 5;
+        _ratioHi[i] = ratio * 6 / 5;
+    }
+    for (uint8_t i = 0; i < _count; i++) {
+        _unique[i] = true;
+        for (uint8_t j = 0; j < _count; j++) {
+            if (j != i && _ratioLo[i] <= _ratioHi[j] && _ratioLo[j] <= _ratioHi[i]) _unique[i] = false;
+        }
+    }
+}
+
+int8_t IRAM_ATTR CamDecoder::onEdge(uint32_t periodUs) {
+    if (_count == 1) {
+        // Nothing to match — every edge is the tooth
+        _synced = true;
+        _tooth = 0;
+        return 0;
+    }
+
+    uint32_t prev = _prevPeriodUs;
+    _prevPeriodUs = periodUs;
+    if (periodUs == 0 || prev == 0) {
+        _synced = false;      // Stopped or first edge — not a sync loss
+        return -1;
+    }
+
+    // Caller bounds periodUs to the signal timeout (< 16.7 s), so the Q8 shift can't overflow
+    uint32_t ratio = (periodUs << RATIO_SHIFT) / prev;
+
+    if (_synced) {
+        uint8_t next = _tooth + 1;
+        if (next >= _count) next = 0;
+        if (ratio >= _ratioLo[next] && ratio <= _ratioHi[next]) {
+            _tooth = next;
+            return next;
+        }
+        _synced = false;
+        _syncLosses++;
+    }
+
+    // Not synced: only a tooth with a ratio nothing else can produce fixes the position.
+    // Bounded by MAX_TEETH.
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_unique[i] && ratio >= _ratioLo[i] && ratio <= _ratioHi[i]) {
+            _tooth = i;
+            _synced = true;
+            return i;
+        }
+    }
+    return -1;
+}
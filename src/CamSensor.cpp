@@ -1,40 +1,88 @@
 #include "CamSensor.h"
 #include "CrankSensor.h"
 #include "Logger.h"
+#include "TriggerLogger.h"
 
 CamSensor* CamSensor::_instance = nullptr;
 
 CamSensor::CamSensor()
-    : _pin(0), _crankSensor(nullptr), _phase(PHASE_UNKNOWN),
-      _lastPulseToothPos(0), _lastPulseTimeUs(0), _pulseReceived(false) {}
+    : _pin(0), _crankSensor(nullptr), _decoder(CamDecoder::create(CAM_SINGLE)), _offsetUnits(0),
+      _phase(PHASE_UNKNOWN), _lastPulseToothPos(0), _lastPulseAngle(0), _lastPulseTimeUs(0),
+      _lastTooth(-1), _vvtUnits(0) {}
 
 CamSensor::~CamSensor() {
     if (_instance == this) {
         detachInterrupt(digitalPinToInterrupt(_pin));
         _instance = nullptr;
     }
+    delete _decoder;
 }
 
-void CamSensor::begin(uint8_t pin) {
+void CamSensor::begin(uint8_t pin, uint8_t camType, float offsetDeg) {
     _pin = pin;
-    _phase = PHASE_UNKNOWN;
-    _pulseReceived = false;
-    _lastPulseTimeUs = 0;
+    float off = configure(camType, offsetDeg);
 
     _instance = this;
     pinMode(_pin, INPUT_PULLUP);
     attachInterrupt(digitalPinToInterrupt(_pin), isrHandler, RISING);
 
-    Log.info("CAM", "Cam sensor on pin %d", _pin);
+    Log.info("CAM", "Cam sensor on pin %d (%s: %d teeth, offset %.1f deg)",
+             _pin, _decoder->name(), _decoder->getToothCount(), off);
+}
+
+float CamSensor::configure(uint8_t camType, float offsetDeg) {
+    delete _decoder;
+    _decoder = CamDecoder::create(camType);
+    // Wrapped into [0, 720) so the ISR works in one unsigned cycle range
+    float off = fmodf(offsetDeg, 720.0f);
+    if (off < 0) off += 720.0f;
+    _offsetUnits = (uint16_t)(off * CamDecoder::ANGLE_UNITS_PER_DEG + 0.5f) % CamDecoder::ANGLE_UNITS_PER_CYCLE;
+    _phase = PHASE_UNKNOWN;
+    _lastPulseTimeUs = 0;
+    _lastTooth = -1;
+    _vvtUnits = 0;
+    return off;
 }
 
 void IRAM_ATTR CamSensor::isrHandler() {
     if (!_instance) return;
-    _instance->_lastPulseTimeUs = esp_timer_get_time();
-    _instance->_pulseReceived = true;
-    if (_instance->_crankSensor) {
-        _instance->_lastPulseToothPos = _instance->_crankSensor->getToothPosition();
-    }
+    _instance->processEdge(esp_timer_get_time());
+}
+
+void IRAM_ATTR CamSensor::processEdge(int64_t nowUs) {
+    int64_t sinceLast = nowUs - _lastPulseTimeUs;
+    _lastPulseTimeUs = nowUs;
+
+    // Pattern position from the cam edges alone; a timed-out gap restarts sync
+    uint32_t periodUs = (sinceLast < (int64_t)SIGNAL_TIMEOUT_MS * 1000) ? (uint32_t)sinceLast : 0;
+    int8_t tooth = _decoder->onEdge(periodUs);
+    _lastTooth = tooth;
+
+    CrankSensor* crank = _crankSensor;
+    if (!crank) return;
+    _lastPulseToothPos = crank->getToothPosition();
+    uint16_t angle = crank->onCamEdge(nowUs, tooth == 0);
+    _lastPulseAngle = angle;
+    TrigLog.logIsrAt(nowUs, TriggerLogger::EVT_CAM, (uint8_t)tooth, angle);
+    if (tooth < 0 || !crank->isPositionKnown()) return;
+
+    // The edge belongs to whichever crank revolution puts it nearest the tooth's nominal
+    // cycle angle; the remainder is the cam position (VVT). Valid for +/-180 deg of cam error.
+    // Phase is resolved here, not on the next 10ms update — sequential from the next tooth.
+    const int32_t cycle = CamDecoder::ANGLE_UNITS_PER_CYCLE;
+    int32_t diff = (int32_t)angle - _decoder->getToothAngleUnits(tooth) - _offsetUnits;
+    if (diff < 0) diff += cycle;
+    if (diff < 0) diff += cycle;
+    // diff in [0, 720): rev 0 puts the edge diff away, rev 1 diff + 360
+    uint8_t rev;
+    if (diff < cycle / 4)            { rev = 0; }
+    else if (diff < cycle * 3 / 4)   { rev = 1; diff -= cycle / 2; }
+    else                             { rev = 0; diff -= cycle; }
+    crank->setCamPhase(angle, rev);
+    _vvtUnits = (int16_t)-diff;   // Early edge = advanced
+    // For a 4-stroke engine, cam rotates at half crank speed
+    // Phase 0: edge in the compression TDC #1 revolution, Phase 1: exhaust revolution
+    _phase = rev ? PHASE_1 : PHASE_0;
 }
 
 bool CamSensor::isPresent() const {
@@ -49,27 +97,13 @@ bool CamSensor::hasCamSignal() const {
 }
 
 void CamSensor::update() {
-    // Check for timeout — lose cam signal
+    // Check for timeout — lose cam signal and fall back to wasted spark / batch fuel
     if (_lastPulseTimeUs > 0) {
         int64_t elapsed = esp_timer_get_time() - _lastPulseTimeUs;
         if (elapsed > (int64_t)SIGNAL_TIMEOUT_MS * 1000) {
             _phase = PHASE_UNKNOWN;
-            return;
-        }
-    }
-
-    // Process new cam pulse
-    if (_pulseReceived) {
-        _pulseReceived = false;
-        // Determine phase based on crank tooth position at cam pulse
-        // For a 4-stroke engine, cam rotates at half crank speed
-        // Phase 0: compression TDC for cylinder 1
-        // Phase 1: exhaust TDC for cylinder 1
-        if (_crankSensor && _crankSensor->isSynced()) {
-            uint16_t toothPos = _lastPulseToothPos;
-            uint8_t halfTeeth = _crankSensor->getTotalTeeth() / 2;
-            // Cam pulse in first half of crank revolution = Phase 0
-            _phase = (toothPos < halfTeeth) ? PHASE_0 : PHASE_1;
+            _lastTooth = -1;
+            if (_crankSensor) _crankSensor->clearPhase();
         }
     }
 }
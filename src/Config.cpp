@@ -184,6 +184,10 @@ bool Config::loadConfig(const char* filename, ProjectInfo& proj) {
     }
     proj.crankTeeth = doc["engine"]["crankTeeth"] | 36;
     proj.crankMissing = doc["engine"]["crankMissing"] | 1;
+    proj.triggerType = doc["engine"]["triggerType"] | 0;
+    proj.camType = doc["engine"]["camType"] | 0;
+    proj.camOffsetDeg = doc["engine"]["camOffsetDeg"] | 0.0f;
+    proj.triggerBlankPct = doc["engine"]["triggerBlankPct"] | 25;
     proj.hasCamSensor = doc["engine"]["hasCamSensor"] | true;
     proj.displacement = doc["engine"]["displacement"] | 5700;
     proj.injectorFlowCcMin = doc["engine"]["injectorFlowCcMin"] | 240.0f;
@@ -202,6 +206,10 @@ bool Config::loadConfig(const char* filename, ProjectInfo& proj) {
     proj.mapVoltageMax = doc["map"]["voltageMax"] | 4.5f;
     proj.mapPressureMinKpa = doc["map"]["pressureMinKpa"] | 10.0f;
     proj.mapPressureMaxKpa = doc["map"]["pressureMaxKpa"] | 105.0f;
+    proj.mcp3204Oversample = doc["map"]["mcp3204Oversample"] | 4;
+    proj.mapSyncSamples = doc["map"]["syncSamples"] | 4;
+    proj.mapSyncStartDeg = doc["map"]["syncStartDeg"] | 0.0f;
+    proj.mapSyncWindowDeg = doc["map"]["syncWindowDeg"] | 0.0f;
 
     // O2
     proj.o2AfrAt0v = doc["o2"]["afr_at_0v"] | 10.0f;
@@ -380,6 +388,10 @@ bool Config::saveConfig(const char* filename, ProjectInfo& proj) {
     for (uint8_t i = 0; i < proj.cylinders; i++) fo.add(proj.firingOrder[i]);
     engine["crankTeeth"] = proj.crankTeeth;
     engine["crankMissing"] = proj.crankMissing;
+    engine["triggerType"] = proj.triggerType;
+    engine["camType"] = proj.camType;
+    engine["camOffsetDeg"] = proj.camOffsetDeg;
+    engine["triggerBlankPct"] = proj.triggerBlankPct;
     engine["hasCamSensor"] = proj.hasCamSensor;
     engine["displacement"] = proj.displacement;
     engine["injectorFlowCcMin"] = proj.injectorFlowCcMin;
@@ -399,6 +411,10 @@ bool Config::saveConfig(const char* filename, ProjectInfo& proj) {
     map["voltageMax"] = proj.mapVoltageMax;
     map["pressureMinKpa"] = proj.mapPressureMinKpa;
     map["pressureMaxKpa"] = proj.mapPressureMaxKpa;
+    map["mcp3204Oversample"] = proj.mcp3204Oversample;
+    map["syncSamples"] = proj.mapSyncSamples;
+    map["syncStartDeg"] = proj.mapSyncStartDeg;
+    map["syncWindowDeg"] = proj.mapSyncWindowDeg;
 
     JsonObject o2 = doc["o2"].to<JsonObject>();
     o2["afr_at_0v"] = proj.o2AfrAt0v;
@@ -528,6 +544,10 @@ bool Config::updateConfig(const char* filename, ProjectInfo& proj) {
     for (uint8_t i = 0; i < proj.cylinders; i++) fo.add(proj.firingOrder[i]);
     engine["crankTeeth"] = proj.crankTeeth;
     engine["crankMissing"] = proj.crankMissing;
+    engine["triggerType"] = proj.triggerType;
+    engine["camType"] = proj.camType;
+    engine["camOffsetDeg"] = proj.camOffsetDeg;
+    engine["triggerBlankPct"] = proj.triggerBlankPct;
     engine["hasCamSensor"] = proj.hasCamSensor;
     engine["displacement"] = proj.displacement;
     engine["injectorFlowCcMin"] = proj.injectorFlowCcMin;
@@ -571,6 +591,10 @@ bool Config::updateConfig(const char* filename, ProjectInfo& proj) {
     doc["map"]["voltageMax"] = proj.mapVoltageMax;
     doc["map"]["pressureMinKpa"] = proj.mapPressureMinKpa;
     doc["map"]["pressureMaxKpa"] = proj.mapPressureMaxKpa;
+    doc["map"]["mcp3204Oversample"] = proj.mcp3204Oversample;
+    doc["map"]["syncSamples"] = proj.mapSyncSamples;
+    doc["map"]["syncStartDeg"] = proj.mapSyncStartDeg;
+    doc["map"]["syncWindowDeg"] = proj.mapSyncWindowDeg;
 
     doc["o2"]["afr_at_0v"] = proj.o2AfrAt0v;
     doc["o2"]["afr_at_5v"] = proj.o2AfrAt5v;
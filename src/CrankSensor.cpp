@@ -1,15 +1,20 @@
 #include "CrankSensor.h"
 #include "Logger.h"
+#include "TriggerLogger.h"
 
 CrankSensor* CrankSensor::_instance = nullptr;
 
 CrankSensor::CrankSensor()
-    : _pin(0), _totalTeeth(36), _missingTeeth(1), _rpm(0), _toothPosition(0),
-      _syncState(LOST), _lastToothTimeUs(0), _toothHistIdx(0),
-      _lastPeriodUs(0), _toothCount(0), _gapDetected(false),
-      _toothLogIdx(0), _toothLogCapturing(false), _toothLogComplete(false) {
+    : _pin(0), _decoder(TriggerDecoder::create(TRIG_MISSING_TOOTH, 36, 1)),
+      _rpm(0), _toothPosition(0),
+      _syncState(TriggerDecoder::LOST), _lastToothTimeUs(0),
+      _positionKnown(false), _phaseKnown(false), _revolution(0), _wrapPos(0), _toothHistIdx(0),
+      _lastPeriodUs(0), _toothPeriodUs(0), _periodSum(0), _histCount(0),
+      _periodDeltaQ4(0), _predictedPeriodUs(0), _snapSeq(0), _tdcOffsetUnits(0),
+      _blankPct(DEFAULT_BLANK_PCT), _blankQ8(0), _rejectedEdges(0),
+      _notifyTask(nullptr), _notifyBits(0), _stallBits(0),
+      _stallTimer(nullptr), _stallAlarmUs(0), _stallArmed(false), _stallCount(0) {
     memset((void*)_toothPeriods, 0, sizeof(_toothPeriods));
-    memset((void*)_toothLog, 0, sizeof(_toothLog));
 }
 
 CrankSensor::~CrankSensor() {
@@ -17,132 +22,345 @@ CrankSensor::~CrankSensor() {
         detachInterrupt(digitalPinToInterrupt(_pin));
         _instance = nullptr;
     }
+    if (_stallTimer) {
+        timerAlarmDisable(_stallTimer);
+        timerDetachInterrupt(_stallTimer);
+        timerEnd(_stallTimer);
+    }
+    delete _decoder;
 }
 
-void CrankSensor::begin(uint8_t pin, uint8_t teeth, uint8_t missing) {
+void CrankSensor::begin(uint8_t pin, uint8_t triggerType, uint8_t teeth, uint8_t missing) {
     _pin = pin;
-    _totalTeeth = teeth;
-    _missingTeeth = missing;
-    _syncState = LOST;
-    _rpm = 0;
-    _toothPosition = 0;
-    _toothCount = 0;
-    _gapDetected = false;
-    _lastToothTimeUs = 0;
-    _lastPeriodUs = 0;
+    configure(triggerType, teeth, missing);
 
     _instance = this;
     pinMode(_pin, INPUT_PULLUP);
     attachInterrupt(digitalPinToInterrupt(_pin), isrHandler, FALLING);
 
-    Log.info("CRANK", "Crank sensor on pin %d (%d-%d)", _pin, _totalTeeth, _missingTeeth);
+    const TriggerDecoder::Geometry& geo = _decoder->geometry();
+    Log.info("CRANK", "Crank sensor on pin %d (%s: %d teeth, %d missing, %.1f deg/tooth, TDC offset %.1f deg)",
+             _pin, _decoder->name(), geo.teeth, geo.missing, geo.degPerTooth, geo.tdcOffsetDeg);
+}
+
+void CrankSensor::configure(uint8_t triggerType, uint8_t teeth, uint8_t missing) {
+    // Pattern chosen once here — the ISR never switches on wheel type
+    delete _decoder;
+    _decoder = TriggerDecoder::create(triggerType, teeth, missing);
+    _syncState = TriggerDecoder::LOST;
+    _positionKnown = false;
+    _phaseKnown = false;
+    _revolution = 0;
+    _rpm = 0;
+    _toothPosition = 0;
+    resetTiming();
+
+    // Tooth where the crank angle wraps through TDC #1 (first real tooth if that lands in the gap)
+    const TriggerDecoder::Geometry& g = _decoder->geometry();
+    _tdcOffsetUnits = g.tdcOffsetUnits();
+    _wrapPos = (uint16_t)ceilf(_tdcOffsetUnits / (float)ANGLE_UNITS_PER_DEG / g.degPerTooth - 0.001f) % g.teeth;
+    if (_wrapPos >= g.teeth - g.missing) _wrapPos = 0;
+    _unitScaleQ24 = (uint32_t)((((uint64_t)g.teeth << 24) + ANGLE_UNITS_PER_REV / 2) / ANGLE_UNITS_PER_REV);
+    setNoiseBlanking(_blankPct);
+}
+
+void CrankSensor::setNoiseBlanking(uint8_t pct) {
+    _blankPct = pct;
+    uint32_t q8 = ((uint32_t)pct * 256) / 100;
+    _blankQ8 = (uint8_t)min(q8, (uint32_t)_decoder->getMaxBlankQ8());
+}
+
+bool CrankSensor::enableStallDetect(uint8_t timerNum) {
+    // 1 MHz count, reset to 0 on every tooth; the alarm fires only if no tooth resets it in time
+    _stallTimer = timerBegin(timerNum, 80, true);
+    if (!_stallTimer) {
+        Log.error("CRANK", "Hardware timer %d unavailable — no stall detection", timerNum);
+        return false;
+    }
+    timerAttachInterrupt(_stallTimer, stallIsr, true);
+    _stallAlarmUs = STALL_MAX_US;
+    timerAlarmWrite(_stallTimer, _stallAlarmUs, false);
+    _stallArmed = false;  // Armed by the first tooth
+    Log.info("CRANK", "Stall detection on hardware timer %d (%dx expected tooth period)",
+             timerNum, STALL_PERIOD_MULTIPLE);
+    return true;
 }
 
 void IRAM_ATTR CrankSensor::isrHandler() {
-    if (_instance) _instance->processTooth(esp_timer_get_time());
+    if (!_instance) return;
+    _instance->processTooth(esp_timer_get_time());
+    if (_instance->_notifyTask) {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(_instance->_notifyTask, _instance->_notifyBits, eSetBits, &woken);
+        if (woken) portYIELD_FROM_ISR();
+    }
+}
+
+void IRAM_ATTR CrankSensor::stallIsr() {
+    if (!_instance) return;
+    _instance->handleStall();
+    if (_instance->_notifyTask) {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(_instance->_notifyTask, _instance->_stallBits, eSetBits, &woken);
+        if (woken) portYIELD_FROM_ISR();
+    }
+}
+
+// Same core and interrupt level as the crank ISR, so the two never interleave
+void IRAM_ATTR CrankSensor::handleStall() {
+    _stallArmed = false;  // One-shot alarm has disabled itself
+    _snapSeq++;
+    _rpm = 0;
+    _syncState = TriggerDecoder::LOST;
+    _positionKnown = false;
+    _phaseKnown = false;
+    _toothPosition = 0;
+    _decoder->reset();
+    resetTiming();
+    _snapSeq++;
+    _stallCount++;
+    TrigLog.logIsrAt(esp_timer_get_time(), TriggerLogger::EVT_STALL, 0, 0);
+}
+
+void IRAM_ATTR CrankSensor::resetTiming() {
+    _lastToothTimeUs = 0;
+    _lastPeriodUs = 0;
+    _toothPeriodUs = 0;
+    for (uint8_t i = 0; i < TOOTH_HISTORY_SIZE; i++) _toothPeriods[i] = 0;
+    _toothHistIdx = 0;
+    _periodSum = 0;
+    _histCount = 0;
+    _periodDeltaQ4 = 0;
+    _predictedPeriodUs = 0;
+}
+
+void IRAM_ATTR CrankSensor::armStallTimer(uint32_t timeoutUs) {
+    if (!_stallTimer) return;
+    if (timeoutUs < STALL_MIN_US) timeoutUs = STALL_MIN_US;
+    if (timeoutUs > STALL_MAX_US) timeoutUs = STALL_MAX_US;
+    timerWrite(_stallTimer, 0);
+    uint32_t cur = _stallAlarmUs;
+    if (timeoutUs > cur + (cur >> 3) || timeoutUs < cur - (cur >> 3)) {
+        timerAlarmWrite(_stallTimer, timeoutUs, false);
+        _stallAlarmUs = timeoutUs;
+    }
+    if (!_stallArmed) {
+        timerAlarmEnable(_stallTimer);
+        _stallArmed = true;
+    }
 }
 
 void IRAM_ATTR CrankSensor::processTooth(int64_t nowUs) {
     if (_lastToothTimeUs == 0) {
         _lastToothTimeUs = nowUs;
+        armStallTimer(STALL_MAX_US);
         return;
     }
 
+    // Blanking window scales with speed: a fraction of the expected tooth. A rejected edge
+    // leaves the timing base, the decoder and the history exactly as they were.
     uint32_t periodUs = (uint32_t)(nowUs - _lastToothTimeUs);
+    uint32_t blankUs = (_predictedPeriodUs * _blankQ8) >> 8;
+    if (blankUs < BLANK_MIN_US) blankUs = BLANK_MIN_US;
+    if (periodUs < blankUs) {
+        _rejectedEdges++;
+        TrigLog.logIsrAt(nowUs, TriggerLogger::EVT_CRANK, _toothPosition,
+                         _syncState | TriggerLogger::EVT_FLAG_NOISE);
+        return;
+    }
+
+    _snapSeq++;  // Odd: tooth state in flux for angle readers on the other core
+    int64_t prevToothTimeUs = _lastToothTimeUs;
     _lastToothTimeUs = nowUs;
 
-    // Ignore very short periods (noise)
-    if (periodUs < 50) return;
-
-    // Store in period history
-    _toothPeriods[_toothHistIdx] = periodUs;
-    _toothHistIdx = (_toothHistIdx + 1) % TOOTH_HISTORY_SIZE;
-
-    // Detect missing tooth gap: period > 1.5x average normal tooth period
-    uint32_t avgPeriod = averagePeriod();
-    bool isGap = (avgPeriod > 0) && (periodUs > avgPeriod + (avgPeriod >> 1));
-
-    switch (_syncState) {
-        case LOST:
-            if (isGap) {
-                _syncState = SYNCING;
-                _toothCount = 0;
-                _toothPosition = 0;
-            }
-            break;
-
-        case SYNCING:
-            _toothCount++;
-            _toothPosition = _toothCount;
-            if (isGap) {
-                // Verify: gap should come after (totalTeeth - missingTeeth) real teeth
-                uint8_t expectedTeeth = _totalTeeth - _missingTeeth;
-                if (_toothCount == expectedTeeth) {
-                    _syncState = SYNCED;
-                } else {
-                    // Wrong count — restart sync
-                }
-                _toothCount = 0;
-                _toothPosition = 0;
-            }
-            break;
-
-        case SYNCED:
-            _toothCount++;
-            _toothPosition = _toothCount;
-            if (isGap) {
-                uint8_t expectedTeeth = _totalTeeth - _missingTeeth;
-                if (_toothCount != expectedTeeth) {
-                    // Lost sync
-                    _syncState = LOST;
-                    _rpm = 0;
-                }
-                _toothCount = 0;
-                _toothPosition = 0;
-            }
-            break;
+    // Pattern-specific sync (missing-tooth gap, extra tooth, cam edge) lives in the decoder
+    SyncState prevSync = _syncState;
+    uint16_t prevPos = _toothPosition;
+
+    // Gap/extra-tooth tests compare against the predicted period, not a lagging average,
+    // so a hard cranking acceleration doesn't look like a gap (or hide one)
+    TriggerDecoder::Edge edge = _decoder->onTooth(periodUs, _predictedPeriodUs);
+    if (edge == TriggerDecoder::EDGE_EXTRA) {
+        // Extra sync tooth is not an angle tooth — keep timing from the previous real tooth
+        _lastToothTimeUs = prevToothTimeUs;
+        _toothPosition = _decoder->getToothPosition();
+        _syncState = _decoder->getSyncState();
+        _positionKnown = _decoder->isPositionKnown();
+        _snapSeq++;
+        TrigLog.logIsrAt(nowUs, TriggerLogger::EVT_CRANK, _toothPosition,
+                         _syncState | TriggerLogger::EVT_FLAG_EXTRA);
+        armStallTimer(_predictedPeriodUs * STALL_PERIOD_MULTIPLE);
+        return;
     }
+    _syncState = _decoder->getSyncState();
+    _toothPosition = _decoder->getToothPosition();
+    _positionKnown = _decoder->isPositionKnown();
+    if (prevSync == TriggerDecoder::SYNCED && _syncState != TriggerDecoder::SYNCED) _rpm = 0;
 
+    // Track the engine-cycle half; any position re-anchor invalidates the cam phase
+    if (_toothPosition == _wrapPos && prevPos != _wrapPos) _revolution ^= 1;
+    if (!_positionKnown || (prevSync == TriggerDecoder::SYNCED && _syncState != TriggerDecoder::SYNCED))
+        _phaseKnown = false;
+
+    // Scheduler angle base and history need the period of one tooth, not of the whole gap
+    const TriggerDecoder::Geometry& geo = _decoder->geometry();
+    uint32_t toothPeriodUs = (edge == TriggerDecoder::EDGE_GAP) ? periodUs / (geo.missing + 1) : periodUs;
+
+    updatePeriodModel(toothPeriodUs);
     _lastPeriodUs = periodUs;
+    _snapSeq++;
 
-    // Tooth logging (if active)
-    if (_toothLogCapturing && _toothLogIdx < TOOTH_LOG_SIZE) {
-        _toothLog[_toothLogIdx].periodUs = periodUs;
-        _toothLog[_toothLogIdx].toothNum = _toothPosition;
-        _toothLogIdx++;
-        if (_toothLogIdx >= TOOTH_LOG_SIZE) {
-            _toothLogCapturing = false;
-            _toothLogComplete = true;
-        }
-    }
+    // Re-arm the tooth timeout for the span to the next physical tooth (whole gap before it)
+    bool beforeGap = geo.missing > 0 && _toothPosition == (uint16_t)(geo.teeth - geo.missing - 1);
+    armStallTimer(_predictedPeriodUs * (beforeGap ? geo.missing + 1 : 1) * STALL_PERIOD_MULTIPLE);
+
+    // Composite log (single flag test when not capturing)
+    TrigLog.logIsrAt(nowUs, TriggerLogger::EVT_CRANK, _toothPosition,
+                     _syncState | (edge == TriggerDecoder::EDGE_GAP ? TriggerLogger::EVT_FLAG_GAP : 0));
 
     // Calculate RPM from tooth period
-    // One revolution = totalTeeth tooth periods
-    // RPM = 60,000,000 / (periodUs * totalTeeth)
-    if (periodUs > 0 && _syncState != LOST) {
-        uint32_t rpmCalc = 60000000UL / ((uint32_t)periodUs * _totalTeeth);
+    // One revolution = teeth tooth periods
+    // RPM = 60,000,000 / (periodUs * teeth)
+    if (toothPeriodUs > 0 && _syncState != TriggerDecoder::LOST) {
+        uint32_t rpmCalc = 60000000UL / ((uint32_t)toothPeriodUs * geo.teeth);
         if (rpmCalc < 20000) _rpm = (uint16_t)rpmCalc;
     }
 }
 
-void CrankSensor::startToothLog() {
-    _toothLogIdx = 0;
-    _toothLogComplete = false;
-    _toothLogCapturing = true;
+// Constant-time period model: running sum over the history ring for the mean, plus a
+// smoothed per-tooth delta (1/4 weight) for the first-order prediction of the next tooth.
+void IRAM_ATTR CrankSensor::updatePeriodModel(uint32_t toothPeriodUs) {
+    uint8_t idx = _toothHistIdx;
+    _periodSum = _periodSum - _toothPeriods[idx] + toothPeriodUs;
+    _toothPeriods[idx] = toothPeriodUs;
+    _toothHistIdx = (idx + 1) & (TOOTH_HISTORY_SIZE - 1);
+    if (_histCount < TOOTH_HISTORY_SIZE) _histCount++;
+
+    uint32_t prev = _toothPeriodUs;
+    _toothPeriodUs = toothPeriodUs;
+    if (prev == 0) {
+        _predictedPeriodUs = toothPeriodUs;
+        return;
+    }
+
+    // Q4 so the integer filter doesn't settle on a 1 us bias from period quantization
+    int32_t delta = _periodDeltaQ4;
+    delta += ((((int32_t)toothPeriodUs - (int32_t)prev) << 4) - delta) >> 2;
+    _periodDeltaQ4 = delta;
+
+    // Until the ring fills, trust the last tooth; after that, anchor on the mean so one
+    // noisy tooth can't swing the prediction, and extrapolate by the half-window lag
+    uint32_t base = (_histCount < TOOTH_HISTORY_SIZE) ? toothPeriodUs
+                                                      : (_periodSum >> TOOTH_HISTORY_SHIFT);
+    int32_t predicted = (int32_t)base + ((delta * ((_histCount < TOOTH_HISTORY_SIZE) ? 1 : (TOOTH_HISTORY_SIZE + 1) / 2)) >> 4);
+
+    // Keep within half/double the last tooth — beyond that the model is guessing
+    int32_t lo = (int32_t)(toothPeriodUs >> 1);
+    int32_t hi = (int32_t)(toothPeriodUs << 1);
+    if (predicted < lo) predicted = lo;
+    if (predicted > hi) predicted = hi;
+    _predictedPeriodUs = (uint32_t)predicted;
+}
+
+bool IRAM_ATTR CrankSensor::snapshot(AngleSnapshot& s) const {
+    // Seqlock — the crank ISR may run on the other core mid-read
+    for (uint8_t tries = 0; tries < 4; tries++) {
+        uint32_t seq = _snapSeq;
+        if (seq & 1) continue;
+        s.toothTimeUs = _lastToothTimeUs;
+        s.toothPos = _toothPosition;
+        s.periodUs = _predictedPeriodUs;
+        s.deltaQ4 = _periodDeltaQ4;
+        s.revolution = _revolution;
+        s.phaseKnown = _phaseKnown;
+        if (seq == _snapSeq) return s.periodUs > 0;
+    }
+    return false;
+}
+
+uint16_t IRAM_ATTR CrankSensor::toothAngleUnits(uint16_t pos) const {
+    uint32_t a = ((uint32_t)pos * ANGLE_UNITS_PER_REV) / _decoder->geometry().teeth + ANGLE_UNITS_PER_REV - _tdcOffsetUnits;
+    return (uint16_t)(a % ANGLE_UNITS_PER_REV);
+}
+
+// 32-bit integer maths only, so the cam ISR can call it. Tooth fractions are Q10.
+uint16_t IRAM_ATTR CrankSensor::getCrankAngleAt(int64_t nowUs) const {
+    AngleSnapshot s;
+    if (!snapshot(s)) return toothAngleUnits(_toothPosition);
+
+    const TriggerDecoder::Geometry& geo = _decoder->geometry();
+    int64_t elapsed = nowUs - s.toothTimeUs;
+    if (elapsed <= 0) return toothAngleUnits(s.toothPos);
+
+    // The crank can't pass the next physical tooth unseen: one tooth, or the whole gap
+    bool beforeGap = geo.missing > 0 && s.toothPos == (uint16_t)(geo.teeth - geo.missing - 1);
+    uint32_t spanTeeth = beforeGap ? geo.missing + 1 : 1;
+    uint32_t maxFrac = spanTeeth << 10;
+
+    uint32_t frac = maxFrac;
+    if (elapsed < (int64_t)s.periodUs * spanTeeth) {
+        // Linear estimate, then one correction using the mean period over the travelled span
+        uint32_t t = (uint32_t)elapsed;
+        frac = (t << 10) / s.periodUs;
+        int32_t avgPeriod = (int32_t)s.periodUs + ((s.deltaQ4 * (int32_t)frac) >> 15);
+        if (avgPeriod < (int32_t)(s.periodUs >> 1)) avgPeriod = s.periodUs >> 1;
+        frac = (t << 10) / (uint32_t)avgPeriod;
+        if (frac > maxFrac) frac = maxFrac;
+    }
+
+    uint32_t units = (frac * ANGLE_UNITS_PER_REV) / ((uint32_t)geo.teeth << 10);
+    return (uint16_t)((toothAngleUnits(s.toothPos) + units) % ANGLE_UNITS_PER_REV);
 }
 
-void CrankSensor::stopToothLog() {
-    _toothLogCapturing = false;
+int64_t CrankSensor::angleToTimestamp(uint16_t angle) const {
+    AngleSnapshot s;
+    if (!snapshot(s)) return 0;
+
+    const TriggerDecoder::Geometry& geo = _decoder->geometry();
+    uint32_t ahead = ((uint32_t)angle + ANGLE_UNITS_PER_REV - toothAngleUnits(s.toothPos)) % ANGLE_UNITS_PER_REV;
+
+    // Teeth to travel (Q10); time = x*P + d*x^2/2 with P the next tooth's period
+    int64_t x = ((int64_t)ahead * geo.teeth << 10) / ANGLE_UNITS_PER_REV;
+    int64_t linear = (x * s.periodUs) >> 10;
+    int64_t accel = ((int64_t)s.deltaQ4 * x * x) >> 25;
+    if (accel < -(linear >> 1)) accel = -(linear >> 1);  // Don't extrapolate past half the period
+    return s.toothTimeUs + linear + accel;
 }
 
-uint32_t CrankSensor::averagePeriod() const {
-    uint32_t sum = 0;
-    uint8_t count = 0;
-    for (uint8_t i = 0; i < TOOTH_HISTORY_SIZE; i++) {
-        if (_toothPeriods[i] > 0) {
-            sum += _toothPeriods[i];
-            count++;
-        }
+uint16_t IRAM_ATTR CrankSensor::onCamEdge(int64_t nowUs, bool indexEdge) {
+    if (indexEdge) {
+        // Cam-synced wheels re-label the last tooth here — extrapolate from the new position
+        _decoder->onCamEdge();
+        _snapSeq++;
+        _syncState = _decoder->getSyncState();
+        _positionKnown = _decoder->isPositionKnown();
+        _toothPosition = _decoder->getToothPosition();
+        _snapSeq++;
     }
-    return (count > 0) ? (sum / count) : 0;
+    return getCrankAngleAt(nowUs);
+}
+
+void IRAM_ATTR CrankSensor::setCamPhase(uint16_t edgeAngle, uint8_t edgeRevolution) {
+    if (!_positionKnown) return;
+    // If the extrapolated angle already wrapped past TDC, the last tooth was in the other revolution
+    uint8_t rev = edgeRevolution;
+    if (edgeAngle < toothAngleUnits(_toothPosition)) rev ^= 1;
+    _snapSeq++;
+    _revolution = rev;
+    _phaseKnown = true;
+    _snapSeq++;
+}
+
+bool CrankSensor::getToothReference(ToothReference& ref) const {
+    AngleSnapshot s;
+    if (!snapshot(s)) return false;
+    ref.timeUs = s.toothTimeUs;
+    ref.toothPos = s.toothPos;
+    bool secondRev = s.phaseKnown && s.revolution;
+    ref.cycleTooth = s.toothPos + (secondRev ? _decoder->geometry().teeth : 0);
+    ref.angle = CrankAngle(toothAngleUnits(s.toothPos) + (secondRev ? ANGLE_UNITS_PER_REV : 0));
+    ref.cycleUnits = s.phaseKnown ? CrankAngle::UNITS_PER_CYCLE : CrankAngle::UNITS_PER_REV;
+    const uint8_t shift = 24 - CrankAngle::RATE_SHIFT;
+    ref.usPerUnitQ = (uint32_t)(((uint64_t)s.periodUs * _unitScaleQ24 + (1u << (shift - 1))) >> shift);
+    return true;
 }
@@ -2,6 +2,7 @@
 #include "SensorManager.h"
 #include "ECU.h"
 #include "PinExpander.h"
+#include "NativeAdc.h"
 #include "Logger.h"
 #include <time.h>
 
@@ -60,7 +61,7 @@ static bool cronMatches(const char* cron, const struct tm* t) {
 }
 
 CustomPinManager::CustomPinManager()
-    : _sensors(nullptr), _engineState(nullptr), _nextPwmChannel(8) {
+    : _sensors(nullptr), _engineState(nullptr), _nextPwmChannel(8), _batch(nullptr) {
     for (uint8_t i = 0; i < MAX_CUSTOM_PINS; i++) {
         _pins[i].clear();
         _timers[i] = nullptr;
@@ -79,6 +80,7 @@ OutputRule* CustomPinManager::getRule(uint8_t slot) {
 }
 
 void CustomPinManager::begin() {
+    PinExpander::instance().setInterruptHandler(onExpanderInterrupt, this);
     for (uint8_t i = 0; i < MAX_CUSTOM_PINS; i++) {
         if (_pins[i].mode != CPIN_DISABLED) {
             initPin(i);
@@ -106,6 +108,7 @@ void CustomPinManager::initPin(uint8_t slot) {
                 xPinMode(p.pin, INPUT);
             else
                 pinMode(p.pin, INPUT);
+            if (p.mode == CPIN_ANALOG_IN && !isExpander) NativeAdc::instance().addPin(p.pin);
             break;
 
         case CPIN_INPUT_ISR: {
@@ -179,6 +182,7 @@ void CustomPinManager::initPin(uint8_t slot) {
             break;
     }
 
+    _handles[slot].attach(p.pin);
     p.initialized = true;
     p.lastUpdateMs = millis();
     Log.info("CPIN", "Pin %d '%s' initialized (mode %d)", p.pin, p.name, p.mode);
@@ -203,6 +207,7 @@ void CustomPinManager::deinitPin(uint8_t slot) {
     if (p.mode == CPIN_PWM_OUT && p.pwmChannel <= 15) {
         ledcDetachPin(p.pin);
     }
+    _handles[slot] = PinHandle();
     p.initialized = false;
 }
 
@@ -213,32 +218,6 @@ void CustomPinManager::update() {
     struct tm timeinfo = {};
     bool haveTime = (getLocalTime(&timeinfo, 0) && timeinfo.tm_year > 100);
 
-    // Check shared expander interrupt — scan all devices in priority order (0 first, 5 last)
-    {
-        PinExpander& exp = PinExpander::instance();
-        if (exp.hasSharedInterrupt()) {
-            for (uint8_t ei = 0; ei < SPI_EXP_MAX; ei++) {
-                if (!exp.isReady(ei) || !exp.hasGpinten(ei)) continue;
-                uint16_t changed, captured;
-                if (exp.checkInterrupt(ei, changed, captured)) {
-                    for (uint8_t i = 0; i < MAX_CUSTOM_PINS; i++) {
-                        CustomPinDescriptor& cp = _pins[i];
-                        if (!cp.initialized || cp.mode != CPIN_INPUT_ISR) continue;
-                        if (cp.pin < SPI_EXP_PIN_OFFSET) continue;
-                        uint8_t spiIdx = (cp.pin - SPI_EXP_PIN_OFFSET) / SPI_EXP_PIN_COUNT;
-                        if (spiIdx != ei) continue;
-                        uint8_t localPin = (cp.pin - SPI_EXP_PIN_OFFSET) % SPI_EXP_PIN_COUNT;
-                        if (changed & (1 << localPin)) {
-                            cp.isrCount++;
-                            cp.value = (captured & (1 << localPin)) ? 1.0f : 0.0f;
-                        }
-                    }
-                }
-            }
-            exp.clearSharedInterrupt();
-        }
-    }
-
     // Poll inputs
     for (uint8_t i = 0; i < MAX_CUSTOM_PINS; i++) {
         CustomPinDescriptor& p = _pins[i];
@@ -252,7 +231,7 @@ void CustomPinManager::update() {
         } else if (p.mode == CPIN_INPUT_ISR) {
             // Value updated by native ISR (isrCount) or expander interrupt check above
             if (p.pin < SPI_EXP_PIN_OFFSET) p.value = (float)p.isrCount;
-            // Expander ISR pins: value already set by checkInterrupt above
+            // Expander ISR pins: value set by onExpanderInterrupt() from the expander INT task
         } else if (p.mode == CPIN_INPUT_TIMER && haveTime) {
             // Cron matching: check once per second (avoid duplicate fires within same second)
             uint32_t curSec = timeinfo.tm_sec + timeinfo.tm_min * 60 + timeinfo.tm_hour * 3600;
@@ -263,12 +242,16 @@ void CustomPinManager::update() {
         }
     }
 
-    // Evaluate output rules
+    // Evaluate output rules — expander outputs are staged and go out in one write per device
+    PinBatch batch;
+    _batch = &batch;
     for (uint8_t i = 0; i < MAX_OUTPUT_RULES; i++) {
         if (_rules[i].enabled && _rules[i].targetPin < MAX_CUSTOM_PINS) {
             evaluateRule(i);
         }
     }
+    _batch = nullptr;
+    batch.commit();
 }
 
 void CustomPinManager::pollPin(uint8_t slot) {
@@ -277,15 +260,31 @@ void CustomPinManager::pollPin(uint8_t slot) {
 
     if (p.mode == CPIN_ANALOG_IN) {
         if (!isExpander) {
-            p.value = (float)analogRead(p.pin);
+            p.value = (float)NativeAdc::instance().read(p.pin);
         }
     } else {
         // Digital poll
-        int val = isExpander ? xDigitalRead(p.pin) : digitalRead(p.pin);
+        int val = _handles[slot].read();
         p.value = (float)val;
     }
 }
 
+void CustomPinManager::onExpanderInterrupt(void* arg, uint8_t index, uint16_t changed, uint16_t captured) {
+    CustomPinManager* self = (CustomPinManager*)arg;
+    for (uint8_t i = 0; i < MAX_CUSTOM_PINS; i++) {
+        CustomPinDescriptor& cp = self->_pins[i];
+        if (!cp.initialized || cp.mode != CPIN_INPUT_ISR) continue;
+        if (cp.pin < SPI_EXP_PIN_OFFSET) continue;
+        uint8_t spiIdx = (cp.pin - SPI_EXP_PIN_OFFSET) / SPI_EXP_PIN_COUNT;
+        if (spiIdx != index) continue;
+        uint8_t localPin = (cp.pin - SPI_EXP_PIN_OFFSET) % SPI_EXP_PIN_COUNT;
+        if (changed & (1 << localPin)) {
+            cp.isrCount++;
+            cp.value = (captured & (1 << localPin)) ? 1.0f : 0.0f;
+        }
+    }
+}
+
 void IRAM_ATTR CustomPinManager::isrHandler(void* arg) {
     CustomPinDescriptor* p = (CustomPinDescriptor*)arg;
     p->isrCount++;
@@ -346,8 +345,8 @@ void CustomPinManager::setOutput(uint8_t slot, float value) {
 
     if (p.mode == CPIN_OUTPUT) {
         bool on = (value > 0.5f);
-        if (p.pin >= SPI_EXP_PIN_OFFSET) xDigitalWrite(p.pin, on ? HIGH : LOW);
-        else digitalWrite(p.pin, on ? HIGH : LOW);
+        if (_batch) _batch->stage(_handles[slot], on ? HIGH : LOW);
+        else _handles[slot].write(on ? HIGH : LOW);
         p.value = on ? 1.0f : 0.0f;
     } else if (p.mode == CPIN_PWM_OUT && p.pwmChannel <= 15) {
         uint32_t duty = constrain((uint32_t)value, 0, (1 << p.pwmResolution) - 1);
@@ -1,5 +1,4 @@
 #include "ECU.h"
-#include <Wire.h>
 #include "CrankSensor.h"
 #include "CamSensor.h"
 #include "IgnitionManager.h"
@@ -12,10 +11,16 @@
 #include "MCP3204Reader.h"
 #include "TransmissionManager.h"
 #include "CustomPin.h"
+#include "EventScheduler.h"
+#include "MapSampler.h"
+#include "HwTimerBackend.h"
+#include "TriggerLogger.h"
 #include "TuneTable.h"
 #include "Config.h"
 #include "Logger.h"
 #include "PinExpander.h"
+#include "I2cBus.h"
+#include "NativeAdc.h"
 #include <esp_task_wdt.h>
 #include <esp_log.h>
 
@@ -23,12 +28,12 @@
 static const uint8_t PIN_CRANK        = 1;
 static const uint8_t PIN_CAM          = 2;
 
-static SPIClass hspi(HSPI);
-
 ECU::ECU(Scheduler* ts)
-    : _ts(ts), _tUpdate(nullptr), _crankTeeth(36), _crankMissing(1),
+    : _ts(ts), _tUpdate(nullptr), _crankTeeth(36), _crankMissing(1), _triggerType(0),
+      _camType(0), _camOffsetDeg(0.0f), _triggerBlankPct(CrankSensor::DEFAULT_BLANK_PCT),
       _realtimeTaskHandle(nullptr), _cj125(nullptr), _ads1115(nullptr),
       _ads1115_2(nullptr), _mcp3204(nullptr), _trans(nullptr), _customPins(nullptr),
+      _scheduler(nullptr), _timerBackend(nullptr), _mapSampler(nullptr),
       _cj125Enabled(false), _transType(0),
       _pinAlternator(41), _pinI2cSda(0), _pinI2cScl(42),
       _pinHeater1(19), _pinHeater2(20), _pinCj125Ua1(3), _pinCj125Ua2(4),
@@ -58,6 +63,9 @@ ECU::ECU(Scheduler* ts)
     _fuel = new FuelManager();
     _alternator = new AlternatorControl();
     _sensors = new SensorManager();
+    _scheduler = new EventScheduler();
+    _timerBackend = new HwTimerBackend();
+    _mapSampler = new MapSampler();
 }
 
 ECU::~ECU() {
@@ -75,6 +83,9 @@ ECU::~ECU() {
     delete _trans;
     delete _customPins;
     delete _cltRevLimitTable;
+    delete _timerBackend;
+    delete _mapSampler;
+    delete _scheduler;
 }
 
 void ECU::configure(const ProjectInfo& proj) {
@@ -85,6 +96,13 @@ void ECU::configure(const ProjectInfo& proj) {
     memcpy(_firingOrder, proj.firingOrder, sizeof(_firingOrder));
     _crankTeeth = proj.crankTeeth;
     _crankMissing = proj.crankMissing;
+    _triggerType = proj.triggerType;
+    _camType = proj.camType;
+    _camOffsetDeg = proj.camOffsetDeg;
+    _triggerBlankPct = proj.triggerBlankPct;
+    _mapSyncSamples = proj.mapSyncSamples;
+    _mapSyncStartDeg = proj.mapSyncStartDeg;
+    _mapSyncWindowDeg = proj.mapSyncWindowDeg;
 
     // Configure fuel manager
     _fuel->setReqFuel(proj.injectorFlowCcMin, proj.displacement, proj.cylinders);
@@ -121,6 +139,7 @@ void ECU::configure(const ProjectInfo& proj) {
     _pinHspiMiso = proj.pinHspiMiso;
     _pinHspiCs = proj.pinHspiCs;
     _pinMcp3204Cs = proj.pinMcp3204Cs;
+    _mcp3204Oversample = proj.mcp3204Oversample;
 
     // Configure sensor pin assignments
     _sensors->setPins(proj.pinO2Bank1, proj.pinO2Bank2, proj.pinMap, proj.pinTps,
@@ -220,9 +239,9 @@ void ECU::configure(const ProjectInfo& proj) {
     afrTable->setValues(defaults);
     _fuel->setAfrTable(afrTable);
 
-    Log.info("ECU", "Configured: %d cyl, %d-%d trigger, cam=%s",
-             proj.cylinders, proj.crankTeeth, proj.crankMissing,
-             proj.hasCamSensor ? "yes" : "no");
+    Log.info("ECU", "Configured: %d cyl, %d-%d trigger (type %d), cam=%s (type %d)",
+             proj.cylinders, proj.crankTeeth, proj.crankMissing, proj.triggerType,
+             proj.hasCamSensor ? "yes" : "no", proj.camType);
 }
 
 void ECU::setPeripheralFlags(const ProjectInfo& proj) {
@@ -239,8 +258,7 @@ void ECU::setPeripheralFlags(const ProjectInfo& proj) {
 void ECU::begin() {
     // I2C bus — retained for ADS1115 ADCs only (no MCP23017 expanders)
     if (_i2cEnabled) {
-        Wire.begin(_pinI2cSda, _pinI2cScl);
-        Wire.setTimeOut(10);  // 10ms I2C bus timeout (capital O = I2C, not Stream)
+        I2cBus::instance().begin(_pinI2cSda, _pinI2cScl);
         // Suppress Wire I2C error spam during probe
         esp_log_level_set("Wire", ESP_LOG_NONE);
         Log.info("ECU", "I2C bus initialized (SDA=%d, SCL=%d) — ADS1115 only", _pinI2cSda, _pinI2cScl);
@@ -248,9 +266,13 @@ void ECU::begin() {
         Log.warn("ECU", "I2C bus disabled — ADS1115 skipped");
     }
 
-    // HSPI bus for 6x MCP23S17 expanders (shared CS, HAEN hardware addressing)
+    // HSPI bus for 6x MCP23S17 expanders (shared CS, HAEN hardware addressing) and the
+    // MCP3204 — owned by the SpiBus task, every device queues transactions on it
+    if (_spiExpandersEnabled && !SpiBus::instance().begin(_pinHspiSck, _pinHspiMiso, _pinHspiMosi)) {
+        _spiExpandersEnabled = false;
+        Log.error("ECU", "HSPI bus unavailable — SPI expanders and MCP3204 skipped");
+    }
     if (_spiExpandersEnabled) {
-        hspi.begin(_pinHspiSck, _pinHspiMiso, _pinHspiMosi);
         PinExpander& exp = PinExpander::instance();
         static const char* expNames[] = {"general I/O", "transmission", "expansion",
                                           "expansion", "coils", "injectors"};
@@ -258,7 +280,7 @@ void ECU::begin() {
                          _expander3Enabled, _expander4Enabled, _expander5Enabled};
         for (uint8_t i = 0; i < SPI_EXP_MAX; i++) {
             if (enabled[i]) {
-                if (!exp.begin(i, &hspi, _pinHspiCs, i))
+                if (!exp.begin(i, _pinHspiCs, i))
                     Log.warn("ECU", "MCP23S17 #%d (%s) not detected", i, expNames[i]);
             } else {
                 Log.info("ECU", "MCP23S17 #%d (%s) disabled via config", i, expNames[i]);
@@ -273,21 +295,36 @@ void ECU::begin() {
     }
 
     // Initialize subsystems
-    _crank->begin(PIN_CRANK, _crankTeeth, _crankMissing);
+    _crank->begin(PIN_CRANK, _triggerType, _crankTeeth, _crankMissing);
+    _crank->setNoiseBlanking(_triggerBlankPct);
+    _crank->enableStallDetect(STALL_TIMER_NUM);
     _cam->setCrankSensor(_crank);
     if (_state.sequentialMode) {
-        _cam->begin(PIN_CAM);
+        _cam->begin(PIN_CAM, _camType, _camOffsetDeg);
     }
+    TrigLog.begin();
+
+    // Angle-based event scheduler — hardware timer alarm wakes the Core 1 real-time task
+    if (_timerBackend->begin(RT_TIMER_NUM, nullptr, RT_NOTIFY_TIMER))
+        _scheduler->begin(_timerBackend);
+    _ignition->setScheduler(_scheduler);
+    _injection->setScheduler(_scheduler);
+    _mapSampler->setScheduler(_scheduler);
+    _ignition->setTriggerGeometry(_crank->getGeometry());
+    _injection->setTriggerGeometry(_crank->getGeometry());
+    _mapSampler->setTriggerGeometry(_crank->getGeometry());
 
     _ignition->begin(_state.numCylinders, _coilPins, _firingOrder);
     _injection->begin(_state.numCylinders, _injectorPins, _firingOrder);
+    _mapSampler->begin(_state.numCylinders);
     _fuel->begin();
     _alternator->begin(_pinAlternator);
 
     // Probe MCP3204 SPI ADC for MAP/TPS (priority over ADS1115 @ 0x49)
     if (_spiExpandersEnabled) {
         _mcp3204 = new MCP3204Reader();
-        if (_mcp3204->begin(&hspi, _pinMcp3204Cs, 5.0f)) {
+        if (_mcp3204->begin(_pinMcp3204Cs, 5.0f)) {
+            _mcp3204->setOversampling(_mcp3204Oversample);
             _sensors->setMapTpsMCP3204(_mcp3204);
             Log.info("ECU", "MCP3204 @ SPI CS=%d found — MAP/TPS via SPI, GPIO %d/%d freed for OSS/TSS",
                      _pinMcp3204Cs, _sensors->getPin(2), _sensors->getPin(3));
@@ -313,6 +350,16 @@ void ECU::begin() {
 
     _sensors->begin();
 
+    // Crank-synchronous MAP needs a conversion the real-time task can start without waiting:
+    // MCP3204 only. ADS1115 (I2C task, ~1 ms per conversion) and the native ADC DMA scan keep
+    // the 10 ms sample.
+    const SensorDescriptor* mapDesc = _sensors->getDescriptor(SensorManager::SLOT_MAP);
+    if (_mcp3204 && mapDesc && mapDesc->sourceType == SRC_MCP3204 && _mapSyncSamples > 0) {
+        _mapMcpChannel = mapDesc->sourceChannel;
+        _mapSampler->setConverter(convertMap, this);
+        _mapSampler->setWindow(_mapSyncStartDeg, _mapSyncWindowDeg, _mapSyncSamples);
+    }
+
     // Wire manager pointers for virtual sensor sources (SRC_ENGINE_STATE, SRC_OUTPUT_STATE)
     _sensors->setEngineStatePtr(&_state);
     _sensors->setIgnitionManager(_ignition);
@@ -350,6 +397,8 @@ void ECU::begin() {
 
         _cj125 = new CJ125Controller(&SPI);
         _cj125->setADS1115(_ads1115);
+        _ads1115->setSamplePeriodMs(0, 100);    // UR at the CJ125 control rate
+        _ads1115->setSamplePeriodMs(1, 100);
         _cj125->begin(_pinCj125Ss1, _pinCj125Ss2,
                        _pinHeater1, _pinHeater2,
                        _pinCj125Ua1, _pinCj125Ua2);
@@ -367,6 +416,8 @@ void ECU::begin() {
             _sensors->setADS1115(_ads1115);
         }
         _trans->setADS1115(_ads1115);
+        _ads1115->setSamplePeriodMs(2, 500);    // TFT: slow thermal signal
+        _ads1115->setSamplePeriodMs(3, 50);     // MLPS: range changes under the driver's hand
         // OSS/TSS: MAP/TPS pins available only if external ADC (MCP3204 or ADS1115) took over
         bool extAdc = _sensors->hasExternalMapTps();
         uint8_t ossPin = extAdc ? _sensors->getPin(2) : 0xFF;
@@ -392,6 +443,18 @@ void ECU::begin() {
                      : String(String("GPIO ") + String(_pinOilPressure)).c_str());
     }
 
+    // I2C sensor task owns Wire from here on (probes above are done). MAP/TPS on 0x49 and any
+    // SRC_ADS1115 descriptor channel join the plan at period 0 on their first read.
+    if (_i2cEnabled) {
+        if (_ads1115 && _ads1115->isReady()) I2cBus::instance().addDevice(_ads1115);
+        if (_ads1115_2) I2cBus::instance().addDevice(_ads1115_2);
+        I2cBus::instance().start();
+    }
+
+    // Native ADC1 sensor pins (descriptors, CJ125 UA, oil fallback) into one DMA scan.
+    // Custom analog pins join when CustomPinManager::begin() runs.
+    NativeAdc::instance().start();
+
     // Custom pin manager (begin() called from main after loading config)
     _customPins = new CustomPinManager();
     _customPins->setSensorManager(_sensors);
@@ -402,12 +465,24 @@ void ECU::begin() {
 
     // Core 1 real-time task — disabled for Phase 1 (no engine connected)
     // xTaskCreatePinnedToCore(realtimeTask, "ecu_rt", 4096, this, 24, &_realtimeTaskHandle, 1);
+    if (_realtimeTaskHandle) {
+        _crank->setNotifyTask(_realtimeTaskHandle, RT_NOTIFY_TOOTH, RT_NOTIFY_STALL);
+        _timerBackend->setNotifyTask(_realtimeTaskHandle);
+    }
 
     Log.info("ECU", "ECU started, %d cylinders", _state.numCylinders);
 }
 
 void ECU::update() {
     uint32_t t0 = micros();
+    // Refused output flushes re-queued; expander inputs read last tick, re-read in one burst —
+    // readers below hit the snapshot
+    if (_spiExpandersEnabled) {
+        PinExpander::instance().retryFlushes();
+        PinExpander::instance().refreshInputs();
+    }
+    // MAP/TPS/oil on the MCP3204: every channel in use, oversampled, in one bus burst
+    if (_mcp3204) _mcp3204->refresh();
     // Core 0: read sensors and run fuel/ignition calculations
     _sensors->update();
     uint32_t t1 = micros();
@@ -415,7 +490,18 @@ void ECU::update() {
 
     // Update shared state from sensors
     _state.rpm = _crank->getRpm();
+    uint32_t stalls = _crank->getStallCount();
+    if (stalls != _lastStallCount) {
+        _lastStallCount = stalls;
+        Log.warn("ECU", "Crank stall — no tooth within timeout, sync dropped (%lu total)", (unsigned long)stalls);
+    }
     _state.mapKpa = _sensors->getMapKpa();
+    // Crank-synchronous MAP: the last cylinder event's window mean, unfiltered, replaces the
+    // 10 ms sample while the windows keep coming
+    float mapLoadMv;
+    if (_mapSampler->getLoad(esp_timer_get_time(), mapLoadMv)) {
+        _state.mapKpa = _sensors->calibrateMap(mapLoadMv / 1000.0f);
+    }
     _state.tps = _sensors->getTpsPercent();
     _state.afr[0] = _sensors->getO2Afr(0);
     _state.afr[1] = _sensors->getO2Afr(1);
@@ -436,7 +522,7 @@ void ECU::update() {
     // Engine state detection
     _state.cranking = (_state.rpm > 0 && _state.rpm < 400);
     _state.engineRunning = (_state.rpm >= 400);
-    _state.sequentialMode = _cam->hasCamSignal();
+    _state.sequentialMode = _crank->isPhaseKnown();  // Set by the cam ISR, cleared on cam timeout / sync loss
 
     // Pass engine running state to sensor manager (needed for rule evaluation)
     _sensors->setEngineRunning(_state.engineRunning);
@@ -474,6 +560,18 @@ void ECU::update() {
 
     // Copy subsystem state to shared EngineState
     _state.overdwellCount = _ignition->getOverdwellCount();
+    if (_state.overdwellCount != _lastOverdwellCount) {
+        // Cut by the real-time task's timer event; reported here, off the real-time path
+        Log.warn("IGN", "Overdwell cutoff on cyl %d (%luus, %lu total)", _ignition->getLastOverdwellCyl() + 1,
+                 (unsigned long)_ignition->getLastOverdwellUs(), (unsigned long)_state.overdwellCount);
+        _lastOverdwellCount = _state.overdwellCount;
+    }
+    uint32_t planOverflows = _ignition->getPlanOverflowCount() + _injection->getPlanOverflowCount() +
+                             _mapSampler->getPlanOverflowCount();
+    if (planOverflows != _lastPlanOverflowCount) {
+        Log.warn("PLAN", "Event plan full — events dropped (%lu rebuilds)", (unsigned long)planOverflows);
+        _lastPlanOverflowCount = planOverflows;
+    }
     _state.aseActive = _fuel->isAseActive();
     _state.asePct = _fuel->getAsePct();
     _state.dfcoActive = _fuel->isDfcoActive();
@@ -583,25 +681,73 @@ void ECU::realtimeTask(void* param) {
     ECU* ecu = (ECU*)param;
 
     // Detach this task from the Task Watchdog Timer — high-priority RT task
-    // manages its own timing via vTaskDelay, not idle task monitoring
+    // blocks on notifications, not idle task monitoring
     esp_task_wdt_delete(NULL);
 
-    // Core 1: real-time ignition and injection timing
+    // Core 1: real-time ignition and injection timing.
+    // Woken by the crank ISR on every tooth, by the scheduler alarm when events are due
+    // and by the crank stall timer; the timeout keeps the overdwell and injector-close
+    // backstops running between teeth. RPM comes straight from the crank sensor, not the 10ms state.
+    bool running = false;
+    bool wasRunning = false;
+    int64_t lastRefUs = 0;
     while (true) {
-        uint16_t rpm = ecu->_state.rpm;
-
-        if (rpm > 0 && ecu->_crank->isSynced()) {
-            uint16_t toothPos = ecu->_crank->getToothPosition();
-            bool seq = ecu->_state.sequentialMode;
-            ecu->_ignition->update(rpm, toothPos, seq);
-            ecu->_injection->update(rpm, toothPos, seq);
-            vTaskDelay(1); // ~1ms yield when engine running
-        } else {
-            vTaskDelay(pdMS_TO_TICKS(10)); // 10ms sleep when engine off — save CPU
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, running ? 1 : pdMS_TO_TICKS(10));
+
+        // Fire from the first valid gap (wasted spark + batch fuel); the cam ISR resolves
+        // phase and the reference switches to the 720 deg cycle on the next wakeup.
+        // Events already armed are absolute timestamps, so the switch needs no cancel.
+        uint16_t rpm = ecu->_crank->getRpm();
+        CrankSensor::ToothReference ref;
+        running = rpm > 0 && ecu->_crank->isPositionKnown() && ecu->_crank->getToothReference(ref);
+
+        if (bits & RT_NOTIFY_STALL) {
+            // Teeth stopped — release coils and close injectors now, not on the next 10ms pass
+            ecu->_scheduler->cancelAll();
+            ecu->_ignition->cutSpark();
+            ecu->_injection->closeAll();
+            wasRunning = false;
+        } else if (running) {
+            // Extra sync teeth and noise wake the task without moving the reference
+            bool newTooth = (bits & RT_NOTIFY_TOOTH) && ref.timeUs != lastRefUs;
+            if (newTooth) {
+                lastRefUs = ref.timeUs;
+                ecu->_scheduler->setAngleReference(ref.timeUs, ref.angle, ref.usPerUnitQ, ref.cycleUnits);
+            }
+            uint32_t c0 = ESP.getCycleCount();
+            ecu->_ignition->update(rpm, ref, newTooth);
+            ecu->_injection->update(rpm, ref, newTooth);
+            ecu->_mapSampler->update(rpm, ref, newTooth);
+            if (newTooth) {
+                uint32_t cycles = ESP.getCycleCount() - c0;
+                ecu->_rtCycles = cycles;
+                if (cycles > ecu->_rtMaxCycles) ecu->_rtMaxCycles = cycles;
+            }
+            wasRunning = true;
+        } else if (wasRunning) {
+            // Lost sync — drop anything still armed. That includes the overdwell and close
+            // events, so release coils and injectors rather than leave them on untimed.
+            // Once, on the transition: each shutdown queues urgent expander writes, and
+            // cranking or resyncing would otherwise send a batch per tooth.
+            ecu->_scheduler->cancelAll();
+            ecu->_ignition->cutSpark();
+            ecu->_injection->closeAll();
+            wasRunning = false;
         }
+        ecu->_scheduler->dispatch();
     }
 }
 
+bool ECU::convertMap(void* arg, uint8_t tag) {
+    ECU* ecu = (ECU*)arg;
+    return ecu->_mcp3204->convertAsync(ecu->_mapMcpChannel, tag, onMapSample, ecu);
+}
+
+void ECU::onMapSample(void* arg, uint8_t tag, float millivolts) {
+    ((ECU*)arg)->_mapSampler->addSample(tag, millivolts);
+}
+
 const char* ECU::getStateString() const {
     if (_state.rpm == 0) return "OFF";
     if (_state.cranking) return "CRANKING";
@@ -0,0 +1,87 @@
+#include "EventPlan.h"
+
+EventPlan::EventPlan()
+    : _tdcOffsetUnits(0), _sequential(false), _slots(0), _maxEvents(0), _eventCount(0),
+      _eventTag(nullptr), _eventUnits(nullptr), _slotStart(nullptr), _entries(nullptr),
+      _maxEntries(0), _overflows(0) {
+    memset(&_geo, 0, sizeof(_geo));
+}
+
+EventPlan::~EventPlan() {
+    release();
+}
+
+void EventPlan::release() {
+    delete[] _eventTag;
+    delete[] _eventUnits;
+    delete[] _slotStart;
+    delete[] _entries;
+    _eventTag = nullptr;
+    _eventUnits = nullptr;
+    _slotStart = nullptr;
+    _entries = nullptr;
+}
+
+void EventPlan::setGeometry(const TriggerDecoder::Geometry& geo, uint8_t maxEvents) {
+    release();
+    _geo = geo;
+    _tdcOffsetUnits = geo.tdcOffsetUnits();
+    _lookahead = CrankAngle((uint16_t)(((uint32_t)CrankAngle::UNITS_PER_REV * (geo.missing + 2)) / geo.teeth));
+    _maxEvents = maxEvents;
+    _eventCount = 0;
+    _eventTag = new uint8_t[maxEvents];
+    _eventUnits = new int32_t[maxEvents];
+    // One slot per tooth position of a 720 deg cycle; each event falls in at most
+    // missing + 3 tooth windows
+    _slotStart = new uint16_t[2 * geo.teeth + 1];
+    _maxEntries = (uint16_t)maxEvents * (geo.missing + 3);
+    _entries = new Entry[_maxEntries];
+    _slots = 0;
+    _slotStart[0] = 0;
+}
+
+void EventPlan::clear(bool sequential) {
+    _sequential = sequential;
+    _eventCount = 0;
+}
+
+void EventPlan::add(uint8_t tag, int32_t angleUnits) {
+    if (_eventCount >= _maxEvents) return;
+    _eventTag[_eventCount] = tag;
+    _eventUnits[_eventCount] = angleUnits;
+    _eventCount++;
+}
+
+void EventPlan::build() {
+    if (!_slotStart) return;
+    uint16_t cycleUnits = _sequential ? CrankAngle::UNITS_PER_CYCLE : CrankAngle::UNITS_PER_REV;
+    uint16_t slots = _sequential ? 2 * _geo.teeth : _geo.teeth;
+
+    // Event angles into [0, cycle) once, so the slot loop below is subtract-and-compare
+    for (uint8_t e = 0; e < _eventCount; e++) {
+        _eventUnits[e] = CrankAngle::wrap(_eventUnits[e], cycleUnits).units;
+    }
+
+    uint16_t n = 0;
+    bool full = false;
+    for (uint16_t s = 0; s < slots; s++) {
+        _slotStart[s] = n;
+        // Same angle the tooth reference carries: CrankSensor::toothAngleUnits(), + one
+        // revolution in the second half of the cycle
+        bool secondRev = s >= _geo.teeth;
+        uint16_t pos = secondRev ? s - _geo.teeth : s;
+        uint32_t a = ((uint32_t)pos * CrankAngle::UNITS_PER_REV) / _geo.teeth + CrankAngle::UNITS_PER_REV - _tdcOffsetUnits;
+        CrankAngle tooth((uint16_t)(a % CrankAngle::UNITS_PER_REV + (secondRev ? CrankAngle::UNITS_PER_REV : 0)));
+        for (uint8_t e = 0; e < _eventCount; e++) {
+            CrankAngle ahead = CrankAngle((uint16_t)_eventUnits[e]).subIn(tooth, cycleUnits);
+            if (ahead >= _lookahead) continue;
+            if (n >= _maxEntries) { full = true; continue; }
+            _entries[n].tag = _eventTag[e];
+            _entries[n].offset = ahead;
+            n++;
+        }
+    }
+    _slotStart[slots] = n;
+    _slots = slots;
+    if (full) __atomic_add_fetch(&_overflows, 1, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,103 @@
+#include "EventScheduler.h"
+#include <string.h>
+
+EventScheduler::EventScheduler()
+    : _backend(nullptr), _count(0), _armedAtUs(NO_ALARM),
+      _refTimeUs(0), _usPerUnitQ(0), _cycleUnits(CrankAngle::UNITS_PER_REV),
+      _firedCount(0), _lastLatencyUs(0), _maxLatencyUs(0) {
+    memset(_events, 0, sizeof(_events));
+}
+
+void EventScheduler::begin(TimerBackend* backend) {
+    _backend = backend;
+    _armedAtUs = NO_ALARM;
+}
+
+uint8_t EventScheduler::allocate(Callback cb, void* arg) {
+    if (_count >= MAX_EVENTS || !cb) return INVALID_EVENT;
+    Event& e = _events[_count];
+    e.cb = cb;
+    e.arg = arg;
+    e.whenUs = 0;
+    e.pending = false;
+    return _count++;
+}
+
+void EventScheduler::scheduleAt(uint8_t id, int64_t whenUs) {
+    if (id >= _count || !_backend) return;
+    _events[id].whenUs = whenUs;
+    _events[id].pending = true;
+    // Only pull the alarm in — a later reschedule is picked up by rearm() on the next dispatch
+    if (whenUs < _armedAtUs) {
+        _armedAtUs = whenUs;
+        _backend->armAt(whenUs);
+    }
+}
+
+void EventScheduler::scheduleAtAngle(uint8_t id, CrankAngle angle) {
+    if (_usPerUnitQ == 0) return;  // No angle base yet (not synced)
+    scheduleAt(id, angleToTimeUs(angle));
+}
+
+void EventScheduler::scheduleAfterReference(uint8_t id, CrankAngle offset) {
+    if (_usPerUnitQ == 0) return;
+    scheduleAt(id, offsetToTimeUs(offset));
+}
+
+void EventScheduler::cancel(uint8_t id) {
+    if (id < _count) _events[id].pending = false;
+}
+
+void EventScheduler::cancelAll() {
+    for (uint8_t i = 0; i < _count; i++) _events[i].pending = false;
+    _armedAtUs = NO_ALARM;
+    if (_backend) _backend->disarm();
+}
+
+void EventScheduler::setAngleReference(int64_t toothTimeUs, CrankAngle toothAngle, uint32_t usPerUnitQ, uint16_t cycleUnits) {
+    _refTimeUs = toothTimeUs;
+    _refAngle = toothAngle;
+    _usPerUnitQ = usPerUnitQ;
+    _cycleUnits = cycleUnits;
+}
+
+int64_t EventScheduler::angleToTimeUs(CrankAngle angle) const {
+    // Angles are always ahead of the reference tooth — distance forward within the cycle
+    CrankAngle a = (angle.units >= _cycleUnits) ? CrankAngle(angle.units - _cycleUnits) : angle;
+    return offsetToTimeUs(a.subIn(_refAngle, _cycleUnits));
+}
+
+void EventScheduler::dispatch() {
+    if (!_backend) return;
+    _armedAtUs = NO_ALARM;
+
+    // Callbacks may schedule further events (e.g. injector close) — loop until nothing is due
+    bool fired;
+    do {
+        fired = false;
+        int64_t nowUs = _backend->nowUs();
+        for (uint8_t i = 0; i < _count; i++) {
+            Event& e = _events[i];
+            if (!e.pending || e.whenUs > nowUs + DISPATCH_SLACK_US) continue;
+            e.pending = false;
+            uint32_t latency = (nowUs > e.whenUs) ? (uint32_t)(nowUs - e.whenUs) : 0;
+            _lastLatencyUs = latency;
+            if (latency > _maxLatencyUs) _maxLatencyUs = latency;
+            _firedCount++;
+            e.cb(e.arg);
+            fired = true;
+        }
+    } while (fired);
+
+    rearm();
+}
+
+void EventScheduler::rearm() {
+    int64_t next = NO_ALARM;
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_events[i].pending && _events[i].whenUs < next) next = _events[i].whenUs;
+    }
+    _armedAtUs = next;
+    if (next == NO_ALARM) _backend->disarm();
+    else _backend->armAt(next);
+}
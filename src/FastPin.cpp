@@ -0,0 +1,31 @@
+#include "FastPin.h"
+#include "PinExpander.h"
+#include <driver/gpio.h>
+
+bool FastPin::attach(uint16_t pin) {
+    _pin = pin;
+    _mask = 0;
+    if (pin == 0) return false;
+
+    xPinMode(pin, OUTPUT);
+    xDigitalWrite(pin, LOW);
+    _slow.attach(pin);
+    if (pin >= SPI_EXP_PIN_OFFSET) {
+        // Timing-critical expander output: its device's writes jump the SPI bus queue
+        PinExpander::instance().setUrgent(pin - SPI_EXP_PIN_OFFSET);
+        return false;
+    }
+    if (!GPIO_IS_VALID_OUTPUT_GPIO(pin)) return false;
+
+    // pinMode() has routed the pad to the GPIO matrix; from here on only the bank register moves it
+    if (pin < 32) {
+        _mask = 1UL << pin;
+        _setReg = GPIO_OUT_W1TS_REG;
+        _clrReg = GPIO_OUT_W1TC_REG;
+    } else {
+        _mask = 1UL << (pin - 32);
+        _setReg = GPIO_OUT1_W1TS_REG;
+        _clrReg = GPIO_OUT1_W1TC_REG;
+    }
+    return true;
+}
@@ -0,0 +1,53 @@
+#include "HwTimerBackend.h"
+#include "Logger.h"
+
+HwTimerBackend* HwTimerBackend::_instance = nullptr;
+
+HwTimerBackend::HwTimerBackend() : _timer(nullptr), _notifyTask(nullptr), _notifyBits(0) {}
+
+HwTimerBackend::~HwTimerBackend() {
+    if (_timer) {
+        timerAlarmDisable(_timer);
+        timerDetachInterrupt(_timer);
+        timerEnd(_timer);
+        _timer = nullptr;
+    }
+    if (_instance == this) _instance = nullptr;
+}
+
+bool HwTimerBackend::begin(uint8_t timerNum, TaskHandle_t notifyTask, uint32_t notifyBits) {
+    _notifyTask = notifyTask;
+    _notifyBits = notifyBits;
+
+    // APB 80 MHz / 80 = 1 MHz tick, counting up, 1 us alarm resolution
+    _timer = timerBegin(timerNum, 80, true);
+    if (!_timer) {
+        Log.error("SCHED", "Hardware timer %d unavailable", timerNum);
+        return false;
+    }
+    _instance = this;
+    timerAttachInterrupt(_timer, onAlarm, true);
+    timerAlarmDisable(_timer);
+
+    Log.info("SCHED", "Event scheduler on hardware timer %d (1 MHz)", timerNum);
+    return true;
+}
+
+void HwTimerBackend::armAt(int64_t whenUs) {
+    if (!_timer) return;
+    int64_t deltaUs = whenUs - esp_timer_get_time();
+    if (deltaUs < 1) deltaUs = 1;  // Already due — fire on the next tick
+    timerAlarmWrite(_timer, timerRead(_timer) + (uint64_t)deltaUs, false);
+    timerAlarmEnable(_timer);
+}
+
+void HwTimerBackend::disarm() {
+    if (_timer) timerAlarmDisable(_timer);
+}
+
+void IRAM_ATTR HwTimerBackend::onAlarm() {
+    if (!_instance || !_instance->_notifyTask) return;
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(_instance->_notifyTask, _instance->_notifyBits, eSetBits, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
@@ -0,0 +1,97 @@
+#include "I2cBus.h"
+#include "ADS1115Reader.h"
+#include "Logger.h"
+#include <Wire.h>
+
+I2cBus& I2cBus::instance() {
+    static I2cBus inst;
+    return inst;
+}
+
+bool I2cBus::begin(uint8_t sdaPin, uint8_t sclPin) {
+    _sda = sdaPin;
+    _scl = sclPin;
+    initWire();
+    return _wireUp;
+}
+
+void I2cBus::initWire() {
+    _wireUp = Wire.begin(_sda, _scl);
+    Wire.setTimeOut(10);    // 10ms I2C bus timeout (capital O = I2C, not Stream)
+    Wire.setClock(CLOCK_HZ);
+}
+
+bool I2cBus::addDevice(ADS1115Reader* dev) {
+    if (!dev || _task || _deviceCount >= MAX_DEVICES) return false;
+    _dev[_deviceCount++] = dev;
+    return true;
+}
+
+bool I2cBus::start() {
+    if (_task) return true;
+    if (!_wireUp || _deviceCount == 0) return false;
+    // Core 0, below the SPI bus and expander interrupt tasks — it mostly sleeps between polls
+    if (xTaskCreatePinnedToCore(busTask, "i2c_bus", 3072, this, 3, &_task, 0) != pdPASS) {
+        _task = nullptr;
+        Log.error("I2C", "Cannot start I2C bus task");
+        return false;
+    }
+    Log.info("I2C", "I2C bus task running (%d device%s, %lu kHz)",
+             _deviceCount, _deviceCount == 1 ? "" : "s", (unsigned long)(CLOCK_HZ / 1000));
+    return true;
+}
+
+// A slave reset or glitched mid-read can hold SDA low forever; clocking SCL lets it finish
+// shifting out its byte and release the line. Then a STOP, and Wire starts from scratch.
+bool I2cBus::recover() {
+    _recoveries++;
+    Wire.end();
+
+    pinMode(_sda, INPUT_PULLUP);
+    pinMode(_scl, OUTPUT_OPEN_DRAIN);
+    digitalWrite(_scl, HIGH);
+    delayMicroseconds(5);
+    for (uint8_t i = 0; i < 9 && digitalRead(_sda) == LOW; i++) {
+        digitalWrite(_scl, LOW);
+        delayMicroseconds(5);
+        digitalWrite(_scl, HIGH);
+        delayMicroseconds(5);
+    }
+    // STOP: SDA rises while SCL is high
+    pinMode(_sda, OUTPUT_OPEN_DRAIN);
+    digitalWrite(_sda, LOW);
+    delayMicroseconds(5);
+    digitalWrite(_scl, HIGH);
+    delayMicroseconds(5);
+    digitalWrite(_sda, HIGH);
+    delayMicroseconds(5);
+    pinMode(_sda, INPUT_PULLUP);
+    bool released = digitalRead(_sda) == HIGH;
+
+    initWire();
+    for (uint8_t i = 0; i < _deviceCount; i++) _dev[i]->abort();
+    return released && _wireUp;
+}
+
+void I2cBus::busTask(void* param) {
+    I2cBus* self = (I2cBus*)param;
+    while (true) {
+        uint32_t t0 = micros();
+        bool stuck = false;
+        for (uint8_t i = 0; i < self->_deviceCount; i++) {
+            ADS1115Reader* dev = self->_dev[i];
+            if (!dev->poll() && dev->getErrorRun() >= RECOVER_AFTER_ERRORS) stuck = true;
+        }
+        uint32_t us = micros() - t0;
+        if (us > self->_pollMaxUs) self->_pollMaxUs = us;
+        self->_polls++;
+
+        if (stuck && millis() - self->_lastRecoverMs >= RECOVER_BACKOFF_MS) {
+            self->_lastRecoverMs = millis();
+            bool ok = self->recover();
+            Log.warn("I2C", "Bus recovery #%lu: %s", (unsigned long)self->_recoveries,
+                     ok ? "SDA released, Wire restarted" : "SDA still held low");
+        }
+        vTaskDelay(1);
+    }
+}
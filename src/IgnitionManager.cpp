@@ -1,14 +1,24 @@
 #include "IgnitionManager.h"
+#include "EventScheduler.h"
 #include "PinExpander.h"
 #include "Logger.h"
+#include "TriggerLogger.h"
+
+// Dwell angle per RPM: ms x (rpm x 360 / 60000) deg/ms x 32 units/deg, Q16
+static uint32_t dwellUnitsPerRpmQ16(float dwellMs) {
+    return (uint32_t)(dwellMs * 0.006f * CrankAngle::UNITS_PER_DEG * 65536.0f + 0.5f);
+}
 
 IgnitionManager::IgnitionManager()
-    : _numCylinders(0), _advanceDeg(10.0f), _dwellMs(DEFAULT_DWELL_MS),
-      _maxDwellMs(4.0f), _revLimit(DEFAULT_REV_LIMIT), _configRevLimit(DEFAULT_REV_LIMIT),
-      _revLimiting(false), _overdwellCount(0) {
+    : _numCylinders(0), _fastCoils(0), _sparkLatencyUs(0), _sparkMaxLatencyUs(0), _advanceDeg(10.0f), _dwellMs(DEFAULT_DWELL_MS),
+      _maxDwellMs(4.0f), _advanceUnits(10 * CrankAngle::UNITS_PER_DEG), _dwellUnitsPerRpmQ16(0),
+      _maxDwellUs(4000), _revLimit(DEFAULT_REV_LIMIT), _configRevLimit(DEFAULT_REV_LIMIT),
+      _revLimiting(false), _overdwellCount(0), _lastOverdwellCyl(0), _lastOverdwellUs(0), _scheduler(nullptr),
+      _planDirty(true), _planDwellUnits(0) {
     memset(_coilPins, 0, sizeof(_coilPins));
     memset(_firingOrder, 0, sizeof(_firingOrder));
     memset(_coilState, 0, sizeof(_coilState));
+    _dwellUnitsPerRpmQ16 = dwellUnitsPerRpmQ16(_dwellMs);
 }
 
 IgnitionManager::~IgnitionManager() {}
@@ -18,30 +28,59 @@ void IgnitionManager::begin(uint8_t numCylinders, const uint16_t* coilPins, cons
     memcpy(_coilPins, coilPins, _numCylinders * sizeof(uint16_t));
     memcpy(_firingOrder, firingOrder, _numCylinders);
 
+    _fastCoils = 0;
     for (uint8_t i = 0; i < _numCylinders; i++) {
-        if (_coilPins[i] != 0) {
-            xPinMode(_coilPins[i], OUTPUT);
-            xDigitalWrite(_coilPins[i], LOW);
+        if (_coilOut[i].attach(_coilPins[i])) _fastCoils++;
+    }
+    for (uint8_t c = 0; c < MAX_CYLINDERS; c++) {
+        CoilState& cs = _coilState[c];
+        cs.owner = this;
+        cs.cyl = c;
+        cs.charging = false;
+        cs.dwellStartUs = 0;
+        cs.dwellEvent = EventScheduler::INVALID_EVENT;
+        cs.sparkEvent = EventScheduler::INVALID_EVENT;
+        cs.overdwellEvent = EventScheduler::INVALID_EVENT;
+        if (_scheduler && c < _numCylinders && _coilPins[c] != 0) {
+            // A coil is only planned if all three slots exist — never charge without a cutoff
+            cs.overdwellEvent = _scheduler->allocate(onOverdwell, &cs);
+            if (cs.overdwellEvent != EventScheduler::INVALID_EVENT) {
+                cs.dwellEvent = _scheduler->allocate(onDwellStart, &cs);
+                cs.sparkEvent = _scheduler->allocate(onSpark, &cs);
+            }
         }
-        _coilState[i] = {false, 0};
     }
 
-    Log.info("IGN", "Ignition initialized: %d cylinders, advance=%.1f deg", _numCylinders, _advanceDeg);
+    Log.info("IGN", "Ignition initialized: %d cylinders, advance=%.1f deg, %d/%d coils on native GPIO",
+             _numCylinders, _advanceDeg, _fastCoils, _numCylinders);
+}
+
+void IgnitionManager::setTriggerGeometry(const TriggerDecoder::Geometry& geo) {
+    _plan.setGeometry(geo, 2 * MAX_CYLINDERS);
+    _planDirty = true;
 }
 
 void IgnitionManager::setAdvance(float deg) {
-    _advanceDeg = constrain(deg, -10.0f, 60.0f);
+    float a = constrain(deg, -10.0f, 60.0f);
+    if (a == _advanceDeg) return;
+    _advanceDeg = a;
+    _advanceUnits = (int16_t)(a * CrankAngle::UNITS_PER_DEG + (a < 0 ? -0.5f : 0.5f));
+    _planDirty = true;
 }
 
 void IgnitionManager::setDwellMs(float ms) {
-    _dwellMs = constrain(ms, 0.5f, _maxDwellMs);
+    float d = constrain(ms, 0.5f, _maxDwellMs);
+    if (d == _dwellMs) return;
+    _dwellMs = d;
+    _dwellUnitsPerRpmQ16 = dwellUnitsPerRpmQ16(d);
+    _planDirty = true;
 }
 
 void IgnitionManager::setRevLimit(uint16_t rpm) {
     _revLimit = rpm;
 }
 
-void IgnitionManager::update(uint16_t rpm, uint16_t toothPos, bool sequential) {
+void IgnitionManager::update(uint16_t rpm, const CrankSensor::ToothReference& ref, bool newTooth) {
     // Rev limiter — cut spark above limit
     if (rpm > _revLimit) {
         if (!_revLimiting) {
@@ -52,82 +91,114 @@ void IgnitionManager::update(uint16_t rpm, uint16_t toothPos, bool sequential) {
     }
     _revLimiting = false;
 
-    if (rpm == 0 || _numCylinders == 0) return;
-
-    // Calculate degrees per tooth
-    // For a 36-1 wheel: 360/36 = 10 degrees per tooth
-    // toothPos is current tooth count (0 = TDC reference after gap)
-    float degreesPerTooth = 360.0f / 36.0f;  // TODO: get from crank sensor
-    float currentAngle = toothPos * degreesPerTooth;
-
-    // Dwell time in microseconds
-    float dwellUs = _dwellMs * 1000.0f;
+    if (rpm == 0 || _numCylinders == 0 || !_scheduler) return;
 
-    // Degrees per microsecond at current RPM
-    float degPerUs = (rpm * 360.0f) / 60000000.0f;
-    float dwellDeg = dwellUs * degPerUs;
+    // Dwell angle moves with RPM
+    uint16_t dwellUnits = (uint16_t)(((uint64_t)rpm * _dwellUnitsPerRpmQ16) >> 16);
+    uint16_t drift = (dwellUnits > _planDwellUnits) ? dwellUnits - _planDwellUnits : _planDwellUnits - dwellUnits;
+    bool sequential = ref.isSequential();
+    if (_planDirty || sequential != _plan.isSequential() || drift > REPLAN_DWELL_UNITS) {
+        rebuildPlan(dwellUnits, sequential);
+    }
 
-    // Firing interval: 720 degrees / numCylinders (4-stroke)
-    float firingIntervalDeg = 720.0f / _numCylinders;
+    // Events coming up within the lookahead window of this tooth. The window spans the
+    // missing-tooth gap plus one tooth; each later tooth re-arms the event with a fresher
+    // period, so the final timestamp comes from the last tooth.
+    if (newTooth) {
+        uint8_t n;
+        const EventPlan::Entry* e = _plan.entries(ref.cycleTooth, n);
+        for (uint8_t k = 0; k < n; k++) {
+            CoilState& cs = _coilState[e[k].tag & ~PLAN_SPARK];
+            if (e[k].tag & PLAN_SPARK) {
+                // onSpark() ignores a coil that never started charging
+                _scheduler->scheduleAfterReference(cs.sparkEvent, e[k].offset);
+            } else if (!cs.charging) {
+                _scheduler->scheduleAfterReference(cs.dwellEvent, e[k].offset);
+            }
+        }
+    }
 
+    // Overdwell is cut by each coil's own event; this only catches one whose event was lost
     int64_t nowUs = esp_timer_get_time();
+    for (uint8_t c = 0; c < _numCylinders; c++) {
+        CoilState& cs = _coilState[c];
+        if (cs.charging && nowUs - cs.dwellStartUs > (int64_t)_maxDwellUs) releaseOverdwell(cs, nowUs);
+    }
+}
 
+void IgnitionManager::rebuildPlan(uint16_t dwellUnits, bool sequential) {
+    _planDirty = false;
+    _planDwellUnits = dwellUnits;
+    _plan.clear(sequential);
+
+    // Firing interval: 720 degrees / numCylinders (4-stroke). The plan wraps angles into
+    // the cycle — in wasted spark mode every coil fires each 360 degrees.
+    int32_t firingInterval = CrankAngle::UNITS_PER_CYCLE / _numCylinders;
     for (uint8_t i = 0; i < _numCylinders; i++) {
         uint8_t cylIdx = _firingOrder[i] - 1;  // firingOrder is 1-based
-        if (cylIdx >= MAX_CYLINDERS) continue;
-
-        // Calculate spark angle for this cylinder
-        float sparkAngle = fmodf(i * firingIntervalDeg - _advanceDeg, 720.0f);
-        if (sparkAngle < 0) sparkAngle += 720.0f;
-
-        // In wasted spark mode, fire every 360 degrees
-        if (!sequential) {
-            sparkAngle = fmodf(sparkAngle, 360.0f);
-        }
-
-        float dwellStartAngle = sparkAngle - dwellDeg;
-        if (dwellStartAngle < 0) dwellStartAngle += sequential ? 720.0f : 360.0f;
-
-        // Check if we should start charging the coil
-        float angleWindow = degreesPerTooth * 1.5f;
-        float angleDiff = currentAngle - dwellStartAngle;
-        if (!sequential) angleDiff = fmodf(angleDiff, 360.0f);
-        if (angleDiff < 0) angleDiff += sequential ? 720.0f : 360.0f;
+        if (cylIdx >= MAX_CYLINDERS || _coilState[cylIdx].sparkEvent == EventScheduler::INVALID_EVENT ||
+            _coilState[cylIdx].dwellEvent == EventScheduler::INVALID_EVENT) continue;
+        int32_t sparkAngle = i * firingInterval - _advanceUnits;
+        _plan.add(cylIdx | PLAN_SPARK, sparkAngle);
+        _plan.add(cylIdx, sparkAngle - dwellUnits);
+    }
+    _plan.build();
+}
 
-        if (angleDiff >= 0 && angleDiff < angleWindow && !_coilState[cylIdx].charging) {
-            // Start dwell (charge coil)
-            xDigitalWrite(_coilPins[cylIdx], HIGH);
-            _coilState[cylIdx].charging = true;
-            _coilState[cylIdx].dwellStartUs = nowUs;
-        }
+void IgnitionManager::onDwellStart(void* arg) {
+    CoilState* cs = (CoilState*)arg;
+    IgnitionManager* self = cs->owner;
+    if (self->_revLimiting || cs->charging) return;
+    self->_coilOut[cs->cyl].write(HIGH);
+    cs->charging = true;
+    cs->dwellStartUs = esp_timer_get_time();
+    // Coil on-time is bounded from here by the timer, whatever the spark event does
+    self->_scheduler->scheduleAt(cs->overdwellEvent, cs->dwellStartUs + self->_maxDwellUs);
+    TrigLog.logTask(TriggerLogger::EVT_DWELL, cs->cyl, 0);
+}
 
-        // Check if we should fire (release coil)
-        float sparkDiff = currentAngle - sparkAngle;
-        if (!sequential) sparkDiff = fmodf(sparkDiff, 360.0f);
-        if (sparkDiff < 0) sparkDiff += sequential ? 720.0f : 360.0f;
+void IgnitionManager::onSpark(void* arg) {
+    CoilState* cs = (CoilState*)arg;
+    if (!cs->charging) return;
+    IgnitionManager* self = cs->owner;
+    self->_coilOut[cs->cyl].write(LOW);
+    self->_scheduler->cancel(cs->overdwellEvent);
+    int64_t late = esp_timer_get_time() - self->_scheduler->getScheduledUs(cs->sparkEvent);
+    uint32_t latency = late > 0 ? (uint32_t)late : 0;
+    self->_sparkLatencyUs = latency;
+    if (latency > self->_sparkMaxLatencyUs) self->_sparkMaxLatencyUs = latency;
+    cs->charging = false;
+    TrigLog.logTask(TriggerLogger::EVT_SPARK, cs->cyl, 0);
+}
 
-        if (sparkDiff >= 0 && sparkDiff < angleWindow && _coilState[cylIdx].charging) {
-            // Fire spark
-            xDigitalWrite(_coilPins[cylIdx], LOW);
-            _coilState[cylIdx].charging = false;
-        }
+void IgnitionManager::onOverdwell(void* arg) {
+    CoilState* cs = (CoilState*)arg;
+    if (!cs->charging) return;
+    cs->owner->releaseOverdwell(*cs, esp_timer_get_time());
+}
 
-        // Safety: max dwell time exceeded (overdwell protection)
-        if (_coilState[cylIdx].charging) {
-            float elapsedMs = (nowUs - _coilState[cylIdx].dwellStartUs) / 1000.0f;
-            if (elapsedMs > _maxDwellMs) {
-                xDigitalWrite(_coilPins[cylIdx], LOW);
-                _coilState[cylIdx].charging = false;
-                _overdwellCount++;
-                Log.warn("IGN", "Overdwell on cyl %d (%.1fms)", cylIdx, elapsedMs);
-            }
-        }
-    }
+// Real-time path: release the coil and count it. No logging here — ECU::update reports it.
+void IgnitionManager::releaseOverdwell(CoilState& cs, int64_t nowUs) {
+    _coilOut[cs.cyl].write(LOW);
+    cs.charging = false;
+    _scheduler->cancel(cs.sparkEvent);
+    _scheduler->cancel(cs.overdwellEvent);
+    _lastOverdwellCyl = cs.cyl;
+    _lastOverdwellUs = (uint32_t)(nowUs - cs.dwellStartUs);
+    __atomic_fetch_add(&_overdwellCount, 1, __ATOMIC_RELAXED);
+    TrigLog.logTask(TriggerLogger::EVT_SPARK, cs.cyl, 1);
 }
 
 void IgnitionManager::cutSpark() {
+    PinBatch batch;
     for (uint8_t i = 0; i < _numCylinders; i++) {
-        if (_coilPins[i] != 0) xDigitalWrite(_coilPins[i], LOW);
+        _coilOut[i].stage(batch, LOW);
         _coilState[i].charging = false;
+        if (_scheduler) {
+            _scheduler->cancel(_coilState[i].dwellEvent);
+            _scheduler->cancel(_coilState[i].sparkEvent);
+            _scheduler->cancel(_coilState[i].overdwellEvent);
+        }
     }
+    batch.commit();
 }
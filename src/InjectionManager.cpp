@@ -1,14 +1,19 @@
 #include "InjectionManager.h"
+#include "EventScheduler.h"
 #include "PinExpander.h"
 #include "Logger.h"
+#include "TriggerLogger.h"
 
 InjectionManager::InjectionManager()
-    : _numCylinders(0), _basePulseWidthUs(0), _deadTimeMs(DEFAULT_DEAD_TIME_MS),
-      _fuelCut(false) {
+    : _numCylinders(0), _fastInjectors(0), _openLatencyUs(0), _openMaxLatencyUs(0),
+      _pulseErrorUs(0), _pulseMaxErrorUs(0), _lateCloseCount(0), _basePulseWidthUs(0), _deadTimeMs(DEFAULT_DEAD_TIME_MS),
+      _fuelCut(false), _scheduler(nullptr), _planDirty(true), _batchMask(0),
+      _batchEvent(EventScheduler::INVALID_EVENT) {
     memset(_injectorPins, 0, sizeof(_injectorPins));
     memset(_firingOrder, 0, sizeof(_firingOrder));
     memset(_injState, 0, sizeof(_injState));
     for (uint8_t i = 0; i < MAX_CYLINDERS; i++) _trimPercent[i] = 1.0f;
+    updatePulses();
 }
 
 InjectionManager::~InjectionManager() {}
@@ -17,28 +22,58 @@ void InjectionManager::begin(uint8_t numCylinders, const uint16_t* injectorPins,
     _numCylinders = min(numCylinders, (uint8_t)MAX_CYLINDERS);
     memcpy(_injectorPins, injectorPins, _numCylinders * sizeof(uint16_t));
     memcpy(_firingOrder, firingOrder, _numCylinders);
+    _planDirty = true;
 
+    _fastInjectors = 0;
     for (uint8_t i = 0; i < _numCylinders; i++) {
-        if (_injectorPins[i] != 0) {
-            xPinMode(_injectorPins[i], OUTPUT);
-            xDigitalWrite(_injectorPins[i], LOW);
+        if (_injOut[i].attach(_injectorPins[i])) _fastInjectors++;
+    }
+    for (uint8_t c = 0; c < MAX_CYLINDERS; c++) {
+        InjectorState& st = _injState[c];
+        st.owner = this;
+        st.cyl = c;
+        st.open = false;
+        st.openTimeUs = 0;
+        st.scheduledPulseUs = 0;
+        st.pendingPulseUs = 0;
+        st.openEvent = EventScheduler::INVALID_EVENT;
+        st.closeEvent = EventScheduler::INVALID_EVENT;
+        if (_scheduler && c < _numCylinders && _injectorPins[c] != 0) {
+            st.closeEvent = _scheduler->allocate(onClose, &st);
+            // Never arm an open whose close could not be timed
+            if (st.closeEvent != EventScheduler::INVALID_EVENT) st.openEvent = _scheduler->allocate(onOpen, &st);
         }
-        _injState[i] = {false, 0, 0};
+    }
+    if (_scheduler && _batchEvent == EventScheduler::INVALID_EVENT) {
+        _batchEvent = _scheduler->allocate(onBatchOpen, this);
     }
 
-    Log.info("INJ", "Injection initialized: %d cylinders, deadTime=%.1fms", _numCylinders, _deadTimeMs);
+    Log.info("INJ", "Injection initialized: %d cylinders, deadTime=%.1fms, %d/%d injectors on native GPIO",
+             _numCylinders, _deadTimeMs, _fastInjectors, _numCylinders);
 }
 
 void InjectionManager::setPulseWidthUs(float pw) {
-    _basePulseWidthUs = constrain(pw, 0.0f, MAX_PULSE_WIDTH_US);
+    float v = constrain(pw, 0.0f, MAX_PULSE_WIDTH_US);
+    if (v == _basePulseWidthUs) return;
+    _basePulseWidthUs = v;
+    updatePulses();
 }
 
 void InjectionManager::setDeadTimeMs(float dt) {
     _deadTimeMs = constrain(dt, 0.0f, 5.0f);
+    updatePulses();
 }
 
 void InjectionManager::setTrim(uint8_t cyl, float trimPercent) {
-    if (cyl < MAX_CYLINDERS) _trimPercent[cyl] = constrain(trimPercent, 0.5f, 1.5f);
+    if (cyl >= MAX_CYLINDERS) return;
+    _trimPercent[cyl] = constrain(trimPercent, 0.5f, 1.5f);
+    updatePulses();
+}
+
+void InjectionManager::updatePulses() {
+    for (uint8_t c = 0; c < MAX_CYLINDERS; c++) {
+        _cylPulseUs[c] = (uint32_t)((_basePulseWidthUs * _trimPercent[c]) + (_deadTimeMs * 1000.0f) + 0.5f);
+    }
 }
 
 float InjectionManager::getTrim(uint8_t cyl) const {
@@ -52,68 +87,167 @@ float InjectionManager::getEffectivePulseWidthUs(uint8_t cyl) const {
 
 void InjectionManager::cutFuel() {
     _fuelCut = true;
+    closeAll();
+}
+
+void InjectionManager::closeAll() {
+    PinBatch batch;
     for (uint8_t i = 0; i < _numCylinders; i++) {
-        if (_injectorPins[i] != 0) xDigitalWrite(_injectorPins[i], LOW);
+        _injOut[i].stage(batch, LOW);
         _injState[i].open = false;
+        if (_scheduler) {
+            _scheduler->cancel(_injState[i].openEvent);
+            _scheduler->cancel(_injState[i].closeEvent);
+        }
     }
+    if (_scheduler) _scheduler->cancel(_batchEvent);
+    batch.commit();
 }
 
 void InjectionManager::resumeFuel() {
     _fuelCut = false;
 }
 
-void InjectionManager::update(uint16_t rpm, uint16_t toothPos, bool sequential) {
-    if (_fuelCut || rpm == 0 || _numCylinders == 0) return;
+void InjectionManager::setTriggerGeometry(const TriggerDecoder::Geometry& geo) {
+    _plan.setGeometry(geo, MAX_CYLINDERS);
+    _planDirty = true;
+}
+
+void InjectionManager::update(uint16_t rpm, const CrankSensor::ToothReference& ref, bool newTooth) {
+    if (_fuelCut || rpm == 0 || _numCylinders == 0 || !_scheduler) return;
+
+    bool sequential = ref.isSequential();
+    if (_planDirty || sequential != _plan.isSequential()) rebuildPlan(sequential);
+
+    // Arm opens inside the lookahead window (covers the missing-tooth gap)
+    if (newTooth) {
+        uint8_t n;
+        const EventPlan::Entry* e = _plan.entries(ref.cycleTooth, n);
+        for (uint8_t k = 0; k < n; k++) {
+            if (e[k].tag == PLAN_BATCH) {
+                bool any = false;
+                for (uint8_t c = 0; c < _numCylinders; c++) {
+                    if ((_batchMask & (1 << c)) && !_injState[c].open) {
+                        _injState[c].pendingPulseUs = armPulseUs(c);
+                        any |= _injState[c].pendingPulseUs != 0;
+                    }
+                }
+                if (any) _scheduler->scheduleAfterReference(_batchEvent, e[k].offset);
+                continue;
+            }
+            InjectorState& st = _injState[e[k].tag];
+            if (st.open) continue;
+            st.pendingPulseUs = armPulseUs(e[k].tag);
+            if (st.pendingPulseUs) _scheduler->scheduleAfterReference(st.openEvent, e[k].offset);
+        }
+    }
 
+    // Closes are timed by their own events; this only catches one whose event was lost
     int64_t nowUs = esp_timer_get_time();
+    uint8_t late = 0;
+    for (uint8_t c = 0; c < _numCylinders; c++) {
+        const InjectorState& st = _injState[c];
+        if (st.open && nowUs - st.openTimeUs >= (int64_t)(st.scheduledPulseUs + CLOSE_BACKSTOP_US)) late++;
+    }
+    if (late) {
+        _lateCloseCount += late;
+        closeDue(nowUs);
+    }
+}
 
-    // Calculate degrees per tooth (assuming 36 tooth wheel)
-    float degreesPerTooth = 360.0f / 36.0f;  // TODO: get from crank sensor
-    float currentAngle = toothPos * degreesPerTooth;
+void InjectionManager::rebuildPlan(bool sequential) {
+    _planDirty = false;
+    _plan.clear(sequential);
+    _batchMask = 0;
 
     // Firing interval: 720 degrees / numCylinders (4-stroke)
-    float firingIntervalDeg = 720.0f / _numCylinders;
-
+    int32_t firingInterval = CrankAngle::UNITS_PER_CYCLE / _numCylinders;
     for (uint8_t i = 0; i < _numCylinders; i++) {
         uint8_t cylIdx = _firingOrder[i] - 1;  // firingOrder is 1-based
-        if (cylIdx >= MAX_CYLINDERS) continue;
-
-        float effectivePw = getEffectivePulseWidthUs(cylIdx);
-        if (effectivePw <= 0) continue;
-
-        if (_injectorPins[cylIdx] == 0) continue;  // No pin assigned
+        if (cylIdx >= MAX_CYLINDERS || _injectorPins[cylIdx] == 0) continue;  // No pin assigned
+        if (_injState[cylIdx].openEvent == EventScheduler::INVALID_EVENT) continue;
 
         if (sequential) {
             // Sequential: inject during intake stroke for each cylinder
-            float injectAngle = fmodf(i * firingIntervalDeg + 360.0f, 720.0f);
-            float angleWindow = degreesPerTooth * 1.5f;
-            float angleDiff = currentAngle - injectAngle;
-            angleDiff = fmodf(angleDiff + 720.0f, 720.0f);
-
-            if (angleDiff >= 0 && angleDiff < angleWindow && !_injState[cylIdx].open) {
-                // Open injector
-                xDigitalWrite(_injectorPins[cylIdx], HIGH);
-                _injState[cylIdx].open = true;
-                _injState[cylIdx].openTimeUs = nowUs;
-                _injState[cylIdx].scheduledPulseUs = effectivePw;
-            }
+            _plan.add(cylIdx, i * firingInterval + CrankAngle::UNITS_PER_REV);
         } else {
-            // Batch mode: fire all injectors at TDC (tooth position 0)
-            if (toothPos == 0 && !_injState[cylIdx].open) {
-                xDigitalWrite(_injectorPins[cylIdx], HIGH);
-                _injState[cylIdx].open = true;
-                _injState[cylIdx].openTimeUs = nowUs;
-                _injState[cylIdx].scheduledPulseUs = effectivePw / 2.0f;  // Half PW per event (fires twice per cycle)
-            }
+            // Batch mode: fire all injectors at TDC (0 deg, every revolution)
+            _batchMask |= (1 << cylIdx);
         }
+    }
+    if (_batchMask && _batchEvent != EventScheduler::INVALID_EVENT) _plan.add(PLAN_BATCH, 0);
+    _plan.build();
+}
 
-        // Close injector when pulse width is complete
-        if (_injState[cylIdx].open) {
-            float elapsedUs = (float)(nowUs - _injState[cylIdx].openTimeUs);
-            if (elapsedUs >= _injState[cylIdx].scheduledPulseUs) {
-                xDigitalWrite(_injectorPins[cylIdx], LOW);
-                _injState[cylIdx].open = false;
-            }
-        }
+void InjectionManager::onOpen(void* arg) {
+    InjectorState* st = (InjectorState*)arg;
+    InjectionManager* self = st->owner;
+    if (self->_fuelCut || st->open) return;
+    self->_injOut[st->cyl].write(HIGH);
+    self->markOpen(*st, esp_timer_get_time(), self->_scheduler->getScheduledUs(st->openEvent));
+}
+
+void InjectionManager::onBatchOpen(void* arg) {
+    InjectionManager* self = (InjectionManager*)arg;
+    if (self->_fuelCut) return;
+    PinBatch batch;
+    uint16_t opened = 0;
+    for (uint8_t c = 0; c < self->_numCylinders; c++) {
+        const InjectorState& st = self->_injState[c];
+        if (!(self->_batchMask & (1 << c)) || st.open || st.pendingPulseUs == 0) continue;
+        self->_injOut[c].stage(batch, HIGH);
+        opened |= (1 << c);
+    }
+    batch.commit();
+
+    int64_t nowUs = esp_timer_get_time();
+    int64_t scheduledUs = self->_scheduler->getScheduledUs(self->_batchEvent);
+    for (uint8_t c = 0; c < self->_numCylinders; c++) {
+        if (opened & (1 << c)) self->markOpen(self->_injState[c], nowUs, scheduledUs);
+    }
+}
+
+void InjectionManager::markOpen(InjectorState& st, int64_t nowUs, int64_t scheduledUs) {
+    st.open = true;
+    st.openTimeUs = nowUs;
+    int64_t late = nowUs - scheduledUs;
+    uint32_t latency = late > 0 ? (uint32_t)late : 0;
+    _openLatencyUs = latency;
+    if (latency > _openMaxLatencyUs) _openMaxLatencyUs = latency;
+    st.scheduledPulseUs = st.pendingPulseUs;
+    // Close timed from the measured open, so a late open still delivers the full pulse
+    _scheduler->scheduleAt(st.closeEvent, nowUs + st.scheduledPulseUs);
+    TrigLog.logTask(TriggerLogger::EVT_INJ_OPEN, st.cyl, 0);
+}
+
+void InjectionManager::onClose(void* arg) {
+    InjectorState* st = (InjectorState*)arg;
+    st->owner->closeDue(esp_timer_get_time() + EventScheduler::DISPATCH_SLACK_US);
+}
+
+// Close every injector whose pulse ends by dueByUs in one pass — batch-opened injectors
+// with equal pulses share one expander write, and the others' close events are dropped
+void InjectionManager::closeDue(int64_t dueByUs) {
+    PinBatch batch;
+    uint16_t closed = 0;
+    for (uint8_t c = 0; c < _numCylinders; c++) {
+        InjectorState& st = _injState[c];
+        if (!st.open || st.openTimeUs + (int64_t)st.scheduledPulseUs > dueByUs) continue;
+        _injOut[c].stage(batch, LOW);
+        st.open = false;
+        _scheduler->cancel(st.closeEvent);
+        closed |= (1 << c);
+    }
+    batch.commit();
+
+    int64_t nowUs = esp_timer_get_time();
+    for (uint8_t c = 0; c < _numCylinders; c++) {
+        if (!(closed & (1 << c))) continue;
+        const InjectorState& st = _injState[c];
+        int32_t err = (int32_t)(nowUs - st.openTimeUs - (int64_t)st.scheduledPulseUs);
+        uint32_t mag = err < 0 ? (uint32_t)-err : (uint32_t)err;
+        _pulseErrorUs = err;
+        if (mag > _pulseMaxErrorUs) _pulseMaxErrorUs = mag;
+        TrigLog.logTask(TriggerLogger::EVT_INJ_CLOSE, c, 0);
     }
 }
@@ -1,28 +1,33 @@
 #include "MCP3204Reader.h"
 #include "Logger.h"
 
-MCP3204Reader::MCP3204Reader() : _spi(nullptr), _cs(0), _vRef(5.0f), _ready(false) {}
+MCP3204Reader::MCP3204Reader()
+    : _dev(SpiBus::INVALID_DEVICE), _cs(0), _vRef(5.0f), _ready(false), _oversample(4), _used(0),
+      _snapValid(0), _snapUs(0), _bursts(0), _snapHits(0) {
+    memset(_snapMv, 0, sizeof(_snapMv));
+    memset(&_async, 0, sizeof(_async));
+}
 
-bool MCP3204Reader::begin(SPIClass* spi, uint8_t csPin, float vRef) {
-    _spi = spi;
+bool MCP3204Reader::begin(uint8_t csPin, float vRef) {
     _cs = csPin;
     _vRef = vRef;
 
-    pinMode(_cs, OUTPUT);
-    digitalWrite(_cs, HIGH);
+    // CS is driven by the SPI host for each queued transaction
+    _dev = SpiBus::instance().addDevice(_cs, SPI_SPEED, 0);
+    if (_dev == SpiBus::INVALID_DEVICE) return false;
 
     // Probe: read channel 0 and verify response is plausible
     // MCP3204 single-ended command: start=1, SGL/DIFF=1, D2=0, D1=0, D0=0 for CH0
     // Byte 0: 0b00000110 (start + SGL)
     // Byte 1: 0b00000000 (D2=0, D1=0, D0=0, rest don't care)
     // Byte 2: 0b00000000 (clock out result)
-    _spi->beginTransaction(SPISettings(SPI_SPEED, MSBFIRST, SPI_MODE0));
-    digitalWrite(_cs, LOW);
-    uint8_t b0 = _spi->transfer(0x06);  // start=1, SGL=1
-    uint8_t b1 = _spi->transfer(0x00);  // CH0 (D2=0,D1=0,D0=0)
-    uint8_t b2 = _spi->transfer(0x00);  // clock out result
-    digitalWrite(_cs, HIGH);
-    _spi->endTransaction();
+    uint8_t tx[3] = {0x06, 0x00, 0x00};  // start=1, SGL=1 / CH0 (D2=0,D1=0,D0=0) / clock out result
+    SpiFuture f;
+    if (!SpiBus::instance().transfer(_dev, tx, sizeof(tx), f)) return false;
+    f.wait();
+    uint8_t b0 = f[0];
+    uint8_t b1 = f[1];
+    uint8_t b2 = f[2];
 
     // b1 contains null bit + upper 4 bits of result, b2 contains lower 8 bits
     // If no device: all 0xFF (MISO pulled high) or all 0x00 (MISO pulled low)
@@ -50,28 +55,106 @@ bool MCP3204Reader::begin(SPIClass* spi, uint8_t csPin, float vRef) {
     return true;
 }
 
+void MCP3204Reader::setOversampling(uint8_t n) {
+    _oversample = constrain(n, (uint8_t)1, MAX_OVERSAMPLE);
+}
+
+// MCP3204 single-ended command format:
+// Byte 0: 0b0000_0 1 1 D2  — start bit=1, SGL/DIFF=1, D2
+// Byte 1: 0b D1 D0 x x x x x x — D1, D0, then don't care
+// Byte 2: 0b x x x x x x x x — clock out remaining result bits
+void MCP3204Reader::command(uint8_t ch, uint8_t* tx) {
+    tx[0] = 0x06 | ((ch >> 2) & 0x01);  // 0b00000110 | D2
+    tx[1] = (ch & 0x03) << 6;            // D1,D0 in bits 7:6
+    tx[2] = 0x00;
+}
+
 int16_t MCP3204Reader::readChannel(uint8_t ch) {
     if (!_ready || ch > 3) return 0;
 
-    // MCP3204 single-ended command format:
-    // Byte 0: 0b0000_0 1 1 D2  — start bit=1, SGL/DIFF=1, D2
-    // Byte 1: 0b D1 D0 x x x x x x — D1, D0, then don't care
-    // Byte 2: 0b x x x x x x x x — clock out remaining result bits
-    uint8_t cmd0 = 0x06 | ((ch >> 2) & 0x01);  // 0b00000110 | D2
-    uint8_t cmd1 = (ch & 0x03) << 6;            // D1,D0 in bits 7:6
-
-    _spi->beginTransaction(SPISettings(SPI_SPEED, MSBFIRST, SPI_MODE0));
-    digitalWrite(_cs, LOW);
-    _spi->transfer(cmd0);
-    uint8_t hi = _spi->transfer(cmd1);
-    uint8_t lo = _spi->transfer(0x00);
-    digitalWrite(_cs, HIGH);
-    _spi->endTransaction();
+    uint8_t tx[3];
+    command(ch, tx);
+    SpiFuture f;
+    if (!SpiBus::instance().transfer(_dev, tx, sizeof(tx), f)) return 0;
+    f.wait();
+    uint8_t hi = f[1];
+    uint8_t lo = f[2];
 
     return (int16_t)(((uint16_t)(hi & 0x0F) << 8) | lo);
 }
 
+// ---- Burst snapshot ----
+
+uint8_t MCP3204Reader::burstStep(void* arg, uint8_t i, uint8_t* tx) {
+    Burst* b = (Burst*)arg;
+    command(b->ch[i % b->count], tx);
+    return 3;
+}
+
+void MCP3204Reader::burstCollect(void* arg, uint8_t i, const uint8_t* rx) {
+    Burst* b = (Burst*)arg;
+    uint8_t k = i % b->count;
+    b->sum[k] += ((uint16_t)(rx[1] & 0x0F) << 8) | rx[2];
+    b->samples[k]++;
+}
+
+bool MCP3204Reader::refresh() {
+    if (!_ready || !_used) return false;
+    Burst b = {};
+    uint8_t used = _used;
+    for (uint8_t ch = 0; ch < 4; ch++) {
+        if (used & (1 << ch)) b.ch[b.count++] = ch;
+    }
+    {
+        SpiFuture f;    // Scoped: the bus task is done with b before it is read
+        if (!SpiBus::instance().burst(_dev, b.count * _oversample, burstStep, burstCollect, &b, f)) return false;
+        f.wait();
+    }
+    // Averaged over the conversions that came back — a failed transmit is never collected.
+    // Averaging keeps the fraction: 16 samples resolve 1/16 LSB of the 12-bit result.
+    float fullScale = _vRef * 1000.0f / 4095.0f;
+    uint8_t valid = _snapValid;
+    for (uint8_t k = 0; k < b.count; k++) {
+        if (!b.samples[k]) continue;    // Keeps its last average
+        _snapMv[b.ch[k]] = b.sum[k] * fullScale / b.samples[k];
+        valid |= (1 << b.ch[k]);
+    }
+    _snapValid = valid;
+    _snapUs = esp_timer_get_time();
+    _bursts++;
+    return true;
+}
+
+// Never refreshes: the burst runs only from ECU::update, so the web task's reads can't race it
 float MCP3204Reader::readMillivolts(uint8_t ch) {
-    int16_t raw = readChannel(ch);
-    return (float)raw * _vRef * 1000.0f / 4095.0f;
+    if (!_ready || ch > 3) return 0.0f;
+    uint8_t bit = 1 << ch;
+    if (!(_used & bit)) __atomic_fetch_or(&_used, bit, __ATOMIC_RELAXED);
+    if (!(_snapValid & bit)) return 0.0f;
+    if (esp_timer_get_time() - _snapUs <= (int64_t)SNAPSHOT_MAX_AGE_US) _snapHits++;
+    return _snapMv[ch];
+}
+
+// ---- Async single conversion ----
+
+uint8_t MCP3204Reader::asyncStep(void* arg, uint8_t i, uint8_t* tx) {
+    command(((MCP3204Reader*)arg)->_async.ch, tx);
+    return 3;
+}
+
+void MCP3204Reader::asyncCollect(void* arg, uint8_t i, const uint8_t* rx) {
+    MCP3204Reader* self = (MCP3204Reader*)arg;
+    uint16_t raw = ((uint16_t)(rx[1] & 0x0F) << 8) | rx[2];
+    self->_async.fn(self->_async.arg, self->_async.tag, raw * self->_vRef * 1000.0f / 4095.0f);
+}
+
+bool MCP3204Reader::convertAsync(uint8_t ch, uint8_t tag, SampleFn fn, void* arg) {
+    if (!_ready || ch > 3 || !fn || _asyncDone.isPending()) return false;
+    _asyncDone.wait();      // Consume the last completion (returns at once)
+    _async.fn = fn;
+    _async.arg = arg;
+    _async.ch = ch;
+    _async.tag = tag;
+    // A one-step burst: the result is handed over in the bus task, nobody blocks on it
+    return SpiBus::instance().burst(_dev, 1, asyncStep, asyncCollect, this, _asyncDone);
 }
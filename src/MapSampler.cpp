@@ -0,0 +1,133 @@
+#include "MapSampler.h"
+#include "EventScheduler.h"
+#include "Logger.h"
+
+MapSampler::MapSampler()
+    : _scheduler(nullptr), _convert(nullptr), _convertArg(nullptr), _numCylinders(0),
+      _startDeg(0.0f), _widthDeg(0.0f), _samples(0), _planDirty(true),
+      _accSum(0.0f), _accCount(0), _accWindow(0),
+      _windowSeq(0), _refused(0) {
+    memset(&_window, 0, sizeof(_window));
+    for (uint8_t j = 0; j < MAX_SAMPLES; j++) {
+        _slot[j].owner = this;
+        _slot[j].event = EventScheduler::INVALID_EVENT;
+        _slot[j].tag = 0;
+    }
+}
+
+void MapSampler::setTriggerGeometry(const TriggerDecoder::Geometry& geo) {
+    _plan.setGeometry(geo, MAX_CYLINDERS * MAX_SAMPLES);
+    _planDirty = true;
+}
+
+void MapSampler::begin(uint8_t numCylinders) {
+    _numCylinders = min(numCylinders, (uint8_t)MAX_CYLINDERS);
+    if (_scheduler) {
+        for (uint8_t j = 0; j < MAX_SAMPLES; j++) {
+            if (_slot[j].event == EventScheduler::INVALID_EVENT)
+                _slot[j].event = _scheduler->allocate(onSample, &_slot[j]);
+        }
+    }
+    _planDirty = true;
+}
+
+void MapSampler::setWindow(float startDeg, float widthDeg, uint8_t samples) {
+    _startDeg = startDeg;
+    _widthDeg = widthDeg < 0.0f ? 0.0f : widthDeg;
+    _samples = min(samples, MAX_SAMPLES);
+    _planDirty = true;
+    if (_samples && _numCylinders) {
+        float spacing = 720.0f / _numCylinders;
+        Log.info("MAP", "Crank-synchronous MAP: %d samples in %.1f deg from %.1f deg ATDC, every %.1f deg",
+                 _samples, (_widthDeg > 0.0f && _widthDeg < spacing) ? _widthDeg : spacing, _startDeg, spacing);
+    }
+}
+
+void MapSampler::update(uint16_t rpm, const CrankSensor::ToothReference& ref, bool newTooth) {
+    if (!newTooth || rpm == 0 || !_scheduler || !isEnabled() || _numCylinders == 0) return;
+
+    bool sequential = ref.isSequential();
+    if (_planDirty || sequential != _plan.isSequential()) rebuildPlan(sequential);
+
+    uint8_t n;
+    const EventPlan::Entry* e = _plan.entries(ref.cycleTooth, n);
+    for (uint8_t k = 0; k < n; k++) {
+        SampleSlot& s = _slot[e[k].tag % MAX_SAMPLES];
+        if (s.event == EventScheduler::INVALID_EVENT) continue;
+        s.tag = e[k].tag;
+        _scheduler->scheduleAfterReference(s.event, e[k].offset);
+    }
+}
+
+void MapSampler::rebuildPlan(bool sequential) {
+    _planDirty = false;
+    _plan.clear(sequential);
+    if (_samples == 0 || _numCylinders == 0) {
+        _plan.build();
+        return;
+    }
+
+    // Windows no wider than the event spacing, so two never overlap
+    int32_t interval = CrankAngle::UNITS_PER_CYCLE / _numCylinders;
+    int32_t width = CrankAngle::fromDeg(_widthDeg).units;
+    if (width == 0 || width > interval) width = interval;
+    int32_t start = (int32_t)(_startDeg * CrankAngle::UNITS_PER_DEG);
+    // 360 deg cycle: a window and the one a revolution later land on the same angles
+    int32_t span = sequential ? CrankAngle::UNITS_PER_CYCLE : CrankAngle::UNITS_PER_REV;
+    for (uint8_t w = 0; w < _numCylinders && w * interval < span; w++) {
+        for (uint8_t j = 0; j < _samples; j++) {
+            int32_t at = w * interval + start + (width * (2 * j + 1)) / (2 * _samples);
+            _plan.add(w * MAX_SAMPLES + j, at);
+        }
+    }
+    _plan.build();
+}
+
+void MapSampler::onSample(void* arg) {
+    SampleSlot* s = (SampleSlot*)arg;
+    MapSampler* self = s->owner;
+    if (!self->_convert || !self->_convert(self->_convertArg, s->tag)) self->_refused++;
+}
+
+void MapSampler::addSample(uint8_t tag, float value) {
+    uint8_t window = tag / MAX_SAMPLES;
+    // First sample of the next window closes this one, even if its last sample was lost
+    if (_accCount && window != _accWindow) publish();
+    _accWindow = window;
+    _accSum += value;
+    _accCount++;
+    if (tag % MAX_SAMPLES == _samples - 1) publish();
+}
+
+void MapSampler::publish() {
+    // Single writer (the conversion side): count odd, write, count even
+    uint32_t seq = _windowSeq;
+    __atomic_store_n(&_windowSeq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    _window.load = _accSum / _accCount;
+    _window.samples = _accCount;
+    _window.timeUs = esp_timer_get_time();
+    _window.count++;
+    __atomic_store_n(&_windowSeq, seq + 2, __ATOMIC_RELEASE);
+    _accSum = 0.0f;
+    _accCount = 0;
+}
+
+bool MapSampler::readWindow(Window& out) const {
+    // Bounded retries: a reader that preempted publish() mid-write must not spin on it
+    for (uint8_t tries = 0; tries < 4; tries++) {
+        uint32_t seq = __atomic_load_n(&_windowSeq, __ATOMIC_ACQUIRE);
+        if (seq & 1) continue;
+        out = _window;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (seq == __atomic_load_n(&_windowSeq, __ATOMIC_RELAXED)) return true;
+    }
+    return false;
+}
+
+bool MapSampler::getLoad(int64_t nowUs, float& load) const {
+    Window w;
+    if (!readWindow(w) || w.count == 0 || nowUs - w.timeUs >= (int64_t)LOAD_MAX_AGE_US) return false;
+    load = w.load;
+    return true;
+}
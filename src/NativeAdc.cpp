@@ -0,0 +1,139 @@
+#include "NativeAdc.h"
+#include "Logger.h"
+#include <driver/adc.h>
+
+NativeAdc& NativeAdc::instance() {
+    static NativeAdc inst;
+    return inst;
+}
+
+// Arduino numbers ADC2 channels after ADC1's, so 0-9 is ADC1
+int8_t NativeAdc::channelOf(uint8_t pin) {
+    int8_t ch = digitalPinToAnalogChannel(pin);
+    return (ch >= 0 && ch < ADC1_CHANNELS) ? ch : -1;
+}
+
+bool NativeAdc::addPin(uint8_t pin) {
+    int8_t ch = channelOf(pin);
+    if (ch < 0) return false;
+    pinMode(pin, INPUT);
+    _scanMask |= (1 << ch);     // A running task picks the new pattern up between frames
+    return true;
+}
+
+bool NativeAdc::isScanned(uint8_t pin) const {
+    int8_t ch = channelOf(pin);
+    return ch >= 0 && (_validMask & (1 << ch));
+}
+
+bool NativeAdc::start() {
+    if (_task) return true;
+    if (!_scanMask) return false;
+    // Core 0, below the SPI bus task — it sleeps in the driver until a frame is complete
+    if (xTaskCreatePinnedToCore(dmaTask, "adc_dma", 3072, this, 4, &_task, 0) != pdPASS) {
+        _task = nullptr;
+        Log.error("ADC", "Cannot start ADC DMA task");
+        return false;
+    }
+    return true;
+}
+
+float NativeAdc::readAverage(uint8_t pin) {
+    int8_t ch = channelOf(pin);
+    if (ch < 0) return (float)analogRead(pin);      // ADC2: never scanned
+    if (!(_validMask & (1 << ch))) {
+        // A oneshot ADC1 read would disturb the running scan — no value until its first frame
+        return _task ? 0.0f : (float)analogRead(pin);
+    }
+    return _mean16[ch] * (1.0f / 16.0f);
+}
+
+// (Re)build the scan: the digital controller only takes a new pattern when stopped
+bool NativeAdc::configure(uint16_t mask) {
+    if (_activeMask) {
+        adc_digi_stop();
+        adc_digi_deinitialize();
+        _activeMask = 0;
+    }
+    _validMask &= mask;     // Kept pins keep their last mean until the new scan's first frame
+    if (!mask) return true;
+
+    adc_digi_init_config_t init = {};
+    init.max_store_buf_size = FRAME_BYTES * 4;
+    init.conv_num_each_intr = FRAME_BYTES;
+    init.adc1_chan_mask = mask;
+    init.adc2_chan_mask = 0;
+    if (adc_digi_initialize(&init) != ESP_OK) return false;
+
+    adc_digi_pattern_config_t pattern[ADC1_CHANNELS] = {};
+    uint8_t n = 0;
+    for (uint8_t ch = 0; ch < ADC1_CHANNELS; ch++) {
+        if (!(mask & (1 << ch))) continue;
+        pattern[n].atten = ADC_ATTEN_DB_11;     // 0-3.1V, as analogSetPinAttenuation(ADC_11db)
+        pattern[n].channel = ch;
+        pattern[n].unit = 0;                    // ADC1
+        pattern[n].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+        n++;
+    }
+
+    adc_digi_configuration_t cfg = {};
+    cfg.conv_limit_en = false;
+    cfg.conv_limit_num = 250;
+    cfg.pattern_num = n;
+    cfg.adc_pattern = pattern;
+    cfg.sample_freq_hz = SAMPLE_HZ;
+    cfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    cfg.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+    if (adc_digi_controller_configure(&cfg) != ESP_OK || adc_digi_start() != ESP_OK) {
+        adc_digi_deinitialize();
+        return false;
+    }
+    _activeMask = mask;
+    Log.info("ADC", "ADC1 DMA scan: %d channel%s, %lu Hz, ~%d samples per value",
+             n, n == 1 ? "" : "s", (unsigned long)(SAMPLE_HZ / n), FRAME_RESULTS / n);
+    return true;
+}
+
+// One DMA frame: sum each channel's conversions, publish the means
+void NativeAdc::decimate(const uint8_t* buf, uint32_t len) {
+    uint32_t sum[ADC1_CHANNELS] = {};
+    uint8_t count[ADC1_CHANNELS] = {};
+    for (uint32_t i = 0; i + 4 <= len; i += 4) {
+        const adc_digi_output_data_t* r = (const adc_digi_output_data_t*)&buf[i];
+        uint8_t ch = r->type2.channel;
+        if (r->type2.unit != 0 || ch >= ADC1_CHANNELS) continue;
+        sum[ch] += r->type2.data;
+        count[ch]++;
+    }
+
+    uint8_t fewest = 0xFF;
+    uint16_t valid = _validMask;
+    for (uint8_t ch = 0; ch < ADC1_CHANNELS; ch++) {
+        if (!count[ch]) continue;
+        _mean16[ch] = (uint16_t)((sum[ch] * 16 + count[ch] / 2) / count[ch]);
+        valid |= (1 << ch);
+        if (count[ch] < fewest) fewest = count[ch];
+    }
+    _validMask = valid;
+    _samplesPerValue = fewest == 0xFF ? 0 : fewest;
+    _frames++;
+}
+
+void NativeAdc::dmaTask(void* param) {
+    NativeAdc* self = (NativeAdc*)param;
+    static uint8_t frame[FRAME_BYTES];
+    while (true) {
+        uint16_t mask = self->_scanMask;
+        if (mask != self->_activeMask && !self->configure(mask)) {
+            Log.error("ADC", "ADC1 DMA scan setup failed (mask 0x%03X)", mask);
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            continue;
+        }
+        uint32_t len = 0;
+        // Bounded wait so a pin added meanwhile is picked up even if the scan stalls
+        esp_err_t err = adc_digi_read_bytes(frame, FRAME_BYTES, &len, 20);
+        if (err == ESP_ERR_INVALID_STATE) self->_overruns++;   // Ring overflowed; frame still good
+        else if (err != ESP_OK) continue;
+        self->decimate(frame, len);
+    }
+}
@@ -12,68 +12,98 @@ PinExpander& PinExpander::instance() {
 // ---- SPI register helpers ----
 
 void PinExpander::spiWriteReg(uint8_t index, uint8_t reg, uint8_t val) {
-    uint8_t opcode = 0x40 | (_hwAddr[index] << 1); // write: R/W=0
-    _spi->beginTransaction(SPISettings(MCP23S17_SPI_SPEED, MSBFIRST, SPI_MODE0));
-    digitalWrite(_csPin, LOW);
-    _spi->transfer(opcode);
-    _spi->transfer(reg);
-    _spi->transfer(val);
-    digitalWrite(_csPin, HIGH);
-    _spi->endTransaction();
+    uint8_t tx[3] = {(uint8_t)(0x40 | (_hwAddr[index] << 1)), reg, val}; // write: R/W=0
+    SpiBus::instance().write(_dev, tx, sizeof(tx));
 }
 
 uint8_t PinExpander::spiReadReg(uint8_t index, uint8_t reg) {
-    uint8_t opcode = 0x41 | (_hwAddr[index] << 1); // read: R/W=1
-    _spi->beginTransaction(SPISettings(MCP23S17_SPI_SPEED, MSBFIRST, SPI_MODE0));
-    digitalWrite(_csPin, LOW);
-    _spi->transfer(opcode);
-    _spi->transfer(reg);
-    uint8_t val = _spi->transfer(0x00);
-    digitalWrite(_csPin, HIGH);
-    _spi->endTransaction();
-    return val;
+    uint8_t tx[3] = {(uint8_t)(0x41 | (_hwAddr[index] << 1)), reg, 0x00}; // read: R/W=1
+    SpiFuture f;
+    if (!SpiBus::instance().transfer(_dev, tx, sizeof(tx), f)) return 0;
+    f.wait();
+    return f[2];
 }
 
 void PinExpander::spiWriteReg16(uint8_t index, uint8_t reg, uint16_t val) {
-    uint8_t opcode = 0x40 | (_hwAddr[index] << 1);
-    _spi->beginTransaction(SPISettings(MCP23S17_SPI_SPEED, MSBFIRST, SPI_MODE0));
-    digitalWrite(_csPin, LOW);
-    _spi->transfer(opcode);
-    _spi->transfer(reg);
-    _spi->transfer(val & 0xFF);        // low byte (port A)
-    _spi->transfer((val >> 8) & 0xFF); // high byte (port B)
-    digitalWrite(_csPin, HIGH);
-    _spi->endTransaction();
+    uint8_t tx[4] = {(uint8_t)(0x40 | (_hwAddr[index] << 1)), reg,
+                     (uint8_t)(val & 0xFF),         // low byte (port A)
+                     (uint8_t)((val >> 8) & 0xFF)}; // high byte (port B)
+    SpiBus::instance().write(_dev, tx, sizeof(tx));
 }
 
 uint16_t PinExpander::spiReadReg16(uint8_t index, uint8_t reg) {
-    uint8_t opcode = 0x41 | (_hwAddr[index] << 1);
-    _spi->beginTransaction(SPISettings(MCP23S17_SPI_SPEED, MSBFIRST, SPI_MODE0));
-    digitalWrite(_csPin, LOW);
-    _spi->transfer(opcode);
-    _spi->transfer(reg);
-    uint8_t lo = _spi->transfer(0x00);
-    uint8_t hi = _spi->transfer(0x00);
-    digitalWrite(_csPin, HIGH);
-    _spi->endTransaction();
-    return (uint16_t)hi << 8 | lo;
+    uint8_t tx[4] = {(uint8_t)(0x41 | (_hwAddr[index] << 1)), reg, 0x00, 0x00};
+    SpiFuture f;
+    if (!SpiBus::instance().transfer(_dev, tx, sizeof(tx), f)) return 0;
+    f.wait();
+    return (uint16_t)f[3] << 8 | f[2];
+}
+
+// ---- OLAT flush ----
+
+void PinExpander::queueFlush(uint8_t index, uint16_t setMask, uint16_t clearMask, SpiFuture* done) {
+    uint8_t bit = 1 << index;
+    portENTER_CRITICAL(&_shadowLock);
+    _shadow[index] = (_shadow[index] & ~clearMask) | setMask;
+    bool pending = (_flushPending & bit) != 0;
+    _flushPending |= bit;
+    portEXIT_CRITICAL(&_shadowLock);
+
+    // A queued flush will send this shadow too — unless the caller waits on this write
+    if (pending && !done) return;
+    SpiBus::Priority prio = (_urgent & bit) ? SpiBus::PRIO_URGENT : SpiBus::PRIO_NORMAL;
+    if (!SpiBus::instance().writeDeferred(_dev, fillOlat, (void*)(uintptr_t)index, prio, done) && !pending) {
+        // Not queued (queue full, bus not running): the shadow stays dirty and retryFlushes()
+        // queues it on the next tick — the write may have been the last one (an injector close)
+        portENTER_CRITICAL(&_shadowLock);
+        _flushPending &= ~bit;
+        _flushRetry |= bit;
+        portEXIT_CRITICAL(&_shadowLock);
+        _flushRetries++;
+    }
+}
+
+void PinExpander::retryFlushes() {
+    portENTER_CRITICAL(&_shadowLock);
+    uint8_t retry = _flushRetry;
+    portEXIT_CRITICAL(&_shadowLock);
+    for (uint8_t i = 0; i < SPI_EXP_MAX; i++) {
+        if (retry & (1 << i)) queueFlush(i, 0, 0);
+    }
+}
+
+// Bus task: the shadow as of now, not as of the write that queued the flush
+uint8_t PinExpander::fillOlat(void* arg, uint8_t* tx) {
+    PinExpander& self = instance();
+    uint8_t index = (uint8_t)(uintptr_t)arg;
+    portENTER_CRITICAL(&self._shadowLock);
+    uint16_t val = self._shadow[index];
+    self._flushPending &= ~(1 << index);
+    self._flushRetry &= ~(1 << index);     // This flush carries the refused one's writes
+    portEXIT_CRITICAL(&self._shadowLock);
+    self._sentOlat[index] = val;
+    tx[0] = 0x40 | (self._hwAddr[index] << 1);
+    tx[1] = MCP23S17_OLATA;
+    tx[2] = val & 0xFF;
+    tx[3] = (val >> 8) & 0xFF;
+    return 4;
 }
 
 // ---- Device initialization ----
 
-bool PinExpander::begin(uint8_t index, SPIClass* spi, uint8_t csPin, uint8_t hwAddr) {
-    if (index >= SPI_EXP_MAX || !spi) return false;
+bool PinExpander::begin(uint8_t index, uint8_t csPin, uint8_t hwAddr) {
+    if (index >= SPI_EXP_MAX) return false;
 
-    _spi = spi;
-    _csPin = csPin;
+    // One bus device for the shared CS (first call only — the CS line is driven by the SPI host)
+    if (_dev == SpiBus::INVALID_DEVICE) {
+        _dev = SpiBus::instance().addDevice(csPin, MCP23S17_SPI_SPEED, 0);
+        if (_dev == SpiBus::INVALID_DEVICE) return false;
+        _csPin = csPin;
+    }
     _hwAddr[index] = hwAddr;
     _shadow[index] = 0x0000;
     _dir[index] = 0xFFFF; // all inputs by default
 
-    // CS pin setup (idempotent — safe to call for each device on shared CS)
-    pinMode(csPin, OUTPUT);
-    digitalWrite(csPin, HIGH);
-
     // Configure IOCON: HAEN + MIRROR + ODR = 0x4C
     // HAEN(bit3): hardware address enable — required for shared CS
     // MIRROR(bit6): INTA covers both ports
@@ -94,6 +124,7 @@ bool PinExpander::begin(uint8_t index, SPIClass* spi, uint8_t csPin, uint8_t hwA
 
     // Clear output latches
     spiWriteReg16(index, MCP23S17_OLATA, 0x0000);
+    _sentOlat[index] = 0x0000;
 
     // INTCON = 0 for all pins (compare against previous value = pin change mode)
     spiWriteReg(index, MCP_INTCONA, 0x00);
@@ -117,11 +148,18 @@ bool PinExpander::begin(uint8_t index, SPIClass* spi, uint8_t csPin, uint8_t hwA
 // ---- Health check ----
 
 uint8_t PinExpander::healthCheck() {
+    // Queue every readback, then collect — the bus runs them back to back
+    SpiBus& bus = SpiBus::instance();
+    SpiFuture f[SPI_EXP_MAX];
+    for (uint8_t i = 0; i < SPI_EXP_MAX; i++) {
+        if (!_ready[i]) continue;
+        uint8_t tx[3] = {(uint8_t)(0x41 | (_hwAddr[i] << 1)), MCP23S17_IOCON, 0x00};
+        bus.transfer(_dev, tx, sizeof(tx), f[i]);
+    }
     uint8_t failed = 0;
     for (uint8_t i = 0; i < SPI_EXP_MAX; i++) {
         if (!_ready[i]) continue;
-        uint8_t iocon = spiReadReg(i, MCP23S17_IOCON);
-        if (iocon != MCP_IOCON_SHARED) failed |= (1 << i);
+        if (!f[i].wait() || f[i][2] != MCP_IOCON_SHARED) failed |= (1 << i);
     }
     return failed;
 }
@@ -145,13 +183,34 @@ void PinExpander::writePin(uint8_t pin, uint8_t val) {
     uint8_t idx = pin / SPI_EXP_PIN_COUNT;
     uint8_t localPin = pin % SPI_EXP_PIN_COUNT;
     if (idx >= SPI_EXP_MAX || !_ready[idx]) return;
+    uint16_t bit = 1 << localPin;
+    queueFlush(idx, val ? bit : 0, val ? 0 : bit);
+}
 
-    if (val) {
-        _shadow[idx] |= (1 << localPin);
-    } else {
-        _shadow[idx] &= ~(1 << localPin);
-    }
-    spiWriteReg16(idx, MCP23S17_OLATA, _shadow[idx]);
+void PinExpander::writePinSync(uint8_t pin, uint8_t val) {
+    uint8_t idx = pin / SPI_EXP_PIN_COUNT;
+    uint8_t localPin = pin % SPI_EXP_PIN_COUNT;
+    if (idx >= SPI_EXP_MAX || !_ready[idx]) return;
+    uint16_t bit = 1 << localPin;
+    SpiFuture done;
+    queueFlush(idx, val ? bit : 0, val ? 0 : bit, &done);
+    done.wait();
+}
+
+void PinExpander::writeMasked(uint8_t index, uint16_t setMask, uint16_t clearMask) {
+    if (index >= SPI_EXP_MAX || !_ready[index]) return;
+    queueFlush(index, setMask, clearMask);
+}
+
+void PinExpander::writeResolvedSync(uint8_t index, uint16_t mask, uint8_t val) {
+    SpiFuture done;
+    queueFlush(index, val ? mask : 0, val ? 0 : mask, &done);
+    done.wait();
+}
+
+void PinExpander::setUrgent(uint8_t pin) {
+    uint8_t idx = pin / SPI_EXP_PIN_COUNT;
+    if (idx < SPI_EXP_MAX) _urgent |= (1 << idx);
 }
 
 uint8_t PinExpander::readPin(uint8_t pin) {
@@ -159,20 +218,84 @@ uint8_t PinExpander::readPin(uint8_t pin) {
     uint8_t localPin = pin % SPI_EXP_PIN_COUNT;
     if (idx >= SPI_EXP_MAX || !_ready[idx]) return LOW;
 
-    uint16_t gpio = spiReadReg16(idx, MCP23S17_GPIOA);
+    uint16_t gpio = inputs(idx);
     return (gpio & (1 << localPin)) ? HIGH : LOW;
 }
 
 uint16_t PinExpander::readAll(uint8_t index) {
     if (index >= SPI_EXP_MAX || !_ready[index]) return 0x0000;
-    return spiReadReg16(index, MCP23S17_GPIOA);
+    return inputs(index);
+}
+
+// ---- Input snapshots ----
+
+uint16_t PinExpander::inputs(uint8_t index) {
+    uint8_t bit = 1 << index;
+    __atomic_fetch_or(&_snapUsed, bit, __ATOMIC_RELAXED);
+    uint32_t age = (uint32_t)esp_timer_get_time() - __atomic_load_n(&_snapUs[index], __ATOMIC_ACQUIRE);
+    if (!(__atomic_load_n(&_snapValid, __ATOMIC_ACQUIRE) & bit) || (_inputsDirty & bit) ||
+        age > SNAPSHOT_MAX_AGE_US) {
+        refresh(bit);
+    } else {
+        _snapHits++;
+    }
+    return (uint16_t)__atomic_load_n(&_snapshot[index], __ATOMIC_ACQUIRE);
+}
+
+void PinExpander::refreshInputs() {
+    uint8_t mask = __atomic_exchange_n(&_snapUsed, 0, __ATOMIC_RELAXED) |
+                   (_inputsDirty & __atomic_load_n(&_snapValid, __ATOMIC_ACQUIRE));
+    refresh(mask);
+}
+
+void PinExpander::refresh(uint8_t mask) {
+    // Queue every device first, then collect — one bus burst however many devices
+    SpiBus& bus = SpiBus::instance();
+    SpiFuture f[SPI_EXP_MAX];
+    for (uint8_t i = 0; i < SPI_EXP_MAX; i++) {
+        uint8_t bit = 1 << i;
+        if (!(mask & bit) || !_ready[i]) continue;
+        // Reading GPIO clears a pending interrupt — leave INTF/INTCAP to checkInterrupt()
+        if (_sharedIntFlag && _gpinten[i]) continue;
+        portENTER_CRITICAL(&_shadowLock);
+        _inputsDirty &= ~bit;   // An edge after this point dirties the new snapshot again
+        portEXIT_CRITICAL(&_shadowLock);
+        bus.writeDeferred(_dev, fillGpioRead, (void*)(uintptr_t)i, SpiBus::PRIO_NORMAL, &f[i]);
+    }
+    for (uint8_t i = 0; i < SPI_EXP_MAX; i++) {
+        if (!f[i].wait()) continue;
+        uint32_t snap = (uint32_t)_readOlat[i] << 16 | (uint16_t)f[i][3] << 8 | f[i][2];
+        __atomic_store_n(&_snapshot[i], snap, __ATOMIC_RELEASE);
+        __atomic_store_n(&_snapUs[i], (uint32_t)esp_timer_get_time(), __ATOMIC_RELEASE);
+        __atomic_fetch_or(&_snapValid, (uint8_t)(1 << i), __ATOMIC_RELEASE);
+        _snapReads++;
+    }
+}
+
+// Bus task: GPIOA|B read, paired with the OLAT that is driving the outputs right now
+uint8_t PinExpander::fillGpioRead(void* arg, uint8_t* tx) {
+    PinExpander& self = instance();
+    uint8_t index = (uint8_t)(uintptr_t)arg;
+    self._readOlat[index] = self._sentOlat[index];
+    tx[0] = 0x41 | (self._hwAddr[index] << 1);
+    tx[1] = MCP23S17_GPIOA;
+    tx[2] = 0x00;
+    tx[3] = 0x00;
+    return 4;
 }
 
 // ---- Shared open-drain interrupt ----
 
 void IRAM_ATTR PinExpander::intISR(void* arg) {
-    volatile bool* flag = (volatile bool*)arg;
-    *flag = true;
+    PinExpander* self = (PinExpander*)arg;
+    self->_sharedIntFlag = true;
+    // The line doesn't say which device — every snapshot is suspect until re-read
+    portENTER_CRITICAL_ISR(&self->_shadowLock);
+    self->_inputsDirty = (1 << SPI_EXP_MAX) - 1;
+    portEXIT_CRITICAL_ISR(&self->_shadowLock);
+    BaseType_t woken = pdFALSE;
+    if (self->_intTask) vTaskNotifyGiveFromISR(self->_intTask, &woken);
+    if (woken) portYIELD_FROM_ISR();
 }
 
 bool PinExpander::attachSharedInterrupt(uint8_t espGpioPin) {
@@ -181,10 +304,17 @@ bool PinExpander::attachSharedInterrupt(uint8_t espGpioPin) {
     _sharedIntGpio = espGpioPin;
     _sharedIntFlag = false;
 
+    // Core 0, above the 10ms update task and below the SPI bus task it waits on
+    if (!_intTask &&
+        xTaskCreatePinnedToCore(intServiceTask, "exp_int", 3072, this, 5, &_intTask, 0) != pdPASS) {
+        _intTask = nullptr;
+        Log.error("MCP-SPI", "Cannot start expander interrupt task");
+        return false;
+    }
+
     // Configure ESP32 GPIO: active-low open-drain with external pull-up
     pinMode(espGpioPin, INPUT_PULLUP);
-    ::attachInterruptArg(digitalPinToInterrupt(espGpioPin), intISR,
-                         (void*)&_sharedIntFlag, FALLING);
+    ::attachInterruptArg(digitalPinToInterrupt(espGpioPin), intISR, this, FALLING);
 
     Log.info("MCP-SPI", "Shared INT on GPIO %d (open-drain, active-low, %d devices)",
              espGpioPin, SPI_EXP_MAX);
@@ -216,24 +346,148 @@ void PinExpander::disablePinInterrupt(uint8_t globalPin) {
     spiWriteReg(idx, MCP_GPINTENB, (_gpinten[idx] >> 8) & 0xFF);
 }
 
+void PinExpander::queueIntBurst(uint8_t index, SpiFuture& f) {
+    // BANK=0, SEQOP=0: INTFA, INTFB, INTCAPA, INTCAPB are contiguous (0x0E-0x11) — one read
+    uint8_t tx[6] = {(uint8_t)(0x41 | (_hwAddr[index] << 1)), MCP_INTFA, 0x00, 0x00, 0x00, 0x00};
+    SpiBus::instance().transfer(_dev, tx, sizeof(tx), f);
+}
+
 bool PinExpander::checkInterrupt(uint8_t index, uint16_t& changedPins, uint16_t& capturedValues) {
     if (index >= SPI_EXP_MAX || !_ready[index]) return false;
 
-    // Read INTF — which pin(s) caused the interrupt
-    uint8_t intfA = spiReadReg(index, MCP_INTFA);
-    uint8_t intfB = spiReadReg(index, MCP_INTFB);
-    changedPins = (uint16_t)intfB << 8 | intfA;
-
+    // INTF — which pin(s) caused the interrupt; INTCAP — captured port values at time of
+    // interrupt (reading it also clears the interrupt)
+    SpiFuture f;
+    queueIntBurst(index, f);
+    if (!f.wait()) return false;
+    changedPins = (uint16_t)f[3] << 8 | f[2];
     if (changedPins == 0) return false;
+    capturedValues = (uint16_t)f[5] << 8 | f[4];
+    return true;
+}
+
+void PinExpander::serviceInterrupts() {
+    // Priority order: device 0 first, 5 last
+    SpiFuture f[SPI_EXP_MAX];
+    for (uint8_t i = 0; i < SPI_EXP_MAX; i++) {
+        if (_ready[i] && _gpinten[i]) queueIntBurst(i, f[i]);
+    }
+    for (uint8_t i = 0; i < SPI_EXP_MAX; i++) {
+        if (!f[i].wait()) continue;
+        uint16_t changed = (uint16_t)f[i][3] << 8 | f[i][2];
+        if (changed == 0) continue;
+        uint16_t captured = (uint16_t)f[i][5] << 8 | f[i][4];
+        if (_intHandler) _intHandler(_intArg, i, changed, captured);
+    }
+}
+
+void PinExpander::intServiceTask(void* param) {
+    PinExpander* self = (PinExpander*)param;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // The line is edge-triggered: a change captured while we read holds it low with no
+        // new falling edge, so go again until it releases
+        for (uint8_t pass = 0; pass < INT_SERVICE_PASSES; pass++) {
+            self->_sharedIntFlag = false;
+            self->serviceInterrupts();
+            self->_intServiced++;
+            if (digitalRead(self->_sharedIntGpio) == HIGH) break;
+        }
+    }
+}
+
+// ---- Coalesced writes ----
 
-    // Read INTCAP — captured port values at time of interrupt (also clears the interrupt)
-    uint8_t capA = spiReadReg(index, MCP_INTCAPA);
-    uint8_t capB = spiReadReg(index, MCP_INTCAPB);
-    capturedValues = (uint16_t)capB << 8 | capA;
+void PinBatch::stage(uint16_t pin, uint8_t val) {
+    if (pin < SPI_EXP_PIN_OFFSET) {
+        digitalWrite(pin, val);
+        return;
+    }
+    uint8_t local = pin - SPI_EXP_PIN_OFFSET;
+    uint8_t idx = local / SPI_EXP_PIN_COUNT;
+    if (idx >= SPI_EXP_MAX) return;
+    uint16_t bit = 1 << (local % SPI_EXP_PIN_COUNT);
+    // Last stage of a pin wins
+    if (val) {
+        _set[idx] |= bit;
+        _clear[idx] &= ~bit;
+    } else {
+        _clear[idx] |= bit;
+        _set[idx] &= ~bit;
+    }
+    _touched |= (1 << idx);
+}
 
+void PinBatch::stage(const PinHandle& pin, uint8_t val) {
+    if (!pin._exp) {
+        pin.write(val);
+        return;
+    }
+    uint8_t idx = pin._index;
+    if (val) {
+        _set[idx] |= pin._mask;
+        _clear[idx] &= ~pin._mask;
+    } else {
+        _clear[idx] |= pin._mask;
+        _set[idx] &= ~pin._mask;
+    }
+    _touched |= (1 << idx);
+}
+
+void PinBatch::commit() {
+    if (!_touched) return;
+    PinExpander& exp = PinExpander::instance();
+    for (uint8_t i = 0; i < SPI_EXP_MAX; i++) {
+        if (!(_touched & (1 << i))) continue;
+        exp.writeMasked(i, _set[i], _clear[i]);
+        _set[i] = 0;
+        _clear[i] = 0;
+    }
+    _touched = 0;
+}
+
+// ---- Resolved pin handles ----
+
+bool PinHandle::attach(uint16_t pin) {
+    _pin = pin;
+    _exp = nullptr;
+    _write = writeNone;
+    if (pin == 0) return false;
+    if (pin < SPI_EXP_PIN_OFFSET) {
+        _write = writeNative;
+        return true;
+    }
+    uint8_t local = pin - SPI_EXP_PIN_OFFSET;
+    uint8_t idx = local / SPI_EXP_PIN_COUNT;
+    PinExpander& exp = PinExpander::instance();
+    if (idx >= SPI_EXP_MAX || !exp.isReady(idx)) return false;
+    _exp = &exp;
+    _index = idx;
+    _mask = 1 << (local % SPI_EXP_PIN_COUNT);
+    _write = writeExpander;
     return true;
 }
 
+void PinHandle::writeNone(const PinHandle&, uint8_t) {}
+
+void PinHandle::writeNative(const PinHandle& h, uint8_t val) {
+    digitalWrite(h._pin, val);
+}
+
+void PinHandle::writeExpander(const PinHandle& h, uint8_t val) {
+    h._exp->writeResolved(h._index, h._mask, val);
+}
+
+void PinHandle::writeSync(uint8_t val) const {
+    if (_exp) _exp->writeResolvedSync(_index, _mask, val);
+    else write(val);
+}
+
+uint8_t PinHandle::read() const {
+    if (_exp) return _exp->readResolved(_index, _mask);
+    return (_write == writeNative) ? digitalRead(_pin) : LOW;
+}
+
 // ---- Global helpers — route by pin number ----
 
 void xDigitalWrite(uint16_t pin, uint8_t val) {
@@ -244,6 +498,14 @@ void xDigitalWrite(uint16_t pin, uint8_t val) {
     }
 }
 
+void xDigitalWriteSync(uint16_t pin, uint8_t val) {
+    if (pin >= SPI_EXP_PIN_OFFSET) {
+        PinExpander::instance().writePinSync(pin - SPI_EXP_PIN_OFFSET, val);
+    } else {
+        digitalWrite(pin, val);
+    }
+}
+
 uint8_t xDigitalRead(uint16_t pin) {
     if (pin >= SPI_EXP_PIN_OFFSET) {
         return PinExpander::instance().readPin(pin - SPI_EXP_PIN_OFFSET);
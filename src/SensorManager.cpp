@@ -6,6 +6,7 @@
 #include "InjectionManager.h"
 #include "AlternatorControl.h"
 #include "PinExpander.h"
+#include "NativeAdc.h"
 #include "ECU.h"  // for EngineState
 #include <esp_adc_cal.h>
 #include "Logger.h"
@@ -258,7 +259,8 @@ void SensorManager::begin() {
             // Skip MAP/TPS GPIO setup if external ADC handles them
             if (extMapTps && (i == SLOT_MAP || i == SLOT_TPS)) continue;
             pinMode(d.sourcePin, INPUT);
-            analogSetPinAttenuation(d.sourcePin, ADC_11db);
+            analogSetPinAttenuation(d.sourcePin, ADC_11db);     // analogRead fallback (ADC2 pins)
+            NativeAdc::instance().addPin(d.sourcePin);
         } else if (d.sourceType == SRC_GPIO_DIGITAL && d.sourcePin > 0 && d.sourcePin <= 48) {
             pinMode(d.sourcePin, INPUT_PULLUP);
         }
@@ -328,8 +330,10 @@ float SensorManager::readSource(SensorDescriptor& d) {
     switch (d.sourceType) {
         case SRC_GPIO_ADC: {
             if (d.sourcePin == 0) return 0.0f;
-            d.rawAdc = analogRead(d.sourcePin);
-            return (float)d.rawAdc * ADC_REF_VOLTAGE / (float)ADC_MAX_VALUE;
+            // DMA scan mean (ADC1), analogRead otherwise
+            float raw = NativeAdc::instance().readAverage(d.sourcePin);
+            d.rawAdc = (uint16_t)(raw + 0.5f);
+            return raw * ADC_REF_VOLTAGE / (float)ADC_MAX_VALUE;
         }
         case SRC_GPIO_DIGITAL: {
             if (d.sourcePin == 0) return 0.0f;
@@ -346,7 +350,7 @@ float SensorManager::readSource(SensorDescriptor& d) {
             }
             // Fallback to GPIO ADC
             if (d.sourcePin > 0) {
-                d.rawAdc = analogRead(d.sourcePin);
+                d.rawAdc = NativeAdc::instance().read(d.sourcePin);
                 return (float)d.rawAdc * ADC_REF_VOLTAGE / (float)ADC_MAX_VALUE;
             }
             return 0.0f;
@@ -695,6 +699,7 @@ void SensorManager::configureOilPressure(uint8_t mode, uint8_t pin, bool activeL
         d.sourceDevice = 0;
         d.sourceChannel = mcpChannel;
         d.sourcePin = pin;  // GPIO fallback
+        if (!_mapTpsMcp && pin > 0 && pin <= 48) NativeAdc::instance().addPin(pin);
         d.calType = CAL_LINEAR;
         d.calA = 0.5f;    // 0.5V = 0 PSI
         d.calB = 4.5f;    // 4.5V = maxPsi
@@ -719,7 +724,7 @@ float SensorManager::readCoilHealth() {
     PinExpander& exp = PinExpander::instance();
     if (!exp.isReady(4)) return 0.0f;  // MCP23S17 #4 = coils
     uint16_t actual = exp.readAll(4);
-    uint16_t shadow = exp.getShadow(4);
+    uint16_t shadow = exp.getSnapshotOlat(4);  // Latch driving the pins when actual was sampled
     uint16_t dir = exp.getDir(4);
     // Only check output pins (dir bit = 0 means output)
     uint16_t outputMask = ~dir;
@@ -733,7 +738,7 @@ float SensorManager::readInjectorHealth() {
     PinExpander& exp = PinExpander::instance();
     if (!exp.isReady(5)) return 0.0f;  // MCP23S17 #5 = injectors
     uint16_t actual = exp.readAll(5);
-    uint16_t shadow = exp.getShadow(5);
+    uint16_t shadow = exp.getSnapshotOlat(5);  // Latch driving the pins when actual was sampled
     uint16_t dir = exp.getDir(5);
     uint16_t outputMask = ~dir;
     uint16_t mismatch = (actual ^ shadow) & outputMask;
@@ -0,0 +1,241 @@
+#include "SpiBus.h"
+#include "Logger.h"
+
+static const spi_host_device_t BUS_HOST = SPI3_HOST;   // Arduino HSPI on ESP32-S3
+
+SpiBus& SpiBus::instance() {
+    static SpiBus inst;
+    return inst;
+}
+
+bool SpiBus::begin(uint8_t sckPin, uint8_t misoPin, uint8_t mosiPin) {
+    if (_task) return true;
+
+    spi_bus_config_t bus = {};
+    bus.mosi_io_num = mosiPin;
+    bus.miso_io_num = misoPin;
+    bus.sclk_io_num = sckPin;
+    bus.quadwp_io_num = -1;
+    bus.quadhd_io_num = -1;
+    bus.max_transfer_sz = MAX_LEN;
+    esp_err_t err = spi_bus_initialize(BUS_HOST, &bus, SPI_DMA_CH_AUTO);
+    if (err != ESP_OK) {
+        Log.error("SPI", "HSPI bus init failed: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    _urgentQueue = xQueueCreate(URGENT_QUEUE_LEN, sizeof(Request));
+    _normalQueue = xQueueCreate(NORMAL_QUEUE_LEN, sizeof(Request));
+    _pending = xSemaphoreCreateCounting(URGENT_QUEUE_LEN + NORMAL_QUEUE_LEN, 0);
+    if (!_urgentQueue || !_normalQueue || !_pending) {
+        Log.error("SPI", "No memory for SPI bus queues");
+        return false;
+    }
+
+    // Core 0, above the 10ms update task — it sleeps on the queues or on DMA, never spins
+    if (xTaskCreatePinnedToCore(busTask, "spi_bus", 3072, this, 20, &_task, 0) != pdPASS) {
+        _task = nullptr;
+        Log.error("SPI", "Cannot start SPI bus task");
+        return false;
+    }
+    Log.info("SPI", "HSPI bus manager ready (SCK=%d, MISO=%d, MOSI=%d, DMA, %d+%d queue)",
+             sckPin, misoPin, mosiPin, URGENT_QUEUE_LEN, NORMAL_QUEUE_LEN);
+    return true;
+}
+
+uint8_t SpiBus::addDevice(uint8_t csPin, uint32_t clockHz, uint8_t mode) {
+    if (!_task || _deviceCount >= MAX_DEVICES) return INVALID_DEVICE;
+
+    spi_device_interface_config_t cfg = {};
+    cfg.mode = mode;
+    cfg.clock_speed_hz = clockHz;
+    cfg.spics_io_num = csPin;
+    cfg.queue_size = BURST_CHUNK;   // A burst chunk; otherwise one in flight — the bus task decides priority
+    spi_device_handle_t handle;
+    esp_err_t err = spi_bus_add_device(BUS_HOST, &cfg, &handle);
+    if (err != ESP_OK) {
+        Log.error("SPI", "Cannot add SPI device on CS=%d: %s", csPin, esp_err_to_name(err));
+        return INVALID_DEVICE;
+    }
+    _dev[_deviceCount] = handle;
+    return _deviceCount++;
+}
+
+// ---- Queueing ----
+
+bool SpiBus::enqueue(Request& r) {
+    if (!_task || r.dev >= _deviceCount) {
+        _dropped++;
+        return false;
+    }
+    r.queuedUs = esp_timer_get_time();
+    if (r.future) {
+        r.future->_done = false;
+        r.future->_queued = true;
+    }
+    QueueHandle_t q = (r.prio == PRIO_URGENT) ? _urgentQueue : _normalQueue;
+    if (xQueueSend(q, &r, 0) != pdTRUE) {
+        if (r.future) r.future->_queued = false;
+        _dropped++;
+        return false;
+    }
+    xSemaphoreGive(_pending);
+    return true;
+}
+
+bool SpiBus::write(uint8_t dev, const uint8_t* tx, uint8_t len, Priority prio) {
+    if (len == 0 || len > MAX_LEN) return false;
+    Request r = {};
+    r.dev = dev;
+    r.len = len;
+    r.prio = prio;
+    memcpy(r.tx, tx, len);
+    return enqueue(r);
+}
+
+bool SpiBus::writeDeferred(uint8_t dev, FillFn fill, void* arg, Priority prio, SpiFuture* done) {
+    if (!fill) return false;
+    Request r = {};
+    r.dev = dev;
+    r.prio = prio;
+    r.fill = fill;
+    r.fillArg = arg;
+    r.future = done;
+    return enqueue(r);
+}
+
+bool SpiBus::transfer(uint8_t dev, const uint8_t* tx, uint8_t len, SpiFuture& result, Priority prio) {
+    if (len == 0 || len > MAX_LEN) return false;
+    Request r = {};
+    r.dev = dev;
+    r.len = len;
+    r.prio = prio;
+    memcpy(r.tx, tx, len);
+    r.future = &result;
+    return enqueue(r);
+}
+
+bool SpiBus::burst(uint8_t dev, uint8_t steps, StepFn step, CollectFn collect, void* arg,
+                   SpiFuture& done, Priority prio) {
+    if (!step || !collect || steps == 0) return false;
+    Request r = {};
+    r.dev = dev;
+    r.len = steps;
+    r.prio = prio;
+    r.step = step;
+    r.collect = collect;
+    r.fillArg = arg;
+    r.future = &done;
+    return enqueue(r);
+}
+
+// ---- Bus task ----
+
+void SpiBus::serve(Request& r) {
+    if (r.step) {
+        serveBurst(r);
+        return;
+    }
+    if (r.fill) r.len = r.fill(r.fillArg, r.tx);
+    if (r.prio == PRIO_URGENT) {
+        uint32_t waitUs = (uint32_t)(esp_timer_get_time() - r.queuedUs);
+        if (waitUs > _urgentWaitMaxUs) _urgentWaitMaxUs = waitUs;
+    }
+
+    SpiFuture* f = r.future;
+    if (r.len > 0 && r.len <= MAX_LEN) {
+        spi_transaction_t t = {};
+        t.length = r.len * 8;
+        bool inlineData = (r.len <= 4);
+        if (inlineData) {
+            t.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
+            memcpy(t.tx_data, r.tx, r.len);
+        } else {
+            memcpy(_dmaTx, r.tx, r.len);
+            t.tx_buffer = _dmaTx;
+            t.rx_buffer = _dmaRx;
+        }
+        spi_transaction_t* done = nullptr;
+        if (spi_device_queue_trans(_dev[r.dev], &t, portMAX_DELAY) == ESP_OK &&
+            spi_device_get_trans_result(_dev[r.dev], &done, portMAX_DELAY) == ESP_OK) {
+            if (f) memcpy(f->_rx, inlineData ? t.rx_data : _dmaRx, r.len);
+            _transactions++;
+        }
+    }
+    if (f) {
+        f->_done = true;
+        xSemaphoreGive(f->_sem);
+    }
+}
+
+void SpiBus::serveBurst(Request& r) {
+    spi_device_handle_t dev = _dev[r.dev];
+    uint8_t i = 0;
+    while (i < r.len) {
+        serveUrgent();
+        // Queue a chunk of steps: the driver runs them back to back from its interrupt while
+        // this task sleeps on the results
+        uint8_t queued = 0;
+        for (; i < r.len && queued < BURST_CHUNK; i++) {
+            spi_transaction_t& t = _burstTrans[queued];
+            t = {};
+            t.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
+            uint8_t n = r.step(r.fillArg, i, t.tx_data);
+            if (n == 0 || n > 4) continue;
+            t.length = n * 8;
+            t.user = (void*)(uintptr_t)i;
+            if (spi_device_queue_trans(dev, &t, portMAX_DELAY) == ESP_OK) queued++;
+        }
+        // Results come back in queue order; a step whose transmit failed is never collected
+        for (uint8_t k = 0; k < queued; k++) {
+            spi_transaction_t* done = nullptr;
+            if (spi_device_get_trans_result(dev, &done, portMAX_DELAY) != ESP_OK) continue;
+            r.collect(r.fillArg, (uint8_t)(uintptr_t)done->user, done->rx_data);
+            _transactions++;
+        }
+    }
+    SpiFuture* f = r.future;
+    f->_done = true;
+    xSemaphoreGive(f->_sem);
+}
+
+// Output edges queued during a burst go out between its steps
+void SpiBus::serveUrgent() {
+    Request u;
+    while (xQueueReceive(_urgentQueue, &u, 0) == pdTRUE) {
+        xSemaphoreTake(_pending, 0);    // Its count — the main loop won't look for it
+        serve(u);
+    }
+}
+
+void SpiBus::busTask(void* param) {
+    SpiBus* self = (SpiBus*)param;
+    Request r;
+    while (true) {
+        xSemaphoreTake(self->_pending, portMAX_DELAY);
+        // Urgent first: an output edge never waits behind a queue of ADC reads
+        if (xQueueReceive(self->_urgentQueue, &r, 0) == pdTRUE ||
+            xQueueReceive(self->_normalQueue, &r, 0) == pdTRUE) {
+            self->serve(r);
+        }
+    }
+}
+
+// ---- SpiFuture ----
+
+SpiFuture::SpiFuture() : _queued(false), _done(false) {
+    memset(_rx, 0, sizeof(_rx));
+    _sem = xSemaphoreCreateBinaryStatic(&_semBuf);
+}
+
+SpiFuture::~SpiFuture() {
+    wait();
+    vSemaphoreDelete(_sem);
+}
+
+bool SpiFuture::wait() {
+    if (!_queued) return false;
+    xSemaphoreTake(_sem, portMAX_DELAY);    // Given exactly once per completed transaction
+    _queued = false;
+    return true;
+}
@@ -49,15 +49,19 @@ void TransmissionManager::begin(uint16_t ssAPin, uint16_t ssBPin, uint16_t ssCPi
 
     // Shift solenoids — MCP23S17 outputs
     xPinMode(_ssAPin, OUTPUT);
-    xDigitalWrite(_ssAPin, LOW);
     xPinMode(_ssBPin, OUTPUT);
-    xDigitalWrite(_ssBPin, LOW);
+    _ssA.attach(_ssAPin);
+    _ssB.attach(_ssBPin);
+    _ssA.write(LOW);
+    _ssB.write(LOW);
 
     if (_type == TransType::FORD_4R100) {
         xPinMode(_ssCPin, OUTPUT);
-        xDigitalWrite(_ssCPin, LOW);
         xPinMode(_ssDPin, OUTPUT);
-        xDigitalWrite(_ssDPin, LOW);
+        _ssC.attach(_ssCPin);
+        _ssD.attach(_ssDPin);
+        _ssC.write(LOW);
+        _ssD.write(LOW);
     }
 
     // TCC PWM — 200Hz, 8-bit (skip if pin is 0xFF / disabled)
@@ -130,12 +134,14 @@ void TransmissionManager::update(uint16_t engineRpm, float tps, float vbat) {
         _state.tccDuty = 0;
         _state.epcDuty = 0;
         _state.tccLocked = false;
-        setSolenoid(_ssAPin, false);
-        setSolenoid(_ssBPin, false);
+        PinBatch batch;
+        setSolenoid(batch, _ssA, false);
+        setSolenoid(batch, _ssB, false);
         if (_type == TransType::FORD_4R100) {
-            setSolenoid(_ssCPin, false);
-            setSolenoid(_ssDPin, false);
+            setSolenoid(batch, _ssC, false);
+            setSolenoid(batch, _ssD, false);
         }
+        batch.commit();
         if (_tccEnabled) ledcWrite(TCC_LEDC_CH, 0);
         if (_epcEnabled) ledcWrite(EPC_LEDC_CH, 0);
         _state.ssA = _state.ssB = _state.ssC = _state.ssD = false;
@@ -307,17 +313,20 @@ void TransmissionManager::applyShiftSolenoids() {
         }
     }
 
-    setSolenoid(_ssAPin, a);
-    setSolenoid(_ssBPin, b);
+    // One OLAT write for the whole gear pattern — the solenoids switch together
+    PinBatch batch;
+    setSolenoid(batch, _ssA, a);
+    setSolenoid(batch, _ssB, b);
     _state.ssA = a;
     _state.ssB = b;
 
     if (_type == TransType::FORD_4R100) {
-        setSolenoid(_ssCPin, c);
-        setSolenoid(_ssDPin, d);
+        setSolenoid(batch, _ssC, c);
+        setSolenoid(batch, _ssD, d);
         _state.ssC = c;
         _state.ssD = d;
     }
+    batch.commit();
 }
 
 void TransmissionManager::updateTCC(uint16_t engineRpm) {
@@ -375,8 +384,8 @@ void TransmissionManager::updateEPC(float tps) {
     }
 }
 
-void TransmissionManager::setSolenoid(uint16_t pin, bool on) {
-    xDigitalWrite(pin, on ? HIGH : LOW);
+void TransmissionManager::setSolenoid(PinBatch& batch, const PinHandle& pin, bool on) {
+    batch.stage(pin, on ? HIGH : LOW);
 }
 
 float TransmissionManager::tftAdcToTempF(float millivolts) {
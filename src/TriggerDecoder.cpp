@@ -0,0 +1,21 @@
+#include "TriggerDecoder.h"
+
+TriggerDecoder* TriggerDecoder::create(uint8_t type, uint8_t teeth, uint8_t missing) {
+    switch (type) {
+        case TRIG_4_PLUS_1:
+            return new PlusOneDecoder<4>("4+1");
+        case TRIG_GM_24X:
+            return new CamSyncDecoder<24>("GM 24x");
+        case TRIG_FORD_EDIS:
+            // Missing tooth at 90 deg BTDC -> first tooth after the gap is 80 deg BTDC
+            return new MissingToothDecoder<36, 1>("Ford EDIS", 80.0f);
+        default:
+            break;
+    }
+
+    if (teeth == 36 && missing == 1) return new MissingToothDecoder<36, 1>("36-1");
+    if (teeth == 60 && missing == 2) return new MissingToothDecoder<60, 2>("60-2");
+    if (teeth == 24 && missing == 1) return new MissingToothDecoder<24, 1>("24-1");
+    if (teeth == 12 && missing == 1) return new MissingToothDecoder<12, 1>("12-1");
+    return new GenericMissingToothDecoder(teeth, missing);
+}
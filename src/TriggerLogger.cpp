@@ -0,0 +1,112 @@
+#include "TriggerLogger.h"
+#include <ESPAsyncWebServer.h>
+#include "Logger.h"
+
+TriggerLogger TrigLog;
+
+TriggerLogger::TriggerLogger()
+    : _active(false), _closePending(false), _isrDropped(0), _taskDropped(0),
+      _sinkDropped(0), _records(0),
+      _ws(nullptr), _drainTask(nullptr), _frame(nullptr) {
+    _sdFile[0] = '\0';
+}
+
+void TriggerLogger::begin() {
+    if (_drainTask) return;
+    _frame = (uint8_t*)malloc(sizeof(FrameHeader) + FRAME_RECORDS * sizeof(Record));
+    if (!_frame) {
+        Log.error("TRIG", "No memory for trigger log frame buffer");
+        return;
+    }
+    // Core 0, just above idle — never competes with the 10ms update task or Core 1 timing
+    xTaskCreatePinnedToCore(drainTask, "trig_log", 4096, this, 1, &_drainTask, 0);
+    Log.info("TRIG", "Trigger logger ready (%d + %d record rings)", ISR_RING_SIZE, TASK_RING_SIZE);
+}
+
+bool TriggerLogger::start(const char* sdFile) {
+    if (_active || _closePending || !_frame) return false;
+
+    // Producers are gated by _active and the drain task is idle, so the consumer side can be reset here
+    _isrRing.clear();
+    _taskRing.clear();
+    _isrDropped = 0;
+    _taskDropped = 0;
+    _sinkDropped = 0;
+    _records = 0;
+    _sdFile[0] = '\0';
+    if (sdFile && sdFile[0]) {
+        _file = SD.open(sdFile, FILE_WRITE);
+        if (!_file) {
+            Log.warn("TRIG", "Cannot open %s — streaming to WebSocket only", sdFile);
+        } else {
+            strlcpy(_sdFile, sdFile, sizeof(_sdFile));
+        }
+    }
+    _active = true;
+    Log.info("TRIG", "Trigger log started%s%s", _sdFile[0] ? " -> " : "", _sdFile);
+    return true;
+}
+
+void TriggerLogger::stop() {
+    if (!_active) return;
+    _active = false;
+    _closePending = true;
+    Log.info("TRIG", "Trigger log stopped: %lu records, %lu dropped",
+             (unsigned long)_records, (unsigned long)getDroppedCount());
+}
+
+void TriggerLogger::drainTask(void* param) {
+    TriggerLogger* self = (TriggerLogger*)param;
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(DRAIN_INTERVAL_MS));
+        if (self->_active || self->_closePending) self->drain();
+        if (self->_closePending) {
+            if (self->_file) self->_file.close();
+            self->_closePending = false;
+        }
+    }
+}
+
+void TriggerLogger::drain() {
+    Record* out = (Record*)(_frame + sizeof(FrameHeader));
+    uint16_t n = 0;
+    Record a, b;
+    bool hasA = _isrRing.peek(a);
+    bool hasB = _taskRing.peek(b);
+
+    // Merge oldest-first; the signed difference survives the 32-bit timestamp wrap.
+    // Ordering is exact within a drain — records pushed after the peek land in the next frame.
+    while (hasA || hasB) {
+        if (hasA && (!hasB || (int32_t)(a.timeUs - b.timeUs) <= 0)) {
+            out[n++] = a;
+            _isrRing.drop();
+            hasA = _isrRing.peek(a);
+        } else {
+            out[n++] = b;
+            _taskRing.drop();
+            hasB = _taskRing.peek(b);
+        }
+        if (n == FRAME_RECORDS) {
+            flush(n);
+            n = 0;
+        }
+    }
+    if (n > 0) flush(n);
+    if (_file) _file.flush();
+}
+
+void TriggerLogger::flush(uint16_t count) {
+    FrameHeader* hdr = (FrameHeader*)_frame;
+    hdr->magic = 'T';
+    hdr->version = FRAME_VERSION;
+    hdr->count = count;
+    hdr->dropped = getDroppedCount();
+    size_t len = sizeof(FrameHeader) + count * sizeof(Record);
+    _records += count;
+
+    if (_file) _file.write(_frame, len);
+    if (_ws && _ws->count() > 0) {
+        if (_ws->availableForWriteAll()) _ws->binaryAll(_frame, len);
+        else _sinkDropped += count;  // Client too slow — count it rather than queue without bound
+    }
+}
@@ -3,6 +3,7 @@
 #include "ArduinoJson.h"
 #include "ECU.h"
 #include "CrankSensor.h"
+#include "CamSensor.h"
 #include "AlternatorControl.h"
 #include "IgnitionManager.h"
 #include "InjectionManager.h"
@@ -13,8 +14,13 @@
 #include "TuneTable.h"
 #include "PinExpander.h"
 #include "ADS1115Reader.h"
+#include "I2cBus.h"
 #include "MCP3204Reader.h"
+#include "NativeAdc.h"
 #include "CustomPin.h"
+#include "EventScheduler.h"
+#include "MapSampler.h"
+#include "TriggerLogger.h"
 #include "OtaUtils.h"
 #include <Preferences.h>
 
@@ -27,7 +33,7 @@ extern uint32_t _bootCountExposed;
 extern const char* _resetReasonStr;
 
 WebHandler::WebHandler(uint16_t port, Scheduler* ts)
-    : _server(port), _ws("/ws"), _ts(ts), _ecu(nullptr),
+    : _server(port), _ws("/ws"), _wsTrigger("/ws/trigger"), _ts(ts), _ecu(nullptr),
       _config(nullptr), _shouldReboot(false), _tDelayedReboot(nullptr),
       _ntpSynced(false), _tNtpSync(nullptr) {}
 
@@ -78,6 +84,8 @@ void WebHandler::begin() {
     _server.addHandler(&_ws);
     Log.setWebSocket(&_ws);
     Log.enableWebSocket(true);
+    _server.addHandler(&_wsTrigger);
+    TrigLog.setWebSocket(&_wsTrigger);
 
     setupRoutes();
     _server.begin();
@@ -382,6 +390,37 @@ void WebHandler::setupRoutes() {
             doc["oilPressurePsi"] = es.oilPressurePsi;
             doc["oilPressureLow"] = es.oilPressureLow;
             doc["expanderFaults"] = es.expanderFaults;
+            SpiBus& spiBus = SpiBus::instance();
+            if (spiBus.isRunning()) {
+                doc["spiTxns"] = spiBus.getTransactionCount();
+                doc["spiDropped"] = spiBus.getDroppedCount();
+                doc["spiUrgentWaitMaxUs"] = spiBus.getUrgentWaitMaxUs();
+                doc["expSnapHits"] = PinExpander::instance().getSnapshotHits();
+                doc["expSnapReads"] = PinExpander::instance().getSnapshotReads();
+                doc["expFlushRetries"] = PinExpander::instance().getFlushRetryCount();
+                if (MCP3204Reader* mcp = _ecu->getMCP3204()) {
+                    doc["mcpBursts"] = mcp->getBurstCount();
+                    doc["mcpSnapHits"] = mcp->getSnapshotHits();
+                }
+            }
+            MapSampler* mapSampler = _ecu->getMapSampler();
+            if (mapSampler && mapSampler->isEnabled()) {
+                doc["mapSync"] = mapSampler->hasLoad(esp_timer_get_time());
+                doc["mapWindows"] = mapSampler->getWindowCount();
+                doc["mapWindowSamples"] = mapSampler->getLastWindowSamples();
+                doc["mapSamplesRefused"] = mapSampler->getRefusedCount();
+            }
+            NativeAdc& adc = NativeAdc::instance();
+            if (adc.isRunning()) {
+                doc["adcFrames"] = adc.getFrameCount();
+                doc["adcOverruns"] = adc.getOverrunCount();
+                doc["adcSamples"] = adc.getSamplesPerValue();
+            }
+            I2cBus& i2cBus = I2cBus::instance();
+            if (i2cBus.isRunning()) {
+                doc["i2cPollMaxUs"] = i2cBus.getPollMaxUs();
+                doc["i2cRecoveries"] = i2cBus.getRecoveryCount();
+            }
 
             // Sensor descriptors array
             SensorManager* sm = _ecu->getSensorManager();
@@ -413,9 +452,16 @@ void WebHandler::setupRoutes() {
                 doc["revLimiting"] = ign->isRevLimiting();
                 doc["dwellMs"] = ign->getDwellMs();
                 doc["overdwellCount"] = ign->getOverdwellCount();
+                doc["sparkPinUs"] = ign->getSparkLatencyUs();
+                doc["sparkPinMaxUs"] = ign->getSparkMaxLatencyUs();
             }
             if (InjectionManager* inj = _ecu->getInjectionManager()) {
                 doc["fuelCut"] = inj->isFuelCut();
+                doc["injPinUs"] = inj->getOpenLatencyUs();
+                doc["injPinMaxUs"] = inj->getOpenMaxLatencyUs();
+                doc["injPwErrUs"] = inj->getPulseErrorUs();
+                doc["injPwErrMaxUs"] = inj->getPulseMaxErrorUs();
+                doc["injLateCloses"] = inj->getLateCloseCount();
             }
             if (AlternatorControl* alt = _ecu->getAlternator()) {
                 doc["altDuty"] = alt->getDuty();
@@ -435,6 +481,22 @@ void WebHandler::setupRoutes() {
         if (_ecu) {
             doc["updateUs"] = _ecu->getUpdateTimeUs();
             doc["sensorUs"] = _ecu->getSensorTimeUs();
+            doc["rtCycles"] = _ecu->getRtCycles();
+            doc["rtMaxCycles"] = _ecu->getRtMaxCycles();
+            if (EventScheduler* sched = _ecu->getScheduler()) {
+                doc["schedEvents"] = sched->getFiredCount();
+                doc["schedLatencyUs"] = sched->getLastLatencyUs();
+                doc["schedMaxLatencyUs"] = sched->getMaxLatencyUs();
+            }
+            if (CrankSensor* crank = _ecu->getCrankSensor()) {
+                doc["crankStalls"] = crank->getStallCount();
+                doc["crankNoise"] = crank->getRejectedEdgeCount();
+            }
+            if (CamSensor* cam = _ecu->getCamSensor()) {
+                doc["camSync"] = cam->isSynced();
+                doc["camSyncLosses"] = cam->getDecoder()->getSyncLossCount();
+                doc["vvtDeg"] = cam->getVvtAngleDeg();
+            }
         }
         doc["wifiSSID"] = WiFi.SSID();
         doc["wifiRSSI"] = WiFi.RSSI();
@@ -617,6 +679,10 @@ void WebHandler::setupRoutes() {
             for (uint8_t i = 0; i < proj->cylinders; i++) fo.add(proj->firingOrder[i]);
             doc["crankTeeth"] = proj->crankTeeth;
             doc["crankMissing"] = proj->crankMissing;
+            doc["triggerType"] = proj->triggerType;
+            doc["camType"] = proj->camType;
+            doc["camOffsetDeg"] = proj->camOffsetDeg;
+            doc["triggerBlankPct"] = proj->triggerBlankPct;
             doc["hasCamSensor"] = proj->hasCamSensor;
             doc["displacement"] = proj->displacement;
             doc["injectorFlowCcMin"] = proj->injectorFlowCcMin;
@@ -631,6 +697,10 @@ void WebHandler::setupRoutes() {
             doc["mapVoltageMax"] = proj->mapVoltageMax;
             doc["mapPressureMinKpa"] = proj->mapPressureMinKpa;
             doc["mapPressureMaxKpa"] = proj->mapPressureMaxKpa;
+            doc["mcp3204Oversample"] = proj->mcp3204Oversample;
+            doc["mapSyncSamples"] = proj->mapSyncSamples;
+            doc["mapSyncStartDeg"] = proj->mapSyncStartDeg;
+            doc["mapSyncWindowDeg"] = proj->mapSyncWindowDeg;
             doc["o2AfrAt0v"] = proj->o2AfrAt0v;
             doc["o2AfrAt5v"] = proj->o2AfrAt5v;
             doc["closedLoopMinRpm"] = proj->closedLoopMinRpm;
@@ -961,6 +1031,10 @@ void WebHandler::setupRoutes() {
         proj->cylinders = data["cylinders"] | proj->cylinders;
         proj->crankTeeth = data["crankTeeth"] | proj->crankTeeth;
         proj->crankMissing = data["crankMissing"] | proj->crankMissing;
+        proj->triggerType = data["triggerType"] | proj->triggerType;
+        proj->camType = data["camType"] | proj->camType;
+        proj->camOffsetDeg = data["camOffsetDeg"] | proj->camOffsetDeg;
+        proj->triggerBlankPct = data["triggerBlankPct"] | proj->triggerBlankPct;
         proj->hasCamSensor = data["hasCamSensor"] | proj->hasCamSensor;
         proj->displacement = data["displacement"] | proj->displacement;
         proj->injectorFlowCcMin = data["injectorFlowCcMin"] | proj->injectorFlowCcMin;
@@ -975,6 +1049,10 @@ void WebHandler::setupRoutes() {
         proj->mapVoltageMax = data["mapVoltageMax"] | proj->mapVoltageMax;
         proj->mapPressureMinKpa = data["mapPressureMinKpa"] | proj->mapPressureMinKpa;
         proj->mapPressureMaxKpa = data["mapPressureMaxKpa"] | proj->mapPressureMaxKpa;
+        proj->mcp3204Oversample = constrain((int)(data["mcp3204Oversample"] | proj->mcp3204Oversample), 1, 16);
+        proj->mapSyncSamples = constrain((int)(data["mapSyncSamples"] | proj->mapSyncSamples), 0, 8);
+        proj->mapSyncStartDeg = data["mapSyncStartDeg"] | proj->mapSyncStartDeg;
+        proj->mapSyncWindowDeg = data["mapSyncWindowDeg"] | proj->mapSyncWindowDeg;
         proj->o2AfrAt0v = data["o2AfrAt0v"] | proj->o2AfrAt0v;
         proj->o2AfrAt5v = data["o2AfrAt5v"] | proj->o2AfrAt5v;
         proj->closedLoopMinRpm = data["closedLoopMinRpm"] | proj->closedLoopMinRpm;
@@ -1340,36 +1418,34 @@ void WebHandler::setupRoutes() {
     });
 
     // Reboot
-    // Tooth logging
-    _server.on("/teeth", HTTP_POST, [this](AsyncWebServerRequest* r) {
-        if (!_ecu || !_ecu->getCrankSensor()) { r->send(503); return; }
-        _ecu->getCrankSensor()->startToothLog();
-        r->send(200, "text/plain", "Capturing");
+    // Tooth/composite logging — binary frames stream on /ws/trigger while active
+    // (registered before /teeth, which would otherwise also match /teeth/stop)
+    _server.on("/teeth/stop", HTTP_POST, [](AsyncWebServerRequest* r) {
+        TrigLog.stop();
+        r->send(200, "application/json", "{\"status\":\"stopped\"}");
     });
-    _server.on("/teeth", HTTP_GET, [this](AsyncWebServerRequest* r) {
+    _server.on("/teeth", HTTP_POST, [this](AsyncWebServerRequest* r) {
         if (!_ecu || !_ecu->getCrankSensor()) { r->send(503); return; }
-        CrankSensor* cs = _ecu->getCrankSensor();
-        if (cs->isToothLogCapturing()) {
-            r->send(202, "application/json", "{\"status\":\"capturing\",\"count\":" + String(cs->getToothLogSize()) + "}");
+        // ?sd=1 also writes the frames to a file on the SD card
+        char fname[32] = "";
+        if (r->hasParam("sd") && r->getParam("sd")->value() == "1")
+            snprintf(fname, sizeof(fname), "/trig_%lu.bin", (unsigned long)millis());
+        if (!TrigLog.start(fname)) {
+            r->send(409, "application/json", "{\"status\":\"busy\"}");
             return;
         }
-        uint16_t count = cs->getToothLogSize();
-        if (count == 0) {
-            r->send(200, "application/json", "{\"status\":\"empty\",\"data\":[]}");
-            return;
-        }
-        const volatile CrankSensor::ToothLogEntry* log = cs->getToothLog();
-        // Stream as chunked JSON
-        AsyncResponseStream* response = r->beginResponseStream("application/json");
-        response->print("{\"status\":\"complete\",\"count\":");
-        response->print(count);
-        response->print(",\"data\":[");
-        for (uint16_t i = 0; i < count; i++) {
-            if (i > 0) response->print(',');
-            response->printf("{\"p\":%lu,\"t\":%u}", (unsigned long)log[i].periodUs, log[i].toothNum);
-        }
-        response->print("]}");
-        r->send(response);
+        r->send(200, "application/json", "{\"status\":\"capturing\",\"ws\":\"/ws/trigger\"}");
+    });
+    _server.on("/teeth", HTTP_GET, [this](AsyncWebServerRequest* r) {
+        JsonDocument doc;
+        doc["status"] = TrigLog.isActive() ? "capturing" : "idle";
+        doc["records"] = TrigLog.getRecordCount();
+        doc["dropped"] = TrigLog.getDroppedCount();
+        doc["sdFile"] = TrigLog.getSdFile();
+        doc["clients"] = _wsTrigger.count();
+        String json;
+        serializeJson(doc, json);
+        r->send(200, "application/json", json);
     });
 
     _server.on("/reboot", HTTP_POST, [this](AsyncWebServerRequest* r) {
@@ -1411,7 +1487,7 @@ void WebHandler::setupRoutes() {
                 JsonObject o = inputs.add<JsonObject>();
                 o["pin"] = pin; o["name"] = name; o["type"] = "analog"; o["mode"] = "ADC1";
                 o["desc"] = desc; o["range"] = range; o["voltage"] = voltage;
-                uint16_t raw = sens ? sens->getRawAdc(ch) : analogRead(pin);
+                uint16_t raw = sens ? sens->getRawAdc(ch) : NativeAdc::instance().read(pin);
                 o["raw"] = raw;
                 o["mV"] = (int)(raw * 3300.0f / 4095.0f);
             };
@@ -1681,7 +1757,13 @@ void WebHandler::setupRoutes() {
                         JsonObject ch = channels.add<JsonObject>();
                         ch["ch"] = i;
                         ch["name"] = chNames[i];
-                        ch["mV"] = serialized(String(ads0->readMillivolts(i), 1));
+                        ADS1115Reader::Sample s;
+                        if (ads0->getSample(i, s)) {
+                            ch["mV"] = serialized(String(ads0->toMillivolts(s.raw), 1));
+                            ch["ageMs"] = (uint32_t)((esp_timer_get_time() - s.timeUs) / 1000);
+                        } else {
+                            ch["mV"] = "-";   // Not in the rotation (no reader uses it)
+                        }
                     }
                 }
             }
@@ -1704,7 +1786,13 @@ void WebHandler::setupRoutes() {
                         JsonObject ch = channels.add<JsonObject>();
                         ch["ch"] = i;
                         ch["name"] = chNames[i];
-                        ch["mV"] = serialized(String(ads1->readMillivolts(i), 1));
+                        ADS1115Reader::Sample s;
+                        if (ads1->getSample(i, s)) {
+                            ch["mV"] = serialized(String(ads1->toMillivolts(s.raw), 1));
+                            ch["ageMs"] = (uint32_t)((esp_timer_get_time() - s.timeUs) / 1000);
+                        } else {
+                            ch["mV"] = "-";   // Not in the rotation (no reader uses it)
+                        }
                     }
                 }
             }
@@ -1839,6 +1927,7 @@ void WebHandler::setupRoutes() {
                 if (crank) {
                     const char* syncStr[] = {"LOST", "SYNCING", "SYNCED"};
                     doc["crankSync"] = syncStr[crank->getSyncState()];
+                    doc["trigger"] = crank->getDecoder()->name();
                     doc["rpm"] = crank->getRpm();
                 }
             }
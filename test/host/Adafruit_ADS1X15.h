@@ -0,0 +1,63 @@
+#pragma once
+
+// Host stand-in for the Adafruit ADS1X15 library: the register constants ADS1115Reader
+// builds its config word from, and the probe, gain and rate calls it makes at begin().
+
+#include <Wire.h>
+
+#define ADS1X15_REG_POINTER_CONVERT (0x00)
+#define ADS1X15_REG_POINTER_CONFIG (0x01)
+
+#define ADS1X15_REG_CONFIG_OS_SINGLE (0x8000)
+#define ADS1X15_REG_CONFIG_MUX_DIFF_0_1 (0x0000)
+#define ADS1X15_REG_CONFIG_MUX_DIFF_2_3 (0x3000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_0 (0x4000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_1 (0x5000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_2 (0x6000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_3 (0x7000)
+#define ADS1X15_REG_CONFIG_MODE_SINGLE (0x0100)
+#define ADS1X15_REG_CONFIG_CMODE_TRAD (0x0000)
+#define ADS1X15_REG_CONFIG_CPOL_ACTVLOW (0x0000)
+#define ADS1X15_REG_CONFIG_CLAT_NONLAT (0x0000)
+#define ADS1X15_REG_CONFIG_CQUE_NONE (0x0003)
+
+constexpr uint16_t MUX_BY_CHANNEL[] = {
+    ADS1X15_REG_CONFIG_MUX_SINGLE_0, ADS1X15_REG_CONFIG_MUX_SINGLE_1,
+    ADS1X15_REG_CONFIG_MUX_SINGLE_2, ADS1X15_REG_CONFIG_MUX_SINGLE_3 };
+
+typedef enum {
+    GAIN_TWOTHIRDS = 0x0000,
+    GAIN_ONE = 0x0200,
+    GAIN_TWO = 0x0400,
+    GAIN_FOUR = 0x0600,
+    GAIN_EIGHT = 0x0800,
+    GAIN_SIXTEEN = 0x0A00
+} adsGain_t;
+
+#define RATE_ADS1115_8SPS (0x0000)
+#define RATE_ADS1115_16SPS (0x0020)
+#define RATE_ADS1115_32SPS (0x0040)
+#define RATE_ADS1115_64SPS (0x0060)
+#define RATE_ADS1115_128SPS (0x0080)
+#define RATE_ADS1115_250SPS (0x00A0)
+#define RATE_ADS1115_475SPS (0x00C0)
+#define RATE_ADS1115_860SPS (0x00E0)
+
+class Adafruit_ADS1115 {
+public:
+    // Present if the address ACKs
+    bool begin(uint8_t addr = 0x48, TwoWire* wire = &Wire) {
+        wire->beginTransmission(addr);
+        return wire->endTransmission() == 0;
+    }
+    void setGain(adsGain_t gain) { _gain = gain; }
+    void setDataRate(uint16_t rate) { _rate = rate; }
+    float computeVolts(int16_t counts) {
+        static const float FS[6] = { 6.144f, 4.096f, 2.048f, 1.024f, 0.512f, 0.256f };
+        return counts * FS[(_gain >> 9) % 6] / 32768.0f;
+    }
+
+private:
+    adsGain_t _gain = GAIN_TWOTHIRDS;
+    uint16_t _rate = RATE_ADS1115_128SPS;
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+// Host stand-in for the Arduino-ESP32 core, for the native test env only. Covers what the
+// hardware-independent sources use: a virtual microsecond clock, pin interrupts and hardware
+// timers the test fires by hand, and the few FreeRTOS types that appear in their headers.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define WORD_ALIGNED_ATTR __attribute__((aligned(4)))
+
+#ifndef constrain
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
+
+// ---- Virtual time --------------------------------------------------------------------------
+
+namespace host {
+    // Current time. Advance with setTime() so armed hardware timers fire on the way.
+    extern int64_t nowUs;
+    void setTime(int64_t us);
+
+    // Run the handler attached to a pin, as the GPIO interrupt would at nowUs
+    bool fireInterrupt(uint8_t pin);
+
+    // Output level per GPIO: the last digitalWrite or set/clear register write, and what
+    // digitalRead returns. pinWatch (optional) sees every write, at nowUs.
+    static const uint8_t MAX_PINS = 64;
+    extern uint8_t pinLevel[MAX_PINS];
+    extern void (*pinWatch)(uint8_t pin, uint8_t val);
+    void writePin(uint8_t pin, uint8_t val);
+
+    // GPIO output set/clear registers (soc/gpio_reg.h): pins 0-31, then 32-48
+    enum : uint32_t { REG_OUT_W1TS = 1, REG_OUT_W1TC, REG_OUT1_W1TS, REG_OUT1_W1TC };
+    void regWrite(uint32_t reg, uint32_t mask);
+
+    // Forget attached handlers, timers and pin levels between tests
+    void reset();
+}
+
+inline int64_t esp_timer_get_time() { return host::nowUs; }
+inline unsigned long millis() { return (unsigned long)(host::nowUs / 1000); }
+inline unsigned long micros() { return (unsigned long)host::nowUs; }
+inline void delayMicroseconds(uint32_t us) { host::setTime(host::nowUs + us); }
+
+// ---- GPIO ----------------------------------------------------------------------------------
+
+#define INPUT 0x01
+#define INPUT_PULLUP 0x05
+#define OUTPUT 0x03
+#define OUTPUT_OPEN_DRAIN 0x13
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define LOW 0x0
+#define HIGH 0x1
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t pin, uint8_t val) { host::writePin(pin, val); }
+inline int digitalRead(uint8_t pin) { return pin < host::MAX_PINS ? host::pinLevel[pin] : LOW; }
+inline uint8_t digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(uint8_t pin, void (*fn)(), int mode);
+void attachInterruptArg(uint8_t pin, void (*fn)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+// ---- Analog input (ESP32-S3: GPIO1-10 ADC1 channels 0-9, GPIO11-20 ADC2 numbered 10-19) ----
+
+namespace host {
+    // 12-bit level per GPIO: what analogRead() returns and the ADC1 DMA scan samples
+    extern uint16_t analogLevel[MAX_PINS];
+}
+
+inline int8_t digitalPinToAnalogChannel(uint8_t pin) { return (pin >= 1 && pin <= 20) ? pin - 1 : -1; }
+inline uint16_t analogRead(uint8_t pin) { return pin < host::MAX_PINS ? host::analogLevel[pin] : 0; }
+
+// ---- Hardware timers (1 MHz count; one-shot alarms disable themselves) ---------------------
+
+struct hw_timer_t {
+    void (*fn)();
+    uint64_t alarmUs;
+    int64_t zeroUs;         // Virtual time the count was last 0
+    bool autoreload;
+    bool enabled;
+    bool used;
+};
+
+hw_timer_t* timerBegin(uint8_t num, uint16_t divider, bool countUp);
+void timerEnd(hw_timer_t* timer);
+void timerAttachInterrupt(hw_timer_t* timer, void (*fn)(), bool edge);
+void timerDetachInterrupt(hw_timer_t* timer);
+void timerWrite(hw_timer_t* timer, uint64_t val);
+void timerAlarmWrite(hw_timer_t* timer, uint64_t alarmValue, bool autoreload);
+void timerAlarmEnable(hw_timer_t* timer);
+void timerAlarmDisable(hw_timer_t* timer);
+
+// ---- FreeRTOS (no scheduler: a task runs only when the test plays it) ----------------------
+
+namespace host {
+    // Play a task started with xTaskCreatePinnedToCore: its body runs on the virtual clock,
+    // each vTaskDelay advancing it a tick (1 ms), and is unwound once the clock reaches
+    // untilUs. The next call starts the body from the top again, so only loops that keep no
+    // locals across passes play correctly. false if no task has that name.
+    bool runTask(const char* name, int64_t untilUs);
+    // A blocking call in the played task (vTaskDelay, a driver read) sleeping until whenUs:
+    // advances the clock, and unwinds the task once it reaches the deadline
+    void taskWait(int64_t whenUs);
+}
+
+typedef int BaseType_t;
+typedef void* TaskHandle_t;
+typedef struct { int owner; } portMUX_TYPE;
+enum eNotifyAction { eNoAction, eSetBits, eIncrement, eSetValueWithOverwrite };
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))
+#define portYIELD_FROM_ISR() ((void)0)
+
+inline BaseType_t xTaskNotifyFromISR(TaskHandle_t, uint32_t, eNotifyAction, BaseType_t*) { return pdPASS; }
+inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t*) {}
+inline uint32_t ulTaskNotifyTake(BaseType_t, uint32_t) { return 0; }
+// Registered for host::runTask(), never run on its own
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void*), const char* name, uint32_t stack, void* param,
+                                   unsigned int prio, TaskHandle_t* handle, BaseType_t core);
+void vTaskDelay(uint32_t ticks);
+#define pdMS_TO_TICKS(ms) ((uint32_t)(ms))
+inline BaseType_t xPortInIsrContext() { return pdFALSE; }
+
+// ---- String (storage only — the host build never formats through it) ----------------------
+
+class String {
+public:
+    String(const char* s = "") : _s(s ? s : "") {}
+    const char* c_str() const { return _s.c_str(); }
+    size_t length() const { return _s.size(); }
+    bool operator==(const char* s) const { return _s == s; }
+    bool operator==(const String& o) const { return _s == o._s; }
+private:
+    std::string _s;
+};
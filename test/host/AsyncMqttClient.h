@@ -0,0 +1,4 @@
+#pragma once
+
+// Host stand-in: Logger only holds a pointer to the client
+class AsyncMqttClient;
@@ -0,0 +1,3 @@
+#pragma once
+
+// Host stand-in: log rotation (the only user) is not built in the native env
@@ -0,0 +1,21 @@
+#pragma once
+
+// Host stand-in: SD is never opened in the native env, fs::File only has to exist as a member
+
+#include <Arduino.h>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+class File {
+public:
+    explicit operator bool() const { return false; }
+    size_t read(uint8_t*, size_t) { return 0; }
+    size_t write(const uint8_t*, size_t) { return 0; }
+    void flush() {}
+    void close() {}
+};
+}
+using fs::File;
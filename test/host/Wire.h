@@ -0,0 +1,33 @@
+#pragma once
+
+// Host stand-in for the Arduino-ESP32 TwoWire: transactions go to the emulated devices in
+// host_i2cbus.cpp. Return codes as on the target: endTransmission() 0 = ACK, 2 = address
+// NACK, 5 = timeout; requestFrom() the bytes received.
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    bool end();
+    void setTimeOut(uint16_t ms) { _timeOutMs = ms; }
+    bool setClock(uint32_t hz) { _clockHz = hz; return true; }
+
+    void beginTransmission(uint8_t addr);
+    size_t write(uint8_t b);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t addr, uint8_t len);
+    int read();
+
+private:
+    uint16_t _timeOutMs = 50;
+    uint32_t _clockHz = 100000;
+    uint8_t _txAddr = 0;
+    uint8_t _tx[8] = {};
+    uint8_t _txLen = 0;
+    uint8_t _rx[8] = {};
+    uint8_t _rxLen = 0;
+    uint8_t _rxPos = 0;
+};
+
+extern TwoWire Wire;
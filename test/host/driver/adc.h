@@ -0,0 +1,66 @@
+#pragma once
+
+// Host stand-in: the IDF 4.4 ADC digital controller (continuous/DMA) API on the ESP32-S3, as
+// NativeAdc uses it. The emulated controller (host_adc.cpp) scans its pattern at the configured
+// rate in virtual time and hands out type-2 results a frame at a time.
+
+#include <stdint.h>
+#include <esp_err.h>
+
+#define SOC_ADC_DIGI_MAX_BITWIDTH 12
+
+typedef enum { ADC_ATTEN_DB_0, ADC_ATTEN_DB_2_5, ADC_ATTEN_DB_6, ADC_ATTEN_DB_11 } adc_atten_t;
+
+typedef enum {
+    ADC_CONV_SINGLE_UNIT_1 = 1,
+    ADC_CONV_SINGLE_UNIT_2 = 2,
+    ADC_CONV_BOTH_UNIT = 3,
+    ADC_CONV_ALTER_UNIT = 7,
+} adc_digi_convert_mode_t;
+
+typedef enum { ADC_DIGI_OUTPUT_FORMAT_TYPE1, ADC_DIGI_OUTPUT_FORMAT_TYPE2 } adc_digi_output_format_t;
+
+typedef struct {
+    uint32_t max_store_buf_size;    // Driver ring, bytes
+    uint32_t conv_num_each_intr;    // Bytes per frame
+    uint32_t adc1_chan_mask;
+    uint32_t adc2_chan_mask;
+} adc_digi_init_config_t;
+
+typedef struct {
+    uint8_t atten;
+    uint8_t channel;
+    uint8_t unit;
+    uint8_t bit_width;
+} adc_digi_pattern_config_t;
+
+typedef struct {
+    bool conv_limit_en;
+    uint32_t conv_limit_num;
+    uint32_t pattern_num;
+    adc_digi_pattern_config_t* adc_pattern;
+    uint32_t sample_freq_hz;
+    adc_digi_convert_mode_t conv_mode;
+    adc_digi_output_format_t format;
+} adc_digi_configuration_t;
+
+typedef struct {
+    union {
+        struct {
+            uint32_t data : 12;
+            uint32_t reserved12 : 1;
+            uint32_t channel : 4;
+            uint32_t unit : 1;
+            uint32_t reserved17_31 : 14;
+        } type2;
+        uint32_t val;
+    };
+} adc_digi_output_data_t;
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t* init_config);
+esp_err_t adc_digi_deinitialize(void);
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t* config);
+esp_err_t adc_digi_start(void);
+esp_err_t adc_digi_stop(void);
+// Blocks the calling task until a frame is complete or timeout_ms passes (host::taskWait)
+esp_err_t adc_digi_read_bytes(uint8_t* buf, uint32_t length_max, uint32_t* out_length, uint32_t timeout_ms);
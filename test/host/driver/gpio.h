@@ -0,0 +1,7 @@
+#pragma once
+
+// Host stand-in: ESP32-S3 output-capable GPIOs (0-21, 26-48)
+
+#include <Arduino.h>
+
+#define GPIO_IS_VALID_OUTPUT_GPIO(pin) ((pin) < 49 && ((pin) < 22 || (pin) > 25))
@@ -0,0 +1,26 @@
+#pragma once
+
+// Host stand-in: SpiBus.h only holds device handles and its burst transaction descriptors.
+// The host SpiBus (host_spibus.cpp) never reaches the master driver.
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct spi_device_t* spi_device_handle_t;
+
+struct spi_transaction_t {
+    uint32_t flags;
+    uint16_t cmd;
+    uint64_t addr;
+    size_t length;
+    size_t rxlength;
+    void* user;
+    union {
+        const void* tx_buffer;
+        uint8_t tx_data[4];
+    };
+    union {
+        void* rx_buffer;
+        uint8_t rx_data[4];
+    };
+};
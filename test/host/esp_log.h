@@ -0,0 +1,3 @@
+#pragma once
+
+// Host stand-in: sources that include it log through Log, never ESP_LOGx
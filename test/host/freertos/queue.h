@@ -0,0 +1,18 @@
+#pragma once
+
+// Host stand-in: a copy-in / copy-out FIFO, no blocking — there is only one thread
+
+#include <Arduino.h>
+
+typedef uint32_t TickType_t;
+typedef unsigned int UBaseType_t;
+typedef struct QueueDefinition* QueueHandle_t;
+
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+void vQueueDelete(QueueHandle_t q);
+// pdTRUE, or pdFALSE when full / empty (the wait is ignored)
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
@@ -0,0 +1,8 @@
+#pragma once
+
+// Host stand-in: types only. The host SpiBus completes futures without a semaphore.
+
+#include "queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+typedef struct { void* reserved[10]; } StaticSemaphore_t;
@@ -0,0 +1,131 @@
+// Host ADC: the ADC digital controller behind the adc_digi_* stand-in. Conversions run through
+// the pattern back to back at the sample rate from adc_digi_start(), each stamped with its own
+// time, and a read returns the next whole frame once its last conversion is done. A reader that
+// falls a full ring behind loses the oldest results, as the driver does. Built into every host
+// test via build_src_filter.
+
+#include "host_adc.h"
+
+namespace host {
+
+uint16_t (*adcSignal)(uint8_t ch, int64_t sampleUs);
+
+static AdcScan scan;
+static bool initialized;
+static uint32_t ringBytes;
+static int64_t startUs;
+static uint64_t delivered;      // Conversions handed out since start
+
+const AdcScan& adcScan() { return scan; }
+
+void resetAdc() {
+    memset(&scan, 0, sizeof(scan));
+    initialized = false;
+    adcSignal = nullptr;
+}
+
+static int64_t conversionUs(uint64_t k) { return startUs + (int64_t)(k * 1000000 / scan.sampleHz); }
+
+static uint16_t sample(uint8_t ch, int64_t atUs) {
+    uint16_t v = adcSignal ? adcSignal(ch, atUs) : analogLevel[ch + 1];
+    return v > 4095 ? 4095 : v;
+}
+
+}  // namespace host
+
+using namespace host;
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t* init) {
+    if (initialized || !init->conv_num_each_intr || init->conv_num_each_intr % 4) {
+        scan.misuse++;
+        return ESP_ERR_INVALID_STATE;
+    }
+    initialized = true;
+    ringBytes = init->max_store_buf_size;
+    scan.frameBytes = init->conv_num_each_intr;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_deinitialize() {
+    if (!initialized || scan.running) {
+        scan.misuse++;
+        return ESP_ERR_INVALID_STATE;
+    }
+    initialized = false;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t* cfg) {
+    if (!initialized || scan.running) {
+        scan.misuse++;
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!cfg->pattern_num || cfg->pattern_num > sizeof(scan.pattern) / sizeof(scan.pattern[0]) ||
+        !cfg->sample_freq_hz || cfg->format != ADC_DIGI_OUTPUT_FORMAT_TYPE2) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    scan.patternNum = cfg->pattern_num;
+    memcpy(scan.pattern, cfg->adc_pattern, cfg->pattern_num * sizeof(adc_digi_pattern_config_t));
+    scan.sampleHz = cfg->sample_freq_hz;
+    scan.configures++;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_start() {
+    if (!initialized || !scan.configures || scan.running) {
+        scan.misuse++;
+        return ESP_ERR_INVALID_STATE;
+    }
+    scan.running = true;
+    startUs = nowUs;
+    delivered = 0;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_stop() {
+    if (!scan.running) {
+        scan.misuse++;
+        return ESP_ERR_INVALID_STATE;
+    }
+    scan.running = false;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_read_bytes(uint8_t* buf, uint32_t lengthMax, uint32_t* outLength, uint32_t timeoutMs) {
+    *outLength = 0;
+    int64_t timeoutAt = nowUs + (int64_t)timeoutMs * 1000;
+    if (!scan.running) {
+        taskWait(timeoutAt);
+        return ESP_ERR_TIMEOUT;
+    }
+    uint32_t n = (lengthMax < scan.frameBytes ? lengthMax : scan.frameBytes) / 4;
+
+    // Results the ring no longer holds are gone
+    esp_err_t err = ESP_OK;
+    uint64_t done = (uint64_t)(nowUs - startUs) * scan.sampleHz / 1000000;
+    uint64_t ringConv = ringBytes / 4;
+    if (done > delivered + ringConv) {
+        delivered = done - ringConv;
+        err = ESP_ERR_INVALID_STATE;
+    }
+
+    int64_t readyUs = conversionUs(delivered + n - 1);
+    if (readyUs > timeoutAt) {
+        taskWait(timeoutAt);
+        return ESP_ERR_TIMEOUT;
+    }
+    if (readyUs > nowUs) taskWait(readyUs);
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t k = delivered + i;
+        const adc_digi_pattern_config_t& p = scan.pattern[k % scan.patternNum];
+        adc_digi_output_data_t r = {};
+        r.type2.data = sample(p.channel, conversionUs(k));
+        r.type2.channel = p.channel;
+        r.type2.unit = p.unit;
+        memcpy(&buf[i * 4], &r, 4);
+    }
+    delivered += n;
+    *outLength = n * 4;
+    return err;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+// Host ADC for the native env: the adc_digi_* stand-in scans its pattern in virtual time,
+// sampling host::analogLevel (GPIO = ADC1 channel + 1) or adcSignal. NativeAdc's DMA task is
+// the real one, played with host::runTask("adc_dma", untilUs).
+
+#include <Arduino.h>
+#include <driver/adc.h>
+
+namespace host {
+    // Overrides analogLevel for the scan: the 12-bit value of an ADC1 channel converted at sampleUs
+    extern uint16_t (*adcSignal)(uint8_t ch, int64_t sampleUs);
+
+    // What the controller was last configured with, and how often
+    struct AdcScan {
+        uint32_t configures;        // adc_digi_controller_configure calls that took
+        uint32_t patternNum;
+        adc_digi_pattern_config_t pattern[16];
+        uint32_t sampleHz;
+        uint32_t frameBytes;
+        bool running;
+        uint32_t misuse;            // Calls the IDF driver refuses in that state (configure while running, ...)
+    };
+    const AdcScan& adcScan();
+
+    // Stop and forget the controller (the NativeAdc singleton keeps its state)
+    void resetAdc();
+}
@@ -0,0 +1,178 @@
+// Host I2C bus: the Wire stand-in on emulated ADS1115s (pointer, config and conversion
+// registers, single-shot conversions timed on the virtual clock) and a slave that can hold SDA
+// until the recovery clocks it free. Built into every host test via build_src_filter.
+
+#include <Wire.h>
+#include "host_i2cbus.h"
+
+TwoWire Wire;
+
+namespace host {
+
+static const uint8_t ADS_MAX = 4;           // 0x48-0x4B, by ADDR pin strapping
+static const uint8_t ADS_BASE = 0x48;
+static const uint16_t ADS_SPS[8] = { 8, 16, 32, 64, 128, 250, 475, 860 };
+
+struct Ads {
+    bool present;
+    bool nak;
+    uint8_t pointer;
+    uint16_t config;
+    int16_t input[4];
+    int16_t result;         // Conversion register
+    uint8_t resultCh;
+    int16_t converting;     // Value and channel of the conversion in flight
+    uint8_t convertingCh;
+    int64_t doneUs;         // It lands in the conversion register at this time, 0 = none
+};
+static Ads ads[ADS_MAX];
+static std::vector<I2cOp> ops;
+
+int16_t (*adsSignal)(uint8_t addr, uint8_t ch, int64_t startUs);
+
+static uint8_t sdaPin = 0xFF;
+static uint8_t sclPin = 0xFF;
+static uint8_t heldClocks;
+static void (*chainedWatch)(uint8_t pin, uint8_t val);
+
+static Ads* device(uint8_t addr) {
+    if (addr < ADS_BASE || addr >= ADS_BASE + ADS_MAX) return nullptr;
+    Ads& a = ads[addr - ADS_BASE];
+    return (a.present && !a.nak) ? &a : nullptr;
+}
+
+static void settle(Ads& a) {
+    if (a.doneUs && nowUs >= a.doneUs) {
+        a.result = a.converting;
+        a.resultCh = a.convertingCh;
+        a.doneUs = 0;
+    }
+}
+
+void addAds1115(uint8_t addr) {
+    if (addr < ADS_BASE || addr >= ADS_BASE + ADS_MAX) return;
+    Ads& a = ads[addr - ADS_BASE];
+    memset(&a, 0, sizeof(a));
+    a.present = true;
+    a.config = 0x8583;
+}
+
+void setAdsInput(uint8_t addr, uint8_t ch, int16_t raw) {
+    if (addr >= ADS_BASE && addr < ADS_BASE + ADS_MAX && ch < 4) ads[addr - ADS_BASE].input[ch] = raw;
+}
+
+void setI2cNak(uint8_t addr, bool nak) {
+    if (addr >= ADS_BASE && addr < ADS_BASE + ADS_MAX) ads[addr - ADS_BASE].nak = nak;
+}
+
+// The stuck slave lets go of SDA after its remaining clocks; until then SDA reads low
+// whatever the master drives
+static void onBusPin(uint8_t pin, uint8_t val) {
+    if (chainedWatch) chainedWatch(pin, val);
+    if (!heldClocks) return;
+    if (pin == sclPin && val == LOW && --heldClocks == 0) {
+        pinWatch = chainedWatch;
+        pinLevel[sdaPin] = HIGH;
+        return;
+    }
+    pinLevel[sdaPin] = LOW;
+}
+
+void holdSda(uint8_t clocks) {
+    if (sdaPin >= MAX_PINS || !clocks) return;
+    if (!heldClocks) {
+        chainedWatch = pinWatch;
+        pinWatch = onBusPin;
+    }
+    heldClocks = clocks;
+    pinLevel[sdaPin] = LOW;
+}
+
+const std::vector<I2cOp>& i2cLog() { return ops; }
+void clearI2cLog() { ops.clear(); }
+
+void resetI2cBus() {
+    memset(ads, 0, sizeof(ads));
+    ops.clear();
+    adsSignal = nullptr;
+    if (heldClocks) pinWatch = chainedWatch;
+    heldClocks = 0;
+}
+
+// A write transaction: pointer, then a config word if two more bytes follow
+static void adsWrite(uint8_t addr, Ads& a, const uint8_t* tx, uint8_t len) {
+    if (len < 1) return;
+    a.pointer = tx[0] & 0x03;
+    if (a.pointer != 0x01 || len < 3) return;
+    uint16_t cfg = (uint16_t)tx[1] << 8 | tx[2];
+    a.config = cfg & 0x7FFF;
+    if (!(cfg & 0x8000)) return;
+    // Single-shot start; only the single-ended MUX settings are emulated
+    uint8_t mux = (cfg >> 12) & 0x07;
+    uint8_t ch = mux >= 4 ? mux - 4 : 0;
+    settle(a);
+    a.converting = adsSignal ? adsSignal(addr, ch, nowUs) : a.input[ch];
+    a.convertingCh = ch;
+    a.doneUs = nowUs + 1000000 / ADS_SPS[(cfg >> 5) & 7];
+    ops.push_back(I2cOp{ I2C_START, addr, ch, nowUs });
+}
+
+}  // namespace host
+
+// ---- TwoWire ----
+
+bool TwoWire::begin(int sda, int scl, uint32_t) {
+    host::sdaPin = (uint8_t)sda;
+    host::sclPin = (uint8_t)scl;
+    host::ops.push_back(host::I2cOp{ host::I2C_WIRE_BEGIN, 0, 0, host::nowUs });
+    return true;
+}
+
+bool TwoWire::end() { return true; }
+
+void TwoWire::beginTransmission(uint8_t addr) {
+    _txAddr = addr;
+    _txLen = 0;
+}
+
+size_t TwoWire::write(uint8_t b) {
+    if (_txLen >= sizeof(_tx)) return 0;
+    _tx[_txLen++] = b;
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+    if (host::heldClocks) {
+        host::setTime(host::nowUs + (int64_t)_timeOutMs * 1000);
+        return 5;
+    }
+    host::Ads* a = host::device(_txAddr);
+    if (!a) return 2;
+    host::adsWrite(_txAddr, *a, _tx, _txLen);
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t addr, uint8_t len) {
+    _rxLen = _rxPos = 0;
+    if (host::heldClocks) {
+        host::setTime(host::nowUs + (int64_t)_timeOutMs * 1000);
+        return 0;
+    }
+    host::Ads* a = host::device(addr);
+    if (!a || len > sizeof(_rx)) return 0;
+    host::settle(*a);
+    uint16_t val;
+    if (a->pointer == 0x00) {
+        val = (uint16_t)a->result;
+        host::ops.push_back(host::I2cOp{ host::I2C_READ, addr, a->resultCh, host::nowUs });
+    } else {
+        val = a->config | (a->doneUs ? 0 : 0x8000);     // OS reads 1 when not converting
+    }
+    for (uint8_t i = 0; i < len; i++) _rx[i] = (i & 1) ? (uint8_t)val : (uint8_t)(val >> 8);
+    _rxLen = len;
+    return len;
+}
+
+int TwoWire::read() {
+    return _rxPos < _rxLen ? _rx[_rxPos++] : -1;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+// Host I2C bus for the native env: the Wire stand-in talks to emulated ADS1115s that convert
+// in virtual time, and a slave stuck mid-byte can be made to hold SDA. The I2cBus task itself
+// is the real one, played with host::runTask("i2c_bus", untilUs).
+
+#include <Arduino.h>
+#include <vector>
+
+namespace host {
+    // An ADS1115 at this 7-bit address, config register at its power-on value. A conversion
+    // takes its nominal data-rate time; the result register holds the previous result until then.
+    void addAds1115(uint8_t addr);
+    // Input on a single-ended channel as a raw code, latched when a conversion starts. signal
+    // (optional) overrides it with a value computed from the conversion's start time.
+    void setAdsInput(uint8_t addr, uint8_t ch, int16_t raw);
+    extern int16_t (*adsSignal)(uint8_t addr, uint8_t ch, int64_t startUs);
+    // The device stops acknowledging its address
+    void setI2cNak(uint8_t addr, bool nak);
+    // A slave stuck mid-byte: SDA (the pin given to Wire.begin) held low and every transaction
+    // timing out, until SCL has been clocked low this many times
+    void holdSda(uint8_t clocks);
+
+    // What the devices saw: conversion starts and result reads (ch: the conversion the result
+    // register held), and each Wire.begin
+    enum I2cOpType : uint8_t { I2C_START, I2C_READ, I2C_WIRE_BEGIN };
+    struct I2cOp {
+        I2cOpType type;
+        uint8_t addr;
+        uint8_t ch;
+        int64_t timeUs;
+    };
+    const std::vector<I2cOp>& i2cLog();
+    void clearI2cLog();
+
+    // Remove the devices and release the bus (the I2cBus singleton keeps its state)
+    void resetI2cBus();
+}
@@ -0,0 +1,233 @@
+// Native env runtime: the virtual clock, interrupt, timer, task and queue plumbing behind the
+// Arduino.h / FreeRTOS stand-ins, and the Log / TrigLog globals the sensor sources reference.
+// Built into every host test via build_src_filter.
+
+#include <Arduino.h>
+#include <freertos/queue.h>
+#include <stdarg.h>
+#include <deque>
+#include <vector>
+#include "Logger.h"
+#include "TriggerLogger.h"
+
+namespace host {
+
+int64_t nowUs = 0;
+
+static const uint8_t MAX_TIMERS = 4;
+uint8_t pinLevel[MAX_PINS];
+uint16_t analogLevel[MAX_PINS];
+void (*pinWatch)(uint8_t pin, uint8_t val);
+static void (*pinIsr[MAX_PINS])();
+static void (*pinIsrArg[MAX_PINS])(void*);
+static void* pinArg[MAX_PINS];
+static hw_timer_t timers[MAX_TIMERS];
+
+void setTime(int64_t us) {
+    // Fire due alarms in time order, each at its own alarm time
+    for (;;) {
+        hw_timer_t* due = nullptr;
+        for (uint8_t i = 0; i < MAX_TIMERS; i++) {
+            hw_timer_t& t = timers[i];
+            if (!t.used || !t.enabled || !t.fn) continue;
+            int64_t at = t.zeroUs + (int64_t)t.alarmUs;
+            if (at <= us && (!due || at < due->zeroUs + (int64_t)due->alarmUs)) due = &t;
+        }
+        if (!due) break;
+        int64_t at = due->zeroUs + (int64_t)due->alarmUs;
+        if (at > nowUs) nowUs = at;
+        if (due->autoreload) due->zeroUs = at;
+        else due->enabled = false;
+        due->fn();
+    }
+    nowUs = us;
+}
+
+void writePin(uint8_t pin, uint8_t val) {
+    if (pin >= MAX_PINS) return;
+    pinLevel[pin] = val ? HIGH : LOW;
+    if (pinWatch) pinWatch(pin, pinLevel[pin]);
+}
+
+void regWrite(uint32_t reg, uint32_t mask) {
+    uint8_t base = (reg == REG_OUT1_W1TS || reg == REG_OUT1_W1TC) ? 32 : 0;
+    uint8_t val = (reg == REG_OUT_W1TS || reg == REG_OUT1_W1TS) ? HIGH : LOW;
+    for (uint8_t b = 0; b < 32; b++) {
+        if (mask & (1UL << b)) writePin(base + b, val);
+    }
+}
+
+bool fireInterrupt(uint8_t pin) {
+    if (pin >= MAX_PINS) return false;
+    if (pinIsr[pin]) pinIsr[pin]();
+    else if (pinIsrArg[pin]) pinIsrArg[pin](pinArg[pin]);
+    else return false;
+    return true;
+}
+
+void reset() {
+    nowUs = 0;
+    memset(pinLevel, 0, sizeof(pinLevel));
+    memset(analogLevel, 0, sizeof(analogLevel));
+    pinWatch = nullptr;
+    memset(pinIsr, 0, sizeof(pinIsr));
+    memset(pinIsrArg, 0, sizeof(pinIsrArg));
+    memset(timers, 0, sizeof(timers));
+}
+
+}  // namespace host
+
+void attachInterrupt(uint8_t pin, void (*fn)(), int) {
+    if (pin < host::MAX_PINS) host::pinIsr[pin] = fn;
+}
+
+void attachInterruptArg(uint8_t pin, void (*fn)(void*), void* arg, int) {
+    if (pin >= host::MAX_PINS) return;
+    host::pinIsrArg[pin] = fn;
+    host::pinArg[pin] = arg;
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin >= host::MAX_PINS) return;
+    host::pinIsr[pin] = nullptr;
+    host::pinIsrArg[pin] = nullptr;
+}
+
+hw_timer_t* timerBegin(uint8_t num, uint16_t, bool) {
+    if (num >= host::MAX_TIMERS || host::timers[num].used) return nullptr;
+    hw_timer_t* t = &host::timers[num];
+    memset(t, 0, sizeof(*t));
+    t->used = true;
+    t->zeroUs = host::nowUs;
+    return t;
+}
+
+void timerEnd(hw_timer_t* timer) { timer->used = false; }
+void timerAttachInterrupt(hw_timer_t* timer, void (*fn)(), bool) { timer->fn = fn; }
+void timerDetachInterrupt(hw_timer_t* timer) { timer->fn = nullptr; }
+void timerWrite(hw_timer_t* timer, uint64_t val) { timer->zeroUs = host::nowUs - (int64_t)val; }
+void timerAlarmEnable(hw_timer_t* timer) { timer->enabled = true; }
+void timerAlarmDisable(hw_timer_t* timer) { timer->enabled = false; }
+
+void timerAlarmWrite(hw_timer_t* timer, uint64_t alarmValue, bool autoreload) {
+    timer->alarmUs = alarmValue;
+    timer->autoreload = autoreload;
+}
+
+// ---- Tasks: registered at creation, played by host::runTask()
+
+namespace host {
+
+struct HostTask {
+    void (*fn)(void*);
+    void* param;
+    std::string name;
+};
+static std::vector<HostTask> tasks;
+static int64_t taskUntilUs = -1;    // Deadline of the task being played, -1 outside one
+struct TaskUnwind {};
+
+bool runTask(const char* name, int64_t untilUs) {
+    for (const HostTask& t : tasks) {
+        if (t.name != name) continue;
+        taskUntilUs = untilUs;
+        try {
+            t.fn(t.param);
+        } catch (const TaskUnwind&) {
+        }
+        taskUntilUs = -1;
+        return true;
+    }
+    return false;
+}
+
+void taskWait(int64_t whenUs) {
+    setTime(whenUs);
+    if (taskUntilUs >= 0 && nowUs >= taskUntilUs) throw TaskUnwind();
+}
+
+}  // namespace host
+
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void*), const char* name, uint32_t, void* param,
+                                   unsigned int, TaskHandle_t* handle, BaseType_t) {
+    host::tasks.push_back(host::HostTask{fn, param, name});
+    if (handle) *handle = (TaskHandle_t)(uintptr_t)host::tasks.size();
+    return pdPASS;
+}
+
+void vTaskDelay(uint32_t ticks) { host::taskWait(host::nowUs + (int64_t)ticks * 1000); }
+
+// ---- Queues: items copied in and out by value, as FreeRTOS does
+
+struct QueueDefinition {
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    return new QueueDefinition{length, itemSize, {}};
+}
+
+void vQueueDelete(QueueHandle_t q) { delete q; }
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t) {
+    if (q->items.size() >= q->length) return pdFALSE;
+    const uint8_t* p = (const uint8_t*)item;
+    q->items.emplace_back(p, p + q->itemSize);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t) {
+    if (q->items.empty()) return pdFALSE;
+    memcpy(item, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) { return (UBaseType_t)q->items.size(); }
+
+// ---- Log: errors and warnings to stderr, so a failing test shows what the firmware would log
+
+Logger Log;
+
+Logger::Logger()
+    : _level(LOG_WARN), _serialEnabled(true), _mqttEnabled(false),
+      _sdCardEnabled(false), _wsEnabled(false), _mqttClient(nullptr),
+      _ws(nullptr), _sdReady(false), _maxFileSize(DEFAULT_MAX_FILE_SIZE),
+      _maxRotatedFiles(DEFAULT_MAX_ROTATED_FILES), _compressionAvailable(false),
+      _ringBufferMax(0), _ringBufferHead(0), _ringBufferCount(0) {}
+
+static void hostLog(const char* level, const char* tag, const char* format, va_list args) {
+    fprintf(stderr, "[%s] [%s] ", level, tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+}
+
+void Logger::error(const char* tag, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    hostLog("ERROR", tag, format, args);
+    va_end(args);
+}
+
+void Logger::warn(const char* tag, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    hostLog("WARN", tag, format, args);
+    va_end(args);
+}
+
+void Logger::info(const char*, const char*, ...) {}
+void Logger::debug(const char*, const char*, ...) {}
+
+// ---- TrigLog: never started on the host, so every logIsrAt() is the one flag test
+
+TriggerLogger TrigLog;
+
+TriggerLogger::TriggerLogger()
+    : _active(false), _closePending(false), _isrDropped(0), _taskDropped(0),
+      _sinkDropped(0), _records(0),
+      _ws(nullptr), _drainTask(nullptr), _frame(nullptr) {
+    _sdFile[0] = '\0';
+}
@@ -0,0 +1,245 @@
+// Host SpiBus: the real queueing and request handling, with the bus task run on demand by
+// host::runSpiBus() (or by a SpiFuture wait) instead of from a Core 0 task, and the wire
+// replaced by MCP23S17 register files. Built into every host test via build_src_filter.
+
+#include "SpiBus.h"
+#include "host_spibus.h"
+
+// ---- Emulated MCP23S17s (BANK=0, sequential addressing) ----
+
+namespace host {
+
+static const uint8_t MCP_MAX = 8;
+static const uint8_t MCP_REGS = 0x16;
+
+struct Mcp {
+    bool present;
+    uint8_t reg[MCP_REGS];
+    uint16_t inputs;
+};
+static Mcp mcp[MCP_MAX];
+
+static void (*busTask)(void*);
+static void* busArg;
+
+void addMcp23s17(uint8_t hwAddr) {
+    if (hwAddr >= MCP_MAX) return;
+    Mcp& m = mcp[hwAddr];
+    memset(&m, 0, sizeof(m));
+    m.present = true;
+    m.reg[0x00] = 0xFF;     // IODIRA/B: all inputs
+    m.reg[0x01] = 0xFF;
+}
+
+uint8_t mcpRegister(uint8_t hwAddr, uint8_t reg) {
+    if (hwAddr >= MCP_MAX || reg >= MCP_REGS) return 0;
+    const Mcp& m = mcp[hwAddr];
+    if (reg == 0x12 || reg == 0x13) {
+        uint8_t port = reg - 0x12;
+        uint8_t dir = m.reg[0x00 + port];
+        uint8_t in = (uint8_t)(m.inputs >> (8 * port));
+        return (m.reg[0x14 + port] & ~dir) | (in & dir);
+    }
+    return m.reg[reg];
+}
+
+void setMcpInputs(uint8_t hwAddr, uint16_t levels) {
+    if (hwAddr < MCP_MAX) mcp[hwAddr].inputs = levels;
+}
+
+// One chip-select frame: opcode, register, then data bytes at sequential registers
+static void transact(const uint8_t* tx, uint8_t* rx, uint8_t len) {
+    memset(rx, 0, len);
+    if (len < 2 || (tx[0] & 0xF0) != 0x40) return;
+    uint8_t addr = (tx[0] >> 1) & 0x07;
+    bool read = tx[0] & 0x01;
+    Mcp& m = mcp[addr];
+    if (!m.present) return;
+    uint8_t reg = tx[1];
+    for (uint8_t i = 2; i < len && reg < MCP_REGS; i++, reg++) {
+        if (read) {
+            rx[i] = mcpRegister(addr, reg);
+        } else {
+            // A GPIO write lands in the output latch
+            m.reg[(reg == 0x12 || reg == 0x13) ? reg + 2 : reg] = tx[i];
+        }
+    }
+}
+
+uint32_t runSpiBus() {
+    if (!busTask) return 0;
+    uint32_t before = SpiBus::instance().getTransactionCount();
+    busTask(busArg);
+    return SpiBus::instance().getTransactionCount() - before;
+}
+
+void resetSpiBus() {
+    memset(mcp, 0, sizeof(mcp));
+}
+
+}  // namespace host
+
+// ---- SpiBus ----
+
+SpiBus& SpiBus::instance() {
+    static SpiBus inst;
+    return inst;
+}
+
+bool SpiBus::begin(uint8_t, uint8_t, uint8_t) {
+    if (_task) return true;
+    _urgentQueue = xQueueCreate(URGENT_QUEUE_LEN, sizeof(Request));
+    _normalQueue = xQueueCreate(NORMAL_QUEUE_LEN, sizeof(Request));
+    _task = (TaskHandle_t)this;     // Running: host::runSpiBus() is the task
+    host::busTask = busTask;
+    host::busArg = this;
+    return true;
+}
+
+uint8_t SpiBus::addDevice(uint8_t, uint32_t, uint8_t) {
+    if (!_task || _deviceCount >= MAX_DEVICES) return INVALID_DEVICE;
+    _dev[_deviceCount] = nullptr;
+    return _deviceCount++;
+}
+
+bool SpiBus::enqueue(Request& r) {
+    if (!_task || r.dev >= _deviceCount) {
+        _dropped++;
+        return false;
+    }
+    r.queuedUs = esp_timer_get_time();
+    if (r.future) {
+        r.future->_done = false;
+        r.future->_queued = true;
+    }
+    QueueHandle_t q = (r.prio == PRIO_URGENT) ? _urgentQueue : _normalQueue;
+    if (xQueueSend(q, &r, 0) != pdTRUE) {
+        if (r.future) r.future->_queued = false;
+        _dropped++;
+        return false;
+    }
+    return true;
+}
+
+bool SpiBus::write(uint8_t dev, const uint8_t* tx, uint8_t len, Priority prio) {
+    if (len == 0 || len > MAX_LEN) return false;
+    Request r = {};
+    r.dev = dev;
+    r.len = len;
+    r.prio = prio;
+    memcpy(r.tx, tx, len);
+    return enqueue(r);
+}
+
+bool SpiBus::writeDeferred(uint8_t dev, FillFn fill, void* arg, Priority prio, SpiFuture* done) {
+    if (!fill) return false;
+    Request r = {};
+    r.dev = dev;
+    r.prio = prio;
+    r.fill = fill;
+    r.fillArg = arg;
+    r.future = done;
+    return enqueue(r);
+}
+
+bool SpiBus::transfer(uint8_t dev, const uint8_t* tx, uint8_t len, SpiFuture& result, Priority prio) {
+    if (len == 0 || len > MAX_LEN) return false;
+    Request r = {};
+    r.dev = dev;
+    r.len = len;
+    r.prio = prio;
+    memcpy(r.tx, tx, len);
+    r.future = &result;
+    return enqueue(r);
+}
+
+bool SpiBus::burst(uint8_t dev, uint8_t steps, StepFn step, CollectFn collect, void* arg,
+                   SpiFuture& done, Priority prio) {
+    if (!step || !collect || steps == 0) return false;
+    Request r = {};
+    r.dev = dev;
+    r.len = steps;
+    r.prio = prio;
+    r.step = step;
+    r.collect = collect;
+    r.fillArg = arg;
+    r.future = &done;
+    return enqueue(r);
+}
+
+void SpiBus::serve(Request& r) {
+    if (r.step) {
+        serveBurst(r);
+        return;
+    }
+    if (r.fill) r.len = r.fill(r.fillArg, r.tx);
+    if (r.prio == PRIO_URGENT) {
+        uint32_t waitUs = (uint32_t)(esp_timer_get_time() - r.queuedUs);
+        if (waitUs > _urgentWaitMaxUs) _urgentWaitMaxUs = waitUs;
+    }
+    SpiFuture* f = r.future;
+    if (r.len > 0 && r.len <= MAX_LEN) {
+        host::transact(r.tx, _dmaRx, r.len);
+        if (f) memcpy(f->_rx, _dmaRx, r.len);
+        _transactions++;
+    }
+    if (f) f->_done = true;
+}
+
+// As on the target: a chunk of steps built, then sent and collected in order, with urgent
+// writes served between chunks
+void SpiBus::serveBurst(Request& r) {
+    uint8_t i = 0;
+    while (i < r.len) {
+        serveUrgent();
+        uint8_t queued = 0;
+        for (; i < r.len && queued < BURST_CHUNK; i++) {
+            spi_transaction_t& t = _burstTrans[queued];
+            t = {};
+            uint8_t n = r.step(r.fillArg, i, t.tx_data);
+            if (n == 0 || n > 4) continue;
+            t.length = n * 8;
+            t.user = (void*)(uintptr_t)i;
+            queued++;
+        }
+        for (uint8_t k = 0; k < queued; k++) {
+            spi_transaction_t& t = _burstTrans[k];
+            host::transact(t.tx_data, t.rx_data, (uint8_t)(t.length / 8));
+            r.collect(r.fillArg, (uint8_t)(uintptr_t)t.user, t.rx_data);
+            _transactions++;
+        }
+    }
+    r.future->_done = true;
+}
+
+void SpiBus::serveUrgent() {
+    Request u;
+    while (xQueueReceive(_urgentQueue, &u, 0) == pdTRUE) serve(u);
+}
+
+// One pass of the task loop: until both queues are empty, then return to the caller
+void SpiBus::busTask(void* param) {
+    SpiBus* self = (SpiBus*)param;
+    Request r;
+    while (xQueueReceive(self->_urgentQueue, &r, 0) == pdTRUE ||
+           xQueueReceive(self->_normalQueue, &r, 0) == pdTRUE) {
+        self->serve(r);
+    }
+}
+
+// ---- SpiFuture: a wait runs the bus, which completes everything queued ahead of it ----
+
+SpiFuture::SpiFuture() : _sem(nullptr), _queued(false), _done(false) {
+    memset(_rx, 0, sizeof(_rx));
+}
+
+SpiFuture::~SpiFuture() {
+    wait();
+}
+
+bool SpiFuture::wait() {
+    if (!_queued) return false;
+    if (!_done) host::runSpiBus();
+    _queued = false;
+    return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+// Host SPI bus for the native env: SpiBus queues as on the target, and host::runSpiBus()
+// plays the bus task. Transactions go to emulated MCP23S17s on the one shared chip select.
+
+#include <Arduino.h>
+
+namespace host {
+    // An MCP23S17 answering at this hardware address (A2..A0), registers at power-on values.
+    // Addresses are always decoded, as with IOCON.HAEN set.
+    void addMcp23s17(uint8_t hwAddr);
+    // Register as the chip holds it; GPIOA/B read back as the pins are (OLAT on outputs)
+    uint8_t mcpRegister(uint8_t hwAddr, uint8_t reg);
+    // Levels driven onto the chip's input pins, GPA0 = bit 0 ... GPB7 = bit 15
+    void setMcpInputs(uint8_t hwAddr, uint16_t levels);
+
+    // Serve everything queued, urgent first; returns the transactions put on the wire
+    uint32_t runSpiBus();
+    // Remove the chips (the SpiBus and PinExpander singletons keep their state)
+    void resetSpiBus();
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// Host stand-in: the GPIO output set/clear registers, as ids host::regWrite() decodes
+
+#include <Arduino.h>
+
+#define GPIO_OUT_W1TS_REG   host::REG_OUT_W1TS
+#define GPIO_OUT_W1TC_REG   host::REG_OUT_W1TC
+#define GPIO_OUT1_W1TS_REG  host::REG_OUT1_W1TS
+#define GPIO_OUT1_W1TC_REG  host::REG_OUT1_W1TC
@@ -0,0 +1,7 @@
+#pragma once
+
+// Host stand-in: register writes go to the emulated GPIO output registers (soc/gpio_reg.h)
+
+#include <Arduino.h>
+
+#define REG_WRITE(reg, val) host::regWrite((reg), (val))
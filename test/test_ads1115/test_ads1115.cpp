@@ -0,0 +1,298 @@
+// ADS1115Reader sampling plans on the real I2cBus task, played on the virtual clock against
+// two emulated ADS1115s on the host Wire: most-overdue channel scheduling, the seqlock sample
+// publish under a reader the bus task preempts, and bus recovery (a NAKing device, a slave
+// holding SDA).
+//
+//   pio test -e native -f test_ads1115
+
+#include <unity.h>
+#include <chrono>
+#include <signal.h>
+#include <sys/time.h>
+#include "ADS1115Reader.h"
+#include "I2cBus.h"
+#include "host_i2cbus.h"
+
+static const uint8_t SDA_PIN = 0;
+static const uint8_t SCL_PIN = 42;
+static const uint32_t CONV_US = 1000000 / 860 + 1;     // Nominal 860 SPS conversion
+static ADS1115Reader ads48, ads49;
+
+static int16_t inputCode(uint8_t addr, uint8_t ch) { return (int16_t)((addr - 0x48) * 4000 + (ch + 1) * 1000); }
+
+// Started once, as at boot: both devices probed through Wire before the task owns it
+void setUp() {
+    static bool started = false;
+    if (started) return;
+    started = true;
+    for (uint8_t addr = 0x48; addr <= 0x49; addr++) {
+        host::addAds1115(addr);
+        for (uint8_t ch = 0; ch < 4; ch++) host::setAdsInput(addr, ch, inputCode(addr, ch));
+    }
+    TEST_ASSERT_TRUE(I2cBus::instance().begin(SDA_PIN, SCL_PIN));
+    TEST_ASSERT_TRUE(ads48.begin(0x48, GAIN_ONE, RATE_ADS1115_860SPS));
+    TEST_ASSERT_TRUE(ads49.begin(0x49, GAIN_TWOTHIRDS, RATE_ADS1115_860SPS));
+    TEST_ASSERT_TRUE(I2cBus::instance().addDevice(&ads48));
+    TEST_ASSERT_TRUE(I2cBus::instance().addDevice(&ads49));
+    TEST_ASSERT_TRUE(I2cBus::instance().start());
+}
+
+void tearDown() {}
+
+// Every sample each device publishes while the task runs, per channel
+struct Seen {
+    int64_t lastUs[2][4];
+    int64_t firstUs[2][4];
+    uint32_t count[2][4];
+    uint32_t wrongValue;
+};
+
+static void observe(Seen& seen) {
+    ADS1115Reader* dev[2] = { &ads48, &ads49 };
+    for (uint8_t d = 0; d < 2; d++) {
+        for (uint8_t ch = 0; ch < 4; ch++) {
+            ADS1115Reader::Sample s;
+            if (!dev[d]->getSample(ch, s) || s.timeUs == seen.lastUs[d][ch]) continue;
+            if (s.raw != inputCode(0x48 + d, ch)) seen.wrongValue++;
+            if (!seen.count[d][ch]++) seen.firstUs[d][ch] = s.timeUs;
+            seen.lastUs[d][ch] = s.timeUs;
+        }
+    }
+}
+
+// Samples already published are not new
+static void resetSeen(Seen& seen) {
+    memset(&seen, 0, sizeof(seen));
+    ADS1115Reader* dev[2] = { &ads48, &ads49 };
+    for (uint8_t d = 0; d < 2; d++) {
+        for (uint8_t ch = 0; ch < 4; ch++) {
+            ADS1115Reader::Sample s;
+            if (dev[d]->getSample(ch, s)) seen.lastUs[d][ch] = s.timeUs;
+        }
+    }
+}
+
+// Play the bus task, looking at the published samples after every 1 ms tick
+static void runBus(uint32_t ms, Seen& seen) {
+    for (uint32_t i = 0; i < ms; i++) {
+        TEST_ASSERT_TRUE(host::runTask("i2c_bus", host::nowUs + 1000));
+        observe(seen);
+    }
+}
+
+static float meanIntervalMs(const Seen& seen, uint8_t d, uint8_t ch) {
+    if (seen.count[d][ch] < 2) return 0.0f;
+    return (seen.lastUs[d][ch] - seen.firstUs[d][ch]) / 1000.0f / (seen.count[d][ch] - 1);
+}
+
+// Period-0 channels share the bus evenly and the planned ones come round once per period; no
+// result is read before its conversion time, and each lands on its own channel
+static void test_sampling_plan() {
+    // Joins the rotation on the first read, which is 0 until a sample lands
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, ads48.readMillivolts(0));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, ads48.readMillivolts(1));
+    ads48.setSamplePeriodMs(2, 50);
+    ads48.setSamplePeriodMs(3, 500);
+    ads49.readMillivolts(0);
+    ads49.readMillivolts(1);
+
+    Seen seen;
+    resetSeen(seen);
+    host::clearI2cLog();
+    runBus(2000, seen);
+
+    char line[200];
+    snprintf(line, sizeof(line), "0x48 mean interval: ch0 %.2f ms, ch1 %.2f ms, ch2 %.1f ms, ch3 %.1f ms; "
+             "0x49: ch0 %.2f ms, ch1 %.2f ms",
+             meanIntervalMs(seen, 0, 0), meanIntervalMs(seen, 0, 1), meanIntervalMs(seen, 0, 2),
+             meanIntervalMs(seen, 0, 3), meanIntervalMs(seen, 1, 0), meanIntervalMs(seen, 1, 1));
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(0, seen.wrongValue);
+    TEST_ASSERT_EQUAL_UINT32(0, ads48.getErrorCount() + ads49.getErrorCount());
+    // A conversion is collected on the second 1 ms poll after its start, so each takes 2 ms of
+    // the device's rotation: two period-0 channels every 4 ms, plus the planned ones' turns,
+    // each of which comes round within a rotation of its period
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 4.1f, meanIntervalMs(seen, 0, 0));
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 4.1f, meanIntervalMs(seen, 0, 1));
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, 54.0f, meanIntervalMs(seen, 0, 2));
+    TEST_ASSERT_FLOAT_WITHIN(3.0f, 504.0f, meanIntervalMs(seen, 0, 3));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 4.0f, meanIntervalMs(seen, 1, 0));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 4.0f, meanIntervalMs(seen, 1, 1));
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 1000.0f * inputCode(0x48, 1) * 4.096f / 32768.0f, ads48.readMillivolts(1));
+
+    // Each result read a full conversion after its start, and from the channel just started
+    int64_t startUs[2] = { -1, -1 };
+    uint8_t startCh[2] = { 0, 0 };
+    for (const host::I2cOp& op : host::i2cLog()) {
+        uint8_t d = op.addr - 0x48;
+        if (op.type == host::I2C_START) {
+            startUs[d] = op.timeUs;
+            startCh[d] = op.ch;
+        } else if (op.type == host::I2C_READ) {
+            TEST_ASSERT_TRUE(startUs[d] >= 0);
+            TEST_ASSERT_GREATER_OR_EQUAL(CONV_US, (uint32_t)(op.timeUs - startUs[d]));
+            TEST_ASSERT_EQUAL_UINT8(startCh[d], op.ch);
+        }
+    }
+}
+
+// Samples carry their conversion's start time; a copy that pairs one publish's value with
+// another's time is torn
+static int16_t signalAt(uint8_t, uint8_t ch, int64_t startUs) {
+    return (int16_t)((startUs / 1000 * 7 + ch) % 32000);
+}
+
+// The bus task preempting a reader mid-copy: an interval timer plays one bus tick from a
+// signal handler on the reader's own thread
+static volatile sig_atomic_t inRead;
+static volatile uint32_t ticks, midReadPublishes;
+
+static void onBusTick(int) {
+    uint32_t before = ads49.getConversionCount();
+    host::runTask("i2c_bus", host::nowUs + 1000);
+    ticks++;
+    if (inRead && ads49.getConversionCount() != before) midReadPublishes++;
+}
+
+// Publishes landing between the reader's loads of the sequence count: every copy is still
+// one whole sample, and the reader sees them in order. (A host copies the 16-byte sample in
+// one load, so the tearing this guards against on the ESP32's word copies can't be provoked
+// here; what runs is the retry path with publishes really landing inside it.)
+static void test_seqlock_publish() {
+    host::adsSignal = signalAt;
+    TEST_ASSERT_TRUE(host::runTask("i2c_bus", host::nowUs + 5000));    // Conversions in flight land
+
+    struct sigaction sa = {}, old;
+    sa.sa_handler = onBusTick;
+    sigaction(SIGALRM, &sa, &old);
+    itimerval every = { { 0, 20 }, { 0, 20 } }, off = {};
+    ticks = midReadPublishes = 0;
+    setitimer(ITIMER_REAL, &every, nullptr);
+
+    uint32_t copies = 0, torn = 0, backwards = 0;
+    int64_t last[2] = { 0, 0 };
+    auto t0 = std::chrono::steady_clock::now();
+    while (midReadPublishes < 1000 && std::chrono::steady_clock::now() - t0 < std::chrono::seconds(10)) {
+        for (uint8_t ch = 0; ch < 2; ch++) {
+            ADS1115Reader::Sample s;
+            inRead = 1;
+            bool ok = ads49.getSample(ch, s);
+            inRead = 0;
+            if (!ok) continue;
+            copies++;
+            if (s.timeUs < last[ch]) backwards++;
+            if (s.raw != signalAt(0x49, ch, s.timeUs)) torn++;
+            last[ch] = s.timeUs;
+        }
+    }
+    setitimer(ITIMER_REAL, &off, nullptr);
+    sigaction(SIGALRM, &old, nullptr);
+    host::adsSignal = nullptr;
+    TEST_ASSERT_TRUE(host::runTask("i2c_bus", host::nowUs + 5000));
+
+    char line[160];
+    snprintf(line, sizeof(line), "%lu bus ticks, %lu publishes mid-read, %lu copies, %lu torn",
+             (unsigned long)ticks, (unsigned long)midReadPublishes, (unsigned long)copies, (unsigned long)torn);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_OR_EQUAL(1000, midReadPublishes);
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(0, backwards);
+}
+
+// Position of the last Wire.begin in the log, -1 if none
+static int lastWireBegin() {
+    const std::vector<host::I2cOp>& log = host::i2cLog();
+    for (int i = (int)log.size() - 1; i >= 0; i--) {
+        if (log[i].type == host::I2C_WIRE_BEGIN) return i;
+    }
+    return -1;
+}
+
+// 0x49 stops answering: after RECOVER_AFTER_ERRORS failed polls the bus is recovered, and
+// the conversion 0x48 had in flight is dropped — its next transaction starts a fresh one
+// instead of reading a result across the Wire restart. Recovery is retried no more than once
+// per backoff while the device stays gone, and it rejoins when it answers again.
+static void test_recovery_aborts_in_flight() {
+    Seen seen;
+    resetSeen(seen);
+    runBus(100, seen);
+    uint32_t recoveries = I2cBus::instance().getRecoveryCount();
+    uint32_t errors48 = ads48.getErrorCount();
+    uint32_t errors49 = ads49.getErrorCount();
+    host::clearI2cLog();
+
+    host::setI2cNak(0x49, true);
+    for (uint32_t i = 0; i < 10 && I2cBus::instance().getRecoveryCount() == recoveries; i++) runBus(1, seen);
+    TEST_ASSERT_EQUAL_UINT32(recoveries + 1, I2cBus::instance().getRecoveryCount());
+    TEST_ASSERT_EQUAL_UINT32(I2cBus::RECOVER_AFTER_ERRORS, ads49.getErrorCount() - errors49);
+    int64_t recoveredUs = host::nowUs;
+
+    int at = lastWireBegin();
+    TEST_ASSERT_TRUE(at > 0);
+    const std::vector<host::I2cOp>& log = host::i2cLog();
+    int before = -1, after = -1;
+    for (int i = at - 1; i >= 0 && before < 0; i--) {
+        if (log[i].addr == 0x48) before = i;
+    }
+    runBus(5, seen);
+    for (int i = at + 1; i < (int)host::i2cLog().size() && after < 0; i++) {
+        if (host::i2cLog()[i].addr == 0x48) after = i;
+    }
+    TEST_ASSERT_TRUE(before >= 0 && after >= 0);
+    TEST_ASSERT_EQUAL_UINT8(host::I2C_START, host::i2cLog()[before].type);   // In flight
+    TEST_ASSERT_EQUAL_UINT8(host::I2C_START, host::i2cLog()[after].type);    // Not read
+
+    // Still gone: the next recovery waits out the backoff
+    while (I2cBus::instance().getRecoveryCount() == recoveries + 1) runBus(1, seen);
+    TEST_ASSERT_GREATER_OR_EQUAL(I2cBus::RECOVER_BACKOFF_MS * 1000, (uint32_t)(host::nowUs - recoveredUs));
+
+    host::setI2cNak(0x49, false);
+    uint32_t published = ads49.getConversionCount();
+    runBus(100, seen);
+    TEST_ASSERT_GREATER_THAN(published, ads49.getConversionCount());
+    TEST_ASSERT_EQUAL_UINT8(0, ads49.getErrorRun());
+    TEST_ASSERT_EQUAL_UINT32(errors48, ads48.getErrorCount());
+    TEST_ASSERT_EQUAL_UINT32(0, seen.wrongValue);
+}
+
+static uint8_t sclClocks;
+static void countScl(uint8_t pin, uint8_t val) {
+    if (pin == SCL_PIN && val == LOW) sclClocks++;
+}
+
+// A slave stuck mid-byte holds SDA: every transaction times out until the recovery clocks SCL
+// enough for it to let go, then both devices sample again
+static void test_recovery_clocks_sda_free() {
+    Seen seen;
+    resetSeen(seen);
+    runBus(I2cBus::RECOVER_BACKOFF_MS, seen);     // Past the last recovery's backoff
+    uint32_t recoveries = I2cBus::instance().getRecoveryCount();
+    host::pinWatch = countScl;
+    sclClocks = 0;
+
+    host::holdSda(5);
+    TEST_ASSERT_EQUAL_UINT8(LOW, digitalRead(SDA_PIN));
+    for (uint32_t i = 0; i < 50 && I2cBus::instance().getRecoveryCount() == recoveries; i++) runBus(1, seen);
+    TEST_ASSERT_EQUAL_UINT32(recoveries + 1, I2cBus::instance().getRecoveryCount());
+    TEST_ASSERT_EQUAL_UINT8(HIGH, digitalRead(SDA_PIN));
+    // Clocked only until the slave let go
+    TEST_ASSERT_EQUAL_UINT8(5, sclClocks);
+
+    uint32_t published[2] = { ads48.getConversionCount(), ads49.getConversionCount() };
+    runBus(100, seen);
+    host::pinWatch = nullptr;
+    TEST_ASSERT_GREATER_THAN(published[0], ads48.getConversionCount());
+    TEST_ASSERT_GREATER_THAN(published[1], ads49.getConversionCount());
+    TEST_ASSERT_EQUAL_UINT8(0, ads48.getErrorRun());
+    TEST_ASSERT_EQUAL_UINT8(0, ads49.getErrorRun());
+    TEST_ASSERT_EQUAL_UINT32(0, seen.wrongValue);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sampling_plan);
+    RUN_TEST(test_seqlock_publish);
+    RUN_TEST(test_recovery_aborts_in_flight);
+    RUN_TEST(test_recovery_clocks_sda_free);
+    return UNITY_END();
+}
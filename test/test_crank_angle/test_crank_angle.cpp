@@ -0,0 +1,228 @@
+// CrankAngle fixed point and the integer EventPlan against the float/fmodf maths they
+// replaced: wrap rules, per-tooth event selection and offsets, and the cost per tooth.
+//
+//   pio test -e native -f test_crank_angle
+
+#include <unity.h>
+#include <chrono>
+#include "CrankAngle.h"
+#include "EventPlan.h"
+#include "EventScheduler.h"
+
+static const uint16_t CYCLE = CrankAngle::UNITS_PER_CYCLE;
+static const uint16_t REV = CrankAngle::UNITS_PER_REV;
+
+void setUp() {}
+void tearDown() {}
+
+static void test_wrap_and_degrees() {
+    TEST_ASSERT_EQUAL_UINT16(0, CrankAngle::wrap(0).units);
+    TEST_ASSERT_EQUAL_UINT16(0, CrankAngle::wrap(CYCLE).units);
+    TEST_ASSERT_EQUAL_UINT16(CYCLE - 1, CrankAngle::wrap(-1).units);
+    TEST_ASSERT_EQUAL_UINT16(5, CrankAngle::wrap(3 * CYCLE + 5).units);
+    TEST_ASSERT_EQUAL_UINT16(REV - 32, CrankAngle::wrap(-32, REV).units);
+    TEST_ASSERT_EQUAL_UINT16(REV - 32, CrankAngle::wrap(-32 - 5 * REV, REV).units);
+
+    // Degrees round to the nearest unit on both sides of zero
+    TEST_ASSERT_EQUAL_UINT16(10 * 32, CrankAngle::fromDeg(10.0f).units);
+    TEST_ASSERT_EQUAL_UINT16(710 * 32, CrankAngle::fromDeg(-10.0f).units);
+    TEST_ASSERT_EQUAL_UINT16(350 * 32, CrankAngle::fromDeg(-10.0f, REV).units);
+    TEST_ASSERT_EQUAL_UINT16(10 * 32, CrankAngle::fromDeg(730.0f).units);
+    TEST_ASSERT_EQUAL_UINT16(330, CrankAngle::fromDeg(10.3f).units);             // 329.6
+    TEST_ASSERT_EQUAL_UINT16(CYCLE - 330, CrankAngle::fromDeg(-10.3f).units);
+    TEST_ASSERT_EQUAL_UINT16(0, CrankAngle::fromDeg(719.99f).units);             // Rounds up onto the wrap
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 10.3125f, CrankAngle(330).toDeg());
+}
+
+// Every add/subtract against a plain modulo, for both cycle lengths
+static void test_add_sub_match_modulo() {
+    const uint16_t cycles[] = { REV, CYCLE };
+    for (uint16_t cycle : cycles) {
+        for (uint32_t a = 0; a < cycle; a += 97) {
+            for (uint32_t b = 0; b < cycle; b += 89) {
+                CrankAngle x((uint16_t)a), y((uint16_t)b);
+                TEST_ASSERT_EQUAL_UINT16((a + b) % cycle, x.addIn(y, cycle).units);
+                TEST_ASSERT_EQUAL_UINT16((a + cycle - b) % cycle, x.subIn(y, cycle).units);
+            }
+        }
+    }
+    CrankAngle a(CYCLE - 10), b(20);
+    TEST_ASSERT_EQUAL_UINT16(10, (a + b).units);
+    TEST_ASSERT_EQUAL_UINT16(30, (b - a).units);
+    TEST_ASSERT_TRUE(b < a);
+}
+
+// Q12 us-per-unit travel time against the exact value, 100-8000 rpm, up to 90 deg ahead
+static void test_travel_us_rounding() {
+    for (uint16_t rpm = 100; rpm <= 8000; rpm += 100) {
+        double usPerUnit = 1.0 / (rpm * 6.0e-6 * CrankAngle::UNITS_PER_DEG);
+        uint32_t q = (uint32_t)(usPerUnit * (1u << CrankAngle::RATE_SHIFT) + 0.5);
+        for (uint16_t u = 0; u <= 90 * CrankAngle::UNITS_PER_DEG; u += 7) {
+            double exact = u * usPerUnit;
+            // Q12 rate error (half an LSB per unit) plus the final rounding
+            double bound = 0.5 + u * 0.5 / (1u << CrankAngle::RATE_SHIFT);
+            TEST_ASSERT_FLOAT_WITHIN(bound, exact, (double)CrankAngle(u).travelUs(q));
+        }
+    }
+}
+
+// Event layout shared by the plan checks: 8 cylinders, spark and dwell start per cylinder
+static const uint8_t CYL = 8;
+static const uint8_t TAG_DWELL = 0x80;
+static const float ADVANCE_DEG = 10.3f;
+static const float DWELL_DEG = 47.7f;
+
+static TriggerDecoder::Geometry wheel36_1() {
+    TriggerDecoder* d = TriggerDecoder::create(TRIG_MISSING_TOOTH, 36, 1);
+    TriggerDecoder::Geometry geo = d->geometry();
+    delete d;
+    return geo;
+}
+
+static void buildPlan(EventPlan& plan, bool sequential) {
+    int32_t interval = CYCLE / CYL;
+    int32_t advance = CrankAngle::fromDeg(ADVANCE_DEG).units;
+    int32_t dwell = CrankAngle::fromDeg(DWELL_DEG).units;
+    plan.clear(sequential);
+    for (uint8_t i = 0; i < CYL; i++) {
+        plan.add(i, i * interval - advance);
+        plan.add(i | TAG_DWELL, i * interval - advance - dwell);
+    }
+    plan.build();
+}
+
+// The plan's entries for every tooth slot against the per-cylinder float + fmodf selection
+static void test_plan_matches_float_reference() {
+    TriggerDecoder::Geometry geo = wheel36_1();
+    EventPlan plan;
+    plan.setGeometry(geo, 2 * CYL);
+    float lookaheadDeg = plan.getLookahead().toDeg();
+
+    for (uint8_t mode = 0; mode < 2; mode++) {
+        bool sequential = mode == 1;
+        float cycleDeg = sequential ? 720.0f : 360.0f;
+        buildPlan(plan, sequential);
+        TEST_ASSERT_EQUAL_UINT32(0, plan.getOverflowCount());
+        uint16_t slots = sequential ? 2 * geo.teeth : geo.teeth;
+        uint32_t compared = 0;
+
+        for (uint16_t s = 0; s < slots; s++) {
+            uint16_t pos = s % geo.teeth;
+            float toothDeg = fmodf(pos * geo.degPerTooth - geo.tdcOffsetDeg + 360.0f, 360.0f) + (s >= geo.teeth ? 360.0f : 0.0f);
+            uint8_t count;
+            const EventPlan::Entry* e = plan.entries(s, count);
+
+            for (uint8_t i = 0; i < CYL; i++) {
+                float spark = fmodf(i * (720.0f / CYL) - ADVANCE_DEG + 720.0f, 720.0f);
+                if (!sequential) spark = fmodf(spark, 360.0f);
+                float dwell = spark - DWELL_DEG;
+                if (dwell < 0) dwell += cycleDeg;
+                const float angles[] = { spark, dwell };
+                for (uint8_t k = 0; k < 2; k++) {
+                    float ahead = fmodf(angles[k] - toothDeg + cycleDeg, cycleDeg);
+                    uint8_t tag = i | (k ? TAG_DWELL : 0);
+                    const EventPlan::Entry* hit = nullptr;
+                    for (uint8_t j = 0; j < count; j++) if (e[j].tag == tag) hit = &e[j];
+                    // Within one unit of the window edge, rounding may fall either way
+                    if (fabsf(ahead - lookaheadDeg) < 1.0f / CrankAngle::UNITS_PER_DEG) continue;
+                    TEST_ASSERT_EQUAL(ahead < lookaheadDeg, hit != nullptr);
+                    if (hit) {
+                        TEST_ASSERT_FLOAT_WITHIN(1.0f / CrankAngle::UNITS_PER_DEG, ahead, hit->offset.toDeg());
+                        compared++;
+                    }
+                }
+            }
+        }
+        TEST_ASSERT_GREATER_THAN(0, compared);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static uint64_t cycles() { return __rdtsc(); }
+#else
+static uint64_t cycles() { return 0; }
+#endif
+
+// Per tooth at 3000 rpm, sequential: the old per-cylinder float + fmodf selection and
+// float angle -> time, against walking this tooth's plan entries with integer offsets
+static void test_cost_per_tooth() {
+    struct NullTimer : EventScheduler::TimerBackend {
+        int64_t nowUs() override { return 0; }
+        void armAt(int64_t) override {}
+        void disarm() override {}
+    } timer;
+    EventScheduler sched;
+    sched.begin(&timer);
+    TriggerDecoder::Geometry geo = wheel36_1();
+    EventPlan plan;
+    plan.setGeometry(geo, 2 * CYL);
+    buildPlan(plan, true);
+
+    const uint32_t ROUNDS = 20000;
+    const uint16_t slots = 2 * geo.teeth;
+    const float usPerDeg = 1.0f / (3000 * 6.0e-6f);
+    const uint32_t usPerUnitQ = (uint32_t)(usPerDeg / CrankAngle::UNITS_PER_DEG * (1u << CrankAngle::RATE_SHIFT) + 0.5f);
+    volatile float advanceDeg = ADVANCE_DEG;     // Setter-owned values the old loop re-read
+    volatile float dwellDeg = DWELL_DEG;
+    volatile float lookaheadDeg = plan.getLookahead().toDeg();
+    volatile int64_t sink = 0;
+    using namespace std::chrono;
+
+    auto t0 = steady_clock::now();
+    uint64_t c0 = cycles();
+    for (uint32_t r = 0; r < ROUNDS; r++) {
+        for (uint16_t s = 0; s < slots; s++) {
+            float toothDeg = s * geo.degPerTooth;
+            int64_t refUs = (int64_t)r * 40000 + s;
+            for (uint8_t i = 0; i < CYL; i++) {
+                float spark = fmodf(i * (720.0f / CYL) - advanceDeg, 720.0f);
+                if (spark < 0) spark += 720.0f;
+                float dwell = spark - dwellDeg;
+                if (dwell < 0) dwell += 720.0f;
+                float dwellAhead = fmodf(dwell - toothDeg + 720.0f, 720.0f);
+                if (dwellAhead < lookaheadDeg) sink = sink + refUs + (int64_t)(dwellAhead * usPerDeg);
+                float sparkAhead = fmodf(spark - toothDeg + 720.0f, 720.0f);
+                if (sparkAhead < lookaheadDeg) sink = sink + refUs + (int64_t)(sparkAhead * usPerDeg);
+            }
+        }
+    }
+    uint64_t floatCycles = cycles() - c0;
+    double floatNs = duration_cast<nanoseconds>(steady_clock::now() - t0).count();
+
+    t0 = steady_clock::now();
+    c0 = cycles();
+    for (uint32_t r = 0; r < ROUNDS; r++) {
+        for (uint16_t s = 0; s < slots; s++) {
+            sched.setAngleReference((int64_t)r * 40000 + s, CrankAngle((uint16_t)(s * REV / geo.teeth)), usPerUnitQ, CYCLE);
+            uint8_t count;
+            const EventPlan::Entry* e = plan.entries(s, count);
+            for (uint8_t k = 0; k < count; k++) sink = sink + sched.offsetToTimeUs(e[k].offset);
+        }
+    }
+    uint64_t intCycles = cycles() - c0;
+    double intNs = duration_cast<nanoseconds>(steady_clock::now() - t0).count();
+
+    c0 = cycles();
+    for (uint32_t r = 0; r < ROUNDS / 20; r++) buildPlan(plan, true);
+    uint64_t buildCycles = (cycles() - c0) / (ROUNDS / 20);
+
+    double teeth = (double)ROUNDS * slots;
+    char line[200];
+    snprintf(line, sizeof(line),
+             "per tooth, %u cylinders: float + fmodf %.1f ns (%.0f TSC cycles), integer plan walk %.1f ns (%.0f TSC cycles); "
+             "plan rebuild %llu TSC cycles",
+             CYL, floatNs / teeth, floatCycles / teeth, intNs / teeth, intCycles / teeth, (unsigned long long)buildCycles);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_NOT_EQUAL(0, sink);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_wrap_and_degrees);
+    RUN_TEST(test_add_sub_match_modulo);
+    RUN_TEST(test_travel_us_rounding);
+    RUN_TEST(test_plan_matches_float_reference);
+    RUN_TEST(test_cost_per_tooth);
+    return UNITY_END();
+}
@@ -0,0 +1,186 @@
+// EventScheduler on a virtual-time backend: dispatch order and re-arming, and the angle ->
+// timestamp error against RPM that replaced the 1 ms polling loop.
+//
+//   pio test -e native -f test_event_scheduler
+
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "EventScheduler.h"
+
+// The test owns the clock. The scheduler sees only what a hardware timer would give it.
+struct FakeTimer : EventScheduler::TimerBackend {
+    int64_t now = 0;
+    int64_t alarm = EventScheduler::NO_ALARM;
+    uint32_t arms = 0;
+    int64_t nowUs() override { return now; }
+    void armAt(int64_t whenUs) override { alarm = whenUs; arms++; }
+    void disarm() override { alarm = EventScheduler::NO_ALARM; }
+};
+
+static FakeTimer timer;
+static EventScheduler* sched;
+
+// Run the clock forward alarm by alarm, as the real-time task does when the alarm wakes it
+static void runUntil(int64_t endUs) {
+    while (timer.alarm != EventScheduler::NO_ALARM && timer.alarm <= endUs) {
+        if (timer.alarm > timer.now) timer.now = timer.alarm;
+        sched->dispatch();
+    }
+    if (endUs > timer.now) timer.now = endUs;
+}
+
+struct Fired {
+    uint8_t order[8];
+    int64_t atUs[8];
+    uint8_t count;
+};
+static Fired fired;
+
+struct Probe {
+    uint8_t id;
+};
+static Probe probes[4];
+
+static void onProbe(void* arg) {
+    Probe* p = (Probe*)arg;
+    fired.order[fired.count] = p->id;
+    fired.atUs[fired.count] = timer.now;
+    fired.count++;
+}
+
+void setUp() {
+    timer = FakeTimer();
+    memset(&fired, 0, sizeof(fired));
+    sched = new EventScheduler();
+    sched->begin(&timer);
+}
+
+void tearDown() {
+    delete sched;
+}
+
+static void test_fires_in_time_order() {
+    uint8_t id[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        probes[i].id = i;
+        id[i] = sched->allocate(onProbe, &probes[i]);
+    }
+    sched->scheduleAt(id[0], 300);
+    sched->scheduleAt(id[1], 100);
+    sched->scheduleAt(id[2], 200);
+    TEST_ASSERT_EQUAL_INT64(100, timer.alarm);     // Earliest event holds the alarm
+
+    runUntil(1000);
+    TEST_ASSERT_EQUAL_UINT8(3, fired.count);
+    TEST_ASSERT_EQUAL_UINT8(1, fired.order[0]);
+    TEST_ASSERT_EQUAL_UINT8(2, fired.order[1]);
+    TEST_ASSERT_EQUAL_UINT8(0, fired.order[2]);
+    TEST_ASSERT_EQUAL_INT64(100, fired.atUs[0]);
+    TEST_ASSERT_EQUAL_INT64(200, fired.atUs[1]);
+    TEST_ASSERT_EQUAL_INT64(300, fired.atUs[2]);
+    TEST_ASSERT_EQUAL_INT64(EventScheduler::NO_ALARM, timer.alarm);
+    TEST_ASSERT_EQUAL_UINT32(0, sched->getMaxLatencyUs());
+}
+
+static void test_reschedule_and_cancel() {
+    probes[0].id = 0;
+    probes[1].id = 1;
+    uint8_t a = sched->allocate(onProbe, &probes[0]);
+    uint8_t b = sched->allocate(onProbe, &probes[1]);
+    sched->scheduleAt(a, 100);
+    sched->scheduleAt(b, 150);
+    sched->scheduleAt(a, 400);      // Later: the 100 us alarm stays until the next dispatch
+    sched->cancel(b);
+    runUntil(1000);
+    TEST_ASSERT_EQUAL_UINT8(1, fired.count);
+    TEST_ASSERT_EQUAL_UINT8(0, fired.order[0]);
+    TEST_ASSERT_EQUAL_INT64(400, fired.atUs[0]);
+
+    sched->scheduleAt(a, 1200);
+    sched->cancelAll();
+    TEST_ASSERT_EQUAL_INT64(EventScheduler::NO_ALARM, timer.alarm);
+    runUntil(2000);
+    TEST_ASSERT_EQUAL_UINT8(1, fired.count);
+}
+
+// Injector pattern: the open callback arms the close from its own fire time
+static uint8_t closeId;
+static void onOpenProbe(void* arg) {
+    onProbe(arg);
+    sched->scheduleAt(closeId, timer.now + 2500);
+}
+
+static void test_callback_arms_follow_up() {
+    probes[0].id = 0;
+    probes[1].id = 1;
+    uint8_t open = sched->allocate(onOpenProbe, &probes[0]);
+    closeId = sched->allocate(onProbe, &probes[1]);
+    sched->scheduleAt(open, 1000);
+    runUntil(10000);
+    TEST_ASSERT_EQUAL_UINT8(2, fired.count);
+    TEST_ASSERT_EQUAL_INT64(1000, fired.atUs[0]);
+    TEST_ASSERT_EQUAL_INT64(3500, fired.atUs[1]);
+}
+
+static void test_due_events_run_late_with_latency() {
+    probes[0].id = 0;
+    uint8_t a = sched->allocate(onProbe, &probes[0]);
+    sched->scheduleAt(a, 100);
+    timer.now = 137;                // Task woke late
+    sched->dispatch();
+    TEST_ASSERT_EQUAL_UINT8(1, fired.count);
+    TEST_ASSERT_EQUAL_UINT32(37, sched->getLastLatencyUs());
+}
+
+// Angle -> time against RPM. The reference is a 36-1 tooth crossed exactly on an integer
+// microsecond; each target angle is converted by the scheduler and compared with the time
+// the crank truly reaches it at constant speed. Error is reported in crank degrees.
+static void test_angle_error_vs_rpm() {
+    static const uint16_t rpms[] = { 150, 300, 800, 1500, 3000, 6000, 8000 };
+    const uint8_t teeth = 36;
+    const double boundDeg = 0.05;
+    char line[160];
+
+    for (uint8_t r = 0; r < sizeof(rpms) / sizeof(rpms[0]); r++) {
+        double degPerUs = rpms[r] * 6.0e-6;
+        double usPerUnit = 1.0 / (degPerUs * CrankAngle::UNITS_PER_DEG);
+        uint32_t usPerUnitQ = (uint32_t)(usPerUnit * (1u << CrankAngle::RATE_SHIFT) + 0.5);
+        double worst = 0.0;
+
+        const uint16_t cycles[] = { CrankAngle::UNITS_PER_REV, CrankAngle::UNITS_PER_CYCLE };
+        for (uint16_t cycle : cycles) {
+            uint16_t toothCount = cycle == CrankAngle::UNITS_PER_CYCLE ? 2 * teeth : teeth;
+            for (uint16_t tooth = 0; tooth < toothCount; tooth++) {
+                CrankAngle refAngle((uint16_t)((uint32_t)tooth * CrankAngle::UNITS_PER_REV / teeth));
+                int64_t refUs = 1000000 + tooth * 7;
+                sched->setAngleReference(refUs, refAngle, usPerUnitQ, cycle);
+                // Targets anywhere in the next 90 deg, as wide as the injection lookahead gets
+                for (uint16_t off = 0; off < 90 * CrankAngle::UNITS_PER_DEG; off += 37) {
+                    CrankAngle target = refAngle.addIn(CrankAngle(off), cycle);
+                    int64_t at = sched->angleToTimeUs(target);
+                    double trueUs = refUs + off / (double)CrankAngle::UNITS_PER_DEG / degPerUs;
+                    double errDeg = fabs((at - trueUs) * degPerUs);
+                    if (errDeg > worst) worst = errDeg;
+                    TEST_ASSERT_EQUAL_INT64(at, sched->offsetToTimeUs(CrankAngle(off)));
+                }
+            }
+        }
+        // What the old loop could be off by: a whole 1 ms vTaskDelay tick
+        snprintf(line, sizeof(line), "%5u rpm: scheduler max %.4f deg (1 ms polling: up to %.1f deg)",
+                 rpms[r], worst, 1000.0 * degPerUs);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_LESS_THAN_FLOAT(boundDeg, worst);
+    }
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fires_in_time_order);
+    RUN_TEST(test_reschedule_and_cancel);
+    RUN_TEST(test_callback_arms_follow_up);
+    RUN_TEST(test_due_events_run_late_with_latency);
+    RUN_TEST(test_angle_error_vs_rpm);
+    return UNITY_END();
+}
@@ -0,0 +1,215 @@
+// Coil overdwell cutoff: each dwell start arms that coil's own overdwell event at the measured
+// dwell start plus the maximum dwell. Driven through a CrankSensor on 36-1 and a real-time
+// task loop on the host's virtual clock; coil on-time is taken from the coil pin edges.
+//
+//   pio test -e native -f test_ignition
+
+#include <unity.h>
+#include "IgnitionManager.h"
+#include "EventScheduler.h"
+
+static const uint8_t CRANK_PIN = 4;
+static const uint8_t TEETH = 36;
+static const uint8_t CYL = 8;
+static const uint16_t COIL_PINS[CYL] = { 10, 11, 12, 13, 14, 15, 16, 17 };
+static const uint8_t FIRING[CYL] = { 1, 8, 4, 3, 6, 5, 7, 2 };
+static const uint16_t RPM = 3000;
+static const float DWELL_MS = 3.5f;
+static const float MAX_DWELL_MS = 4.0f;
+static const uint32_t MAX_DWELL_US = 4000;
+static const uint32_t TASK_TIMEOUT_US = 1000;   // Real-time task notify timeout while running
+// The cutoff is the task's wake latency on the overdwell alarm (8-32 us here)
+static const uint32_t CUTOFF_BOUND_US = 40;
+static const uint8_t NO_CYL = 0xFF;
+
+// IgnitionManager::begin allocates overdwell, dwell, spark per coil, in cylinder order, and
+// this test's scheduler has no other users
+static uint8_t overdwellSlot(uint8_t cyl) { return cyl * 3; }
+static uint8_t sparkSlot(uint8_t cyl) { return cyl * 3 + 2; }
+
+// Scheduler alarm on the virtual clock: the test loop wakes the task when it is due
+struct VirtualTimer : EventScheduler::TimerBackend {
+    int64_t alarmUs = EventScheduler::NO_ALARM;
+    int64_t nowUs() override { return host::nowUs; }
+    void armAt(int64_t whenUs) override { alarmUs = whenUs; }
+    void disarm() override { alarmUs = EventScheduler::NO_ALARM; }
+};
+
+// Coil on-time per cylinder, from its pin edges
+struct CoilWatch {
+    int64_t onAt[CYL];
+    uint32_t sparks;
+    uint32_t minOnUs;
+    uint32_t maxOnUs;
+    uint8_t lostCyl;            // Its spark events are dropped from the first dwell after lostFromUs
+    int64_t lostFromUs;
+    int64_t lostOnAt;           // That dwell's start and the coil's release
+    int64_t lostOffAt;
+};
+static CoilWatch watch;
+
+static int8_t coilIndex(uint8_t pin) {
+    for (uint8_t c = 0; c < CYL; c++) {
+        if (COIL_PINS[c] == pin) return c;
+    }
+    return -1;
+}
+
+static void onPinWrite(uint8_t pin, uint8_t val) {
+    int8_t c = coilIndex(pin);
+    if (c < 0) return;
+    if (val) {
+        watch.onAt[c] = host::nowUs;
+        if (c == watch.lostCyl && !watch.lostOnAt && host::nowUs >= watch.lostFromUs) watch.lostOnAt = host::nowUs;
+    } else if (watch.onAt[c]) {
+        uint32_t onUs = (uint32_t)(host::nowUs - watch.onAt[c]);
+        if (c == watch.lostCyl && watch.lostOnAt == watch.onAt[c]) {
+            watch.lostOffAt = host::nowUs;
+        } else {
+            if (onUs < watch.minOnUs) watch.minOnUs = onUs;
+            if (onUs > watch.maxOnUs) watch.maxOnUs = onUs;
+            watch.sparks++;
+        }
+        watch.onAt[c] = 0;
+    }
+}
+
+static uint32_t rng;
+static uint32_t wakeLatencyUs() {
+    rng = rng * 1103515245u + 12345u;
+    return 8 + (rng >> 16) % 25;
+}
+
+// Steady RPM for durationMs, wasted spark (no cam). After each pass every coil that is not
+// charging must have no overdwell event left pending.
+static void run(IgnitionManager& ign, uint32_t durationMs, uint32_t& strayOverdwell) {
+    host::reset();
+    rng = 1;
+    strayOverdwell = 0;
+
+    CrankSensor crank;
+    crank.begin(CRANK_PIN, TRIG_MISSING_TOOTH, TEETH, 1);
+    VirtualTimer timer;
+    EventScheduler sched;
+    sched.begin(&timer);
+    ign.setScheduler(&sched);
+    ign.setTriggerGeometry(crank.getGeometry());
+    ign.setMaxDwellMs(MAX_DWELL_MS);
+    ign.setDwellMs(DWELL_MS);
+    ign.begin(CYL, COIL_PINS, FIRING);
+    TEST_ASSERT_EQUAL_UINT8(CYL, ign.getFastCoilCount());
+    host::pinWatch = onPinWrite;
+
+    const double toothUs = 60.0e6 / RPM / TEETH;
+    double nextToothUs = 100000.0;
+    uint32_t toothIdx = 0;
+    int64_t toothWakeUs = EventScheduler::NO_ALARM;
+    int64_t lastWakeUs = 0;
+    int64_t lastRefUs = 0;
+    uint32_t alarmLatency = wakeLatencyUs();
+    int64_t endUs = (int64_t)durationMs * 1000;
+
+    while (host::nowUs < endUs) {
+        int64_t alarmWakeUs = timer.alarmUs == EventScheduler::NO_ALARM
+                                  ? EventScheduler::NO_ALARM : timer.alarmUs + alarmLatency;
+        int64_t wakeUs = min(min(toothWakeUs, alarmWakeUs), lastWakeUs + (int64_t)TASK_TIMEOUT_US);
+        int64_t edgeUs = (int64_t)nextToothUs;
+        if (edgeUs <= wakeUs) {
+            host::setTime(edgeUs);
+            host::fireInterrupt(CRANK_PIN);
+            if (toothWakeUs == EventScheduler::NO_ALARM) toothWakeUs = edgeUs + wakeLatencyUs();
+            // Physical teeth: 35 then the gap
+            nextToothUs += toothUs * ((++toothIdx % (TEETH - 1)) == 0 ? 2 : 1);
+            continue;
+        }
+
+        // The real-time task body (ECU::realtimeTask)
+        host::setTime(wakeUs);
+        lastWakeUs = wakeUs;
+        bool toothBit = wakeUs >= toothWakeUs;
+        if (toothBit) toothWakeUs = EventScheduler::NO_ALARM;
+        CrankSensor::ToothReference ref;
+        uint16_t r = crank.getRpm();
+        if (r > 0 && crank.isPositionKnown() && crank.getToothReference(ref)) {
+            bool newTooth = toothBit && ref.timeUs != lastRefUs;
+            if (newTooth) {
+                lastRefUs = ref.timeUs;
+                sched.setAngleReference(ref.timeUs, ref.angle, ref.usPerUnitQ, ref.cycleUnits);
+            }
+            ign.update(r, ref, newTooth);
+        }
+        // The lost coil's spark never fires: whatever a tooth re-armed is dropped before dispatch
+        if (watch.lostOnAt && !watch.lostOffAt) sched.cancel(sparkSlot(watch.lostCyl));
+        if (alarmWakeUs <= wakeUs) alarmLatency = wakeLatencyUs();
+        sched.dispatch();
+
+        for (uint8_t c = 0; c < CYL; c++) {
+            if (host::pinLevel[COIL_PINS[c]] == LOW && sched.isPending(overdwellSlot(c))) strayOverdwell++;
+        }
+    }
+    host::pinWatch = nullptr;
+    ign.cutSpark();
+}
+
+void setUp() {
+    memset(&watch, 0, sizeof(watch));
+    watch.minOnUs = UINT32_MAX;
+    watch.lostCyl = NO_CYL;
+}
+
+void tearDown() {}
+
+// Normal running: every spark cancels its coil's overdwell event, nothing is counted, and the
+// on-time is the commanded dwell
+static void test_spark_cancels_overdwell() {
+    IgnitionManager ign;
+    uint32_t stray;
+    run(ign, 1000, stray);
+
+    char line[160];
+    snprintf(line, sizeof(line), "%lu sparks, coil on-time %lu..%lu us (dwell %u us, max %lu us)",
+             (unsigned long)watch.sparks, (unsigned long)watch.minOnUs, (unsigned long)watch.maxOnUs,
+             (unsigned)(DWELL_MS * 1000), (unsigned long)MAX_DWELL_US);
+    TEST_MESSAGE(line);
+    // One spark per coil per revolution, less the time to sync
+    TEST_ASSERT_GREATER_THAN(CYL * (RPM / 60) * 3 / 4, watch.sparks);
+    TEST_ASSERT_EQUAL_UINT32(0, stray);
+    TEST_ASSERT_EQUAL_UINT32(0, ign.getOverdwellCount());
+    TEST_ASSERT_LESS_THAN(MAX_DWELL_US, watch.maxOnUs);
+    for (uint8_t c = 0; c < CYL; c++) TEST_ASSERT_EQUAL_UINT8(LOW, host::pinLevel[COIL_PINS[c]]);
+}
+
+// One coil loses its spark event mid-run: it is released at its measured dwell start plus the
+// maximum dwell, counted once, and every other coil keeps firing normally
+static void test_lost_spark_released_at_max_dwell() {
+    const uint8_t lost = 3;
+    watch.lostCyl = lost;
+    watch.lostFromUs = 500000;
+    IgnitionManager ign;
+    uint32_t stray;
+    run(ign, 1000, stray);
+
+    TEST_ASSERT_TRUE(watch.lostOnAt > 0);
+    TEST_ASSERT_TRUE(watch.lostOffAt > 0);
+    uint32_t onUs = (uint32_t)(watch.lostOffAt - watch.lostOnAt);
+    char line[160];
+    snprintf(line, sizeof(line), "cyl %u lost its spark: released after %lu us (max dwell %lu us), counted %lu us",
+             lost, (unsigned long)onUs, (unsigned long)MAX_DWELL_US, (unsigned long)ign.getLastOverdwellUs());
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_OR_EQUAL(MAX_DWELL_US, onUs);
+    TEST_ASSERT_LESS_OR_EQUAL(MAX_DWELL_US + CUTOFF_BOUND_US, onUs);
+
+    TEST_ASSERT_EQUAL_UINT32(1, ign.getOverdwellCount());
+    TEST_ASSERT_EQUAL_UINT8(lost, ign.getLastOverdwellCyl());
+    TEST_ASSERT_EQUAL_UINT32(onUs, ign.getLastOverdwellUs());
+    TEST_ASSERT_EQUAL_UINT32(0, stray);
+    TEST_ASSERT_LESS_THAN(MAX_DWELL_US, watch.maxOnUs);
+    for (uint8_t c = 0; c < CYL; c++) TEST_ASSERT_EQUAL_UINT8(LOW, host::pinLevel[COIL_PINS[c]]);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_spark_cancels_overdwell);
+    RUN_TEST(test_lost_spark_released_at_max_dwell);
+    return UNITY_END();
+}
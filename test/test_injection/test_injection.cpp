@@ -0,0 +1,160 @@
+// Injector pulse width: opens from the per-tooth event plan and each close from its own
+// EventScheduler event, through a CrankSensor on 36-1 and a real-time task loop on the
+// host's virtual clock. Delivered width is taken from the injector pin edges and from
+// InjectionManager's own telemetry (injPwErrMaxUs).
+//
+//   pio test -e native -f test_injection
+
+#include <unity.h>
+#include "InjectionManager.h"
+#include "EventScheduler.h"
+
+static const uint8_t CRANK_PIN = 4;
+static const uint8_t TEETH = 36;
+static const uint8_t CYL = 8;
+static const uint16_t INJ_PINS[CYL] = { 10, 11, 12, 13, 14, 15, 16, 17 };
+static const uint8_t FIRING[CYL] = { 1, 8, 4, 3, 6, 5, 7, 2 };
+static const uint32_t TASK_TIMEOUT_US = 1000;   // Real-time task notify timeout while running
+// The close is timed from the measured open, so the error is the task's wake latency on
+// the close alarm (8-32 us here) — against up to the 1 ms timeout for the old polled close
+static const uint32_t PW_BOUND_US = 40;
+
+// Scheduler alarm on the virtual clock: the test loop wakes the task when it is due
+struct VirtualTimer : EventScheduler::TimerBackend {
+    int64_t alarmUs = EventScheduler::NO_ALARM;
+    int64_t nowUs() override { return host::nowUs; }
+    void armAt(int64_t whenUs) override { alarmUs = whenUs; }
+    void disarm() override { alarmUs = EventScheduler::NO_ALARM; }
+};
+
+// Delivered pulse per injector, from its pin edges
+struct PinPulses {
+    int64_t openAt[64];
+    uint32_t pulses;
+    uint32_t maxErrUs;
+    uint32_t commandedUs;
+};
+static PinPulses watch;
+
+static void onPinWrite(uint8_t pin, uint8_t val) {
+    if (val) {
+        watch.openAt[pin] = host::nowUs;
+    } else if (watch.openAt[pin]) {
+        int64_t err = host::nowUs - watch.openAt[pin] - (int64_t)watch.commandedUs;
+        uint32_t mag = (uint32_t)(err < 0 ? -err : err);
+        if (mag > watch.maxErrUs) watch.maxErrUs = mag;
+        watch.pulses++;
+        watch.openAt[pin] = 0;
+    }
+}
+
+struct Run {
+    uint32_t pulses;
+    uint32_t pinMaxErrUs;
+    uint32_t telemetryMaxErrUs;
+    uint32_t lateCloses;
+};
+
+static uint32_t rng;
+static uint32_t wakeLatencyUs() {
+    rng = rng * 1103515245u + 12345u;
+    return 8 + (rng >> 16) % 25;
+}
+
+// Steady speed for durationMs, batch fuel (no cam)
+static Run run(uint16_t rpm, uint32_t pulseUs, uint32_t durationMs) {
+    host::reset();
+    memset(&watch, 0, sizeof(watch));
+    rng = 1;
+
+    CrankSensor crank;
+    crank.begin(CRANK_PIN, TRIG_MISSING_TOOTH, TEETH, 1);
+    VirtualTimer timer;
+    EventScheduler sched;
+    sched.begin(&timer);
+    InjectionManager inj;
+    inj.setScheduler(&sched);
+    inj.setTriggerGeometry(crank.getGeometry());
+    inj.begin(CYL, INJ_PINS, FIRING);
+    TEST_ASSERT_EQUAL_UINT8(CYL, inj.getFastInjectorCount());
+    inj.setDeadTimeMs(0);
+    inj.setPulseWidthUs(pulseUs);
+    watch.commandedUs = pulseUs / 2;    // Batch: half the cycle's fuel every revolution
+    host::pinWatch = onPinWrite;
+
+    const double toothUs = 60.0e6 / rpm / TEETH;
+    double nextToothUs = 100000.0;
+    uint32_t toothIdx = 0;
+    int64_t toothWakeUs = EventScheduler::NO_ALARM;
+    int64_t lastWakeUs = 0;
+    int64_t lastRefUs = 0;
+    uint32_t alarmLatency = wakeLatencyUs();
+    int64_t endUs = (int64_t)durationMs * 1000;
+
+    while (host::nowUs < endUs) {
+        int64_t alarmWakeUs = timer.alarmUs == EventScheduler::NO_ALARM
+                                  ? EventScheduler::NO_ALARM : timer.alarmUs + alarmLatency;
+        int64_t wakeUs = min(min(toothWakeUs, alarmWakeUs), lastWakeUs + (int64_t)TASK_TIMEOUT_US);
+        int64_t edgeUs = (int64_t)nextToothUs;
+        if (edgeUs <= wakeUs) {
+            host::setTime(edgeUs);
+            host::fireInterrupt(CRANK_PIN);
+            if (toothWakeUs == EventScheduler::NO_ALARM) toothWakeUs = edgeUs + wakeLatencyUs();
+            // Physical teeth: 35 then the gap
+            nextToothUs += toothUs * ((++toothIdx % (TEETH - 1)) == 0 ? 2 : 1);
+            continue;
+        }
+
+        // The real-time task body (ECU::realtimeTask)
+        host::setTime(wakeUs);
+        lastWakeUs = wakeUs;
+        bool toothBit = wakeUs >= toothWakeUs;
+        if (toothBit) toothWakeUs = EventScheduler::NO_ALARM;
+        CrankSensor::ToothReference ref;
+        uint16_t r = crank.getRpm();
+        if (r > 0 && crank.isPositionKnown() && crank.getToothReference(ref)) {
+            bool newTooth = toothBit && ref.timeUs != lastRefUs;
+            if (newTooth) {
+                lastRefUs = ref.timeUs;
+                sched.setAngleReference(ref.timeUs, ref.angle, ref.usPerUnitQ, ref.cycleUnits);
+            }
+            inj.update(r, ref, newTooth);
+        }
+        if (alarmWakeUs <= wakeUs) alarmLatency = wakeLatencyUs();
+        sched.dispatch();
+    }
+    host::pinWatch = nullptr;
+    inj.closeAll();
+    return Run{ watch.pulses, watch.maxErrUs, inj.getPulseMaxErrorUs(), inj.getLateCloseCount() };
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void check(uint16_t rpm, uint32_t pulseUs) {
+    Run ev = run(rpm, pulseUs, 2000);
+    char line[160];
+    snprintf(line, sizeof(line), "%u us @ %u rpm: %lu pulses, max |delivered - commanded| %lu us (telemetry %lu us)",
+             (unsigned)pulseUs / 2, rpm, (unsigned long)ev.pulses, (unsigned long)ev.pinMaxErrUs,
+             (unsigned long)ev.telemetryMaxErrUs);
+    TEST_MESSAGE(line);
+    // One open per injector per revolution over the 2 s, less the time to sync
+    TEST_ASSERT_GREATER_THAN(CYL * (rpm / 60) * 3 / 2, ev.pulses);
+    TEST_ASSERT_LESS_OR_EQUAL(PW_BOUND_US, ev.pinMaxErrUs);
+    TEST_ASSERT_LESS_OR_EQUAL(PW_BOUND_US, ev.telemetryMaxErrUs);
+    TEST_ASSERT_EQUAL_UINT32(0, ev.lateCloses);
+    for (uint8_t c = 0; c < CYL; c++) TEST_ASSERT_EQUAL_UINT8(LOW, host::pinLevel[INJ_PINS[c]]);
+}
+
+// Cycle fuel; each batch open delivers half
+static void test_pulse_800rpm() { check(800, 3000); }
+static void test_pulse_1500rpm() { check(1500, 6000); }
+static void test_pulse_4000rpm() { check(4000, 12000); }
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_pulse_800rpm);
+    RUN_TEST(test_pulse_1500rpm);
+    RUN_TEST(test_pulse_4000rpm);
+    return UNITY_END();
+}
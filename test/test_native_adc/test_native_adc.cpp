@@ -0,0 +1,179 @@
+// NativeAdc on the real DMA task, played on the virtual clock against the host ADC digital
+// controller: analogRead() fallback before start() and for ADC2 pins, 0 until a scanned pin's
+// first frame, frame means against the conversions the controller handed out, and the pattern
+// rebuilt when a pin is added to a running scan.
+//
+//   pio test -e native -f test_native_adc
+
+#include <unity.h>
+#include "NativeAdc.h"
+#include "host_adc.h"
+
+static const uint32_t FRAME_US = NativeAdc::FRAME_RESULTS * 1000000 / NativeAdc::SAMPLE_HZ;
+static const uint8_t ADC2_PIN = 11;
+// A published mean is frame mean x 16, rounded
+static const float MEAN_TOLERANCE = 1.0f / 32 + 1e-4f;
+
+static NativeAdc& adc() { return NativeAdc::instance(); }
+
+// Conversions handed out in the frame being played, per ADC1 channel
+struct Frame {
+    uint32_t sum[NativeAdc::ADC1_CHANNELS];
+    uint32_t count[NativeAdc::ADC1_CHANNELS];
+};
+static Frame frame;
+static float keptMean = -1.0f;      // Pin 1's published mean when the rebuilt scan's first conversion is taken
+
+// Each channel on its own level with a spread over the frame, so a mean is not any one sample
+static uint16_t signal(uint8_t ch, int64_t sampleUs) {
+    uint16_t v = (uint16_t)(400 * (ch + 1) + (sampleUs / 50 * 37) % 101);
+    if (keptMean < 0) keptMean = adc().readAverage(1);
+    frame.sum[ch] += v;
+    frame.count[ch]++;
+    return v;
+}
+
+// One DMA frame through the task: it lands and is published before the task sleeps again
+static void playFrame() {
+    memset(&frame, 0, sizeof(frame));
+    uint32_t frames = adc().getFrameCount();
+    TEST_ASSERT_TRUE(host::runTask("adc_dma", host::nowUs + FRAME_US));
+    TEST_ASSERT_EQUAL_UINT32(frames + 1, adc().getFrameCount());
+}
+
+// Every scanned channel publishes its frame's mean; the fewest samples behind one is reported
+static void checkMeans(const uint8_t* pins, uint8_t n) {
+    uint32_t fewest = UINT32_MAX;
+    for (uint8_t i = 0; i < n; i++) {
+        uint8_t ch = pins[i] - 1;
+        TEST_ASSERT_TRUE(frame.count[ch] > 0);
+        TEST_ASSERT_TRUE(adc().isScanned(pins[i]));
+        TEST_ASSERT_FLOAT_WITHIN(MEAN_TOLERANCE, (float)frame.sum[ch] / frame.count[ch], adc().readAverage(pins[i]));
+        if (frame.count[ch] < fewest) fewest = frame.count[ch];
+    }
+    TEST_ASSERT_EQUAL_UINT8(fewest, adc().getSamplesPerValue());
+}
+
+static void checkPattern(const uint8_t* pins, uint8_t n) {
+    const host::AdcScan& scan = host::adcScan();
+    TEST_ASSERT_TRUE(scan.running);
+    TEST_ASSERT_EQUAL_UINT32(n, scan.patternNum);
+    TEST_ASSERT_EQUAL_UINT32(NativeAdc::SAMPLE_HZ, scan.sampleHz);
+    TEST_ASSERT_EQUAL_UINT32(NativeAdc::FRAME_RESULTS * 4, scan.frameBytes);
+    for (uint8_t i = 0; i < n; i++) {
+        TEST_ASSERT_EQUAL_UINT8(pins[i] - 1, scan.pattern[i].channel);
+        TEST_ASSERT_EQUAL_UINT8(0, scan.pattern[i].unit);
+        TEST_ASSERT_EQUAL_UINT8(ADC_ATTEN_DB_11, scan.pattern[i].atten);
+        TEST_ASSERT_EQUAL_UINT8(12, scan.pattern[i].bit_width);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, scan.misuse);
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Not started: every pin reads through analogRead(); only ADC1 pins join the scan
+static void test_fallback_before_start() {
+    host::reset();
+    host::resetAdc();
+    for (uint8_t pin = 1; pin <= 20; pin++) host::analogLevel[pin] = 100 * pin + 7;
+
+    TEST_ASSERT_FALSE(adc().start());      // Nothing to scan
+    TEST_ASSERT_FALSE(adc().isRunning());
+    TEST_ASSERT_FALSE(adc().addPin(ADC2_PIN));
+    TEST_ASSERT_FALSE(adc().addPin(0));
+    TEST_ASSERT_FALSE(adc().addPin(40));
+    TEST_ASSERT_TRUE(adc().addPin(1));
+    TEST_ASSERT_TRUE(adc().addPin(2));
+
+    TEST_ASSERT_FALSE(adc().isScanned(1));
+    TEST_ASSERT_EQUAL_FLOAT(107.0f, adc().readAverage(1));
+    TEST_ASSERT_EQUAL_UINT16(207, adc().read(2));
+    TEST_ASSERT_EQUAL_UINT16(1107, adc().read(ADC2_PIN));
+    TEST_ASSERT_EQUAL_UINT32(0, host::adcScan().configures);
+}
+
+// Started: a scanned pin reads 0 until its first frame, never a oneshot read; ADC2 still
+// falls back
+static void test_zero_before_first_frame() {
+    TEST_ASSERT_TRUE(adc().start());
+    TEST_ASSERT_TRUE(adc().isRunning());
+    TEST_ASSERT_FALSE(adc().isScanned(1));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, adc().readAverage(1));
+    TEST_ASSERT_EQUAL_UINT16(0, adc().read(2));
+    TEST_ASSERT_EQUAL_UINT16(0, adc().read(3));        // Never added: no value while the scan runs
+    TEST_ASSERT_EQUAL_UINT16(1107, adc().read(ADC2_PIN));
+
+    playFrame();
+    const uint8_t pins[] = { 1, 2 };
+    checkPattern(pins, 2);
+    TEST_ASSERT_EQUAL_UINT32(1, host::adcScan().configures);
+    TEST_ASSERT_EQUAL_FLOAT(107.0f, adc().readAverage(1));
+    TEST_ASSERT_EQUAL_UINT16(207, adc().read(2));
+    TEST_ASSERT_EQUAL_UINT8(NativeAdc::FRAME_RESULTS / 2, adc().getSamplesPerValue());
+}
+
+// Each frame's published means are the means of the conversions in it; an unchanged pin set
+// never touches the controller
+static void test_frame_means() {
+    host::adcSignal = signal;
+    const uint8_t pins[] = { 1, 2 };
+    for (uint8_t i = 0; i < 5; i++) {
+        playFrame();
+        checkMeans(pins, 2);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, host::adcScan().configures);
+    TEST_ASSERT_EQUAL_UINT32(0, adc().getOverrunCount());
+}
+
+// A pin added while the scan runs: the pattern is rebuilt (stop, reconfigure, start) before the
+// next frame, the kept pins hold their last mean meanwhile, and the new pin reads 0 until then
+static void test_pattern_rebuilt_after_add() {
+    float before = adc().readAverage(1);
+    TEST_ASSERT_TRUE(adc().addPin(5));
+    TEST_ASSERT_FALSE(adc().isScanned(5));
+    TEST_ASSERT_EQUAL_UINT16(0, adc().read(5));
+    TEST_ASSERT_EQUAL_UINT32(2, host::adcScan().patternNum);
+
+    keptMean = -1.0f;
+    playFrame();
+    const uint8_t pins[] = { 1, 2, 5 };
+    checkPattern(pins, 3);
+    TEST_ASSERT_EQUAL_UINT32(2, host::adcScan().configures);
+    TEST_ASSERT_EQUAL_FLOAT(before, keptMean);
+    checkMeans(pins, 3);
+    TEST_ASSERT_EQUAL_UINT8(NativeAdc::FRAME_RESULTS / 3, adc().getSamplesPerValue());
+}
+
+// Seven channels, added together between frames: one rebuild to a 7-entry pattern in channel
+// order, 128 / 7 = 18 samples behind the thinnest value
+static void test_seven_channel_pattern() {
+    const uint8_t added[] = { 3, 4, 6, 7 };
+    for (uint8_t pin : added) TEST_ASSERT_TRUE(adc().addPin(pin));
+
+    const uint8_t pins[] = { 1, 2, 3, 4, 5, 6, 7 };
+    for (uint8_t i = 0; i < 3; i++) {
+        playFrame();
+        checkPattern(pins, 7);
+        checkMeans(pins, 7);
+        TEST_ASSERT_EQUAL_UINT8(18, adc().getSamplesPerValue());
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, host::adcScan().configures);
+    TEST_ASSERT_EQUAL_UINT16(1107, adc().read(ADC2_PIN));
+
+    char line[120];
+    snprintf(line, sizeof(line), "7 channels: %u samples per value, %lu frames, %lu overruns",
+             adc().getSamplesPerValue(), (unsigned long)adc().getFrameCount(),
+             (unsigned long)adc().getOverrunCount());
+    TEST_MESSAGE(line);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fallback_before_start);
+    RUN_TEST(test_zero_before_first_frame);
+    RUN_TEST(test_frame_means);
+    RUN_TEST(test_pattern_rebuilt_after_add);
+    RUN_TEST(test_seven_channel_pattern);
+    return UNITY_END();
+}
@@ -0,0 +1,206 @@
+// PinHandle against the xDigitalWrite routing it replaced, on PinExpander built for the host
+// with the emulated MCP23S17s behind SpiBus: attach resolution, the same levels on the
+// chips and native pins either way, and the cost of a write.
+//
+//   pio test -e native -f test_pin_handle
+
+#include <unity.h>
+#include <chrono>
+#include "PinExpander.h"
+#include "host_spibus.h"
+
+static const uint8_t CS_PIN = 10;
+static const uint8_t PRESENT = 2;       // Expanders #0 and #1 on the bus, #2-#5 not fitted
+static const uint16_t EXP0 = SPI_EXP_PIN_OFFSET;
+static const uint16_t EXP1 = SPI_EXP_PIN_OFFSET + SPI_EXP_PIN_COUNT;
+static const uint16_t EXP2 = SPI_EXP_PIN_OFFSET + 2 * SPI_EXP_PIN_COUNT;
+
+static PinExpander& expander() { return PinExpander::instance(); }
+
+static uint16_t olat(uint8_t hwAddr) {
+    return (uint16_t)host::mcpRegister(hwAddr, MCP_OLATB) << 8 | host::mcpRegister(hwAddr, MCP_OLATA);
+}
+
+// Probed once, as at boot: the absent devices log their warning here and stay not ready
+void setUp() {
+    static bool probed = false;
+    if (probed) return;
+    probed = true;
+    for (uint8_t i = 0; i < PRESENT; i++) host::addMcp23s17(i);
+    SpiBus::instance().begin(0, 0, 0);
+    for (uint8_t i = 0; i < SPI_EXP_MAX; i++) expander().begin(i, CS_PIN, i);
+    for (uint8_t p = 0; p < 2 * SPI_EXP_PIN_COUNT; p++) xPinMode(EXP0 + p, OUTPUT);
+    host::runSpiBus();
+}
+
+void tearDown() {}
+
+static void test_attach_resolution() {
+    PinHandle h;
+    TEST_ASSERT_FALSE(h.isValid());
+    TEST_ASSERT_FALSE(h.attach(0));
+    TEST_ASSERT_FALSE(h.isValid());
+
+    TEST_ASSERT_TRUE(h.attach(21));
+    TEST_ASSERT_TRUE(h.isValid());
+    TEST_ASSERT_FALSE(h.isExpander());
+
+    TEST_ASSERT_TRUE(h.attach(EXP1 + 9));
+    TEST_ASSERT_TRUE(h.isExpander());
+    TEST_ASSERT_EQUAL_UINT16(EXP1 + 9, h.getPin());
+
+    // Failed probe and out of range both resolve to a no-op
+    TEST_ASSERT_FALSE(expander().isReady(2));
+    TEST_ASSERT_FALSE(h.attach(EXP2 + 3));
+    TEST_ASSERT_FALSE(h.isValid());
+    TEST_ASSERT_FALSE(h.attach(SPI_EXP_PIN_OFFSET + SPI_EXP_MAX * SPI_EXP_PIN_COUNT));
+    h.write(HIGH);
+    TEST_ASSERT_EQUAL_UINT32(0, host::runSpiBus());
+}
+
+// The same write sequence through both paths lands the same OLAT and native levels, and
+// writes between two bus runs go out as one flush per device
+static void test_writes_match_xdigitalwrite() {
+    const uint16_t pins[] = { EXP0 + 0, EXP0 + 7, EXP0 + 8, EXP0 + 15, EXP1 + 3, EXP1 + 12, 21, 38 };
+    const uint8_t N = sizeof(pins) / sizeof(pins[0]);
+    PinHandle h[N];
+    for (uint8_t i = 0; i < N; i++) TEST_ASSERT_TRUE(h[i].attach(pins[i]));
+
+    uint32_t rng = 12345;
+    for (uint8_t round = 0; round < 50; round++) {
+        uint8_t vals[N];
+        for (uint8_t i = 0; i < N; i++) {
+            rng = rng * 1103515245u + 12345u;
+            vals[i] = (rng >> 16) & 1;
+        }
+
+        for (uint8_t i = 0; i < N; i++) xDigitalWrite(pins[i], vals[i]);
+        TEST_ASSERT_EQUAL_UINT32(PRESENT, host::runSpiBus());
+        uint16_t ref0 = olat(0), ref1 = olat(1);
+        uint8_t refNative[2] = { host::pinLevel[21], host::pinLevel[38] };
+
+        // Scramble, then the handles
+        for (uint8_t i = 0; i < N; i++) xDigitalWrite(pins[i], !vals[i]);
+        host::runSpiBus();
+        for (uint8_t i = 0; i < N; i++) h[i].write(vals[i]);
+        TEST_ASSERT_EQUAL_UINT32(PRESENT, host::runSpiBus());
+
+        TEST_ASSERT_EQUAL_HEX16(ref0, olat(0));
+        TEST_ASSERT_EQUAL_HEX16(ref1, olat(1));
+        TEST_ASSERT_EQUAL_HEX16(expander().getShadow(0), olat(0));
+        TEST_ASSERT_EQUAL_UINT8(refNative[0], host::pinLevel[21]);
+        TEST_ASSERT_EQUAL_UINT8(refNative[1], host::pinLevel[38]);
+        host::setTime(host::nowUs + PinExpander::SNAPSHOT_MAX_AGE_US + 1);   // Fresh snapshot
+        for (uint8_t i = 0; i < N; i++) TEST_ASSERT_EQUAL_UINT8(vals[i], h[i].read());
+    }
+}
+
+// writeSync returns with the level on the chip; read() follows the chip's input pins
+static void test_write_sync_and_read() {
+    PinHandle out, in;
+    TEST_ASSERT_TRUE(out.attach(EXP1 + 5));
+    out.writeSync(HIGH);
+    TEST_ASSERT_EQUAL_HEX16(1 << 5, olat(1) & (1 << 5));
+    out.writeSync(LOW);
+    TEST_ASSERT_EQUAL_HEX16(0, olat(1) & (1 << 5));
+
+    xPinMode(EXP1 + 14, INPUT);
+    TEST_ASSERT_TRUE(in.attach(EXP1 + 14));
+    host::setMcpInputs(1, 1 << 14);
+    host::setTime(host::nowUs + PinExpander::SNAPSHOT_MAX_AGE_US + 1);
+    TEST_ASSERT_EQUAL_UINT8(HIGH, in.read());
+    TEST_ASSERT_EQUAL_UINT8(HIGH, xDigitalRead(EXP1 + 14));
+    xPinMode(EXP1 + 14, OUTPUT);
+}
+
+// A flush the bus refuses is re-queued by the next tick's retryFlushes(), not left for some
+// later write to the same device
+static void test_refused_flush_retried() {
+    PinHandle h;
+    TEST_ASSERT_TRUE(h.attach(EXP1 + 2));
+    h.write(LOW);
+    host::runSpiBus();
+    TEST_ASSERT_EQUAL_HEX16(0, olat(1) & (1 << 2));
+
+    // Normal queue full: the flush for this write can't be queued
+    const uint8_t nop[3] = { 0x40 | (7 << 1), MCP_IPOLA, 0x00 };   // No chip at address 7
+    while (SpiBus::instance().write(0, nop, sizeof(nop))) {}
+    uint32_t dropped = SpiBus::instance().getDroppedCount();
+    uint32_t retries = expander().getFlushRetryCount();
+    h.write(HIGH);
+    TEST_ASSERT_EQUAL_UINT32(dropped + 1, SpiBus::instance().getDroppedCount());
+    TEST_ASSERT_EQUAL_UINT32(retries + 1, expander().getFlushRetryCount());
+    host::runSpiBus();
+    TEST_ASSERT_EQUAL_HEX16(0, olat(1) & (1 << 2));     // Still low on the pin
+
+    expander().retryFlushes();
+    host::runSpiBus();
+    TEST_ASSERT_EQUAL_HEX16(1 << 2, olat(1) & (1 << 2));
+
+    // Sent: nothing left to retry
+    uint32_t sent = SpiBus::instance().getTransactionCount();
+    expander().retryFlushes();
+    TEST_ASSERT_EQUAL_UINT32(0, host::runSpiBus());
+    TEST_ASSERT_EQUAL_UINT32(sent, SpiBus::instance().getTransactionCount());
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static uint64_t cycles() { return __rdtsc(); }
+#else
+static uint64_t cycles() { return 0; }
+#endif
+
+// ns per write over 8 pins with a flush already queued on each device (the bus busy, as it
+// is while a tick's outputs go out): the shadow update and flush dedupe are all that is left
+// after dispatch. Reported, not asserted.
+static void test_dispatch_cost() {
+    const uint32_t N = 20000000;
+    const uint16_t expPins[8] = { EXP0 + 0, EXP0 + 3, EXP0 + 9, EXP0 + 14, EXP1 + 1, EXP1 + 6, EXP1 + 10, EXP1 + 15 };
+    const uint16_t nativePins[8] = { 4, 5, 12, 13, 21, 38, 39, 40 };
+
+    struct Cost { double ns, cyc; };
+    auto measure = [&](auto&& fn) {
+        using namespace std::chrono;
+        auto t0 = steady_clock::now();
+        uint64_t c0 = cycles();
+        for (uint32_t i = 0; i < N; i++) fn(i & 7, (i >> 3) & 1);
+        uint64_t c = cycles() - c0;
+        return Cost{ duration_cast<nanoseconds>(steady_clock::now() - t0).count() / (double)N, c / (double)N };
+    };
+
+    auto run = [&](const uint16_t* pins, Cost& before, Cost& after) {
+        PinHandle h[8];
+        for (uint8_t i = 0; i < 8; i++) TEST_ASSERT_TRUE(h[i].attach(pins[i]));
+        host::runSpiBus();
+        uint32_t sent = SpiBus::instance().getTransactionCount();
+        before = measure([&](uint8_t i, uint8_t v) { xDigitalWrite(pins[i], v); });
+        after = measure([&](uint8_t i, uint8_t v) { h[i].write(v); });
+        host::runSpiBus();
+        // One flush per device covered every write
+        TEST_ASSERT_LESS_OR_EQUAL(sent + PRESENT, SpiBus::instance().getTransactionCount());
+    };
+
+    Cost expBefore, expAfter, natBefore, natAfter;
+    run(expPins, expBefore, expAfter);
+    run(nativePins, natBefore, natAfter);
+    TEST_ASSERT_EQUAL_HEX16(expander().getShadow(0), olat(0));
+
+    char line[200];
+    snprintf(line, sizeof(line),
+             "expander: xDigitalWrite %.1f ns (%.1f TSC cycles), PinHandle %.1f ns (%.1f); "
+             "native: xDigitalWrite %.1f ns (%.1f), PinHandle %.1f ns (%.1f)",
+             expBefore.ns, expBefore.cyc, expAfter.ns, expAfter.cyc,
+             natBefore.ns, natBefore.cyc, natAfter.ns, natAfter.cyc);
+    TEST_MESSAGE(line);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_attach_resolution);
+    RUN_TEST(test_writes_match_xdigitalwrite);
+    RUN_TEST(test_write_sync_and_read);
+    RUN_TEST(test_refused_flush_retried);
+    RUN_TEST(test_dispatch_cost);
+    return UNITY_END();
+}
@@ -0,0 +1,474 @@
+#include "TriggerSimulator.h"
+#include <algorithm>
+#include <chrono>
+#include "CrankSensor.h"
+#include "CamSensor.h"
+#include "EventPlan.h"
+#include "EventScheduler.h"
+#include "MapSampler.h"
+#include "TriggerLogger.h"
+
+void TriggerSimulator::Accum::add(float errDeg) {
+    float a = fabsf(errDeg);
+    sum += a;
+    if (a > max) max = a;
+    count++;
+}
+
+void TriggerSimulator::Accum::store(ErrorStat& out) const {
+    out.meanDeg = count ? (float)(sum / count) : 0.0f;
+    out.maxDeg = max;
+    out.count = count;
+}
+
+void TriggerSimulator::Accum::store(MapStat& out) const {
+    out.meanKpa = count ? (float)(sum / count) : 0.0f;
+    out.maxKpa = max;
+    out.count = count;
+}
+
+TriggerSimulator::TriggerSimulator() : _error(""), _rng(1) {
+    memset(&_engine, 0, sizeof(_engine));
+    memset(&_profile, 0, sizeof(_profile));
+    memset(&_result, 0, sizeof(_result));
+}
+
+void TriggerSimulator::reset() {
+    _error = "";
+    memset(&_result, 0, sizeof(_result));
+    _result.positionUs = -1;
+    _result.syncUs = -1;
+    _result.phaseUs = -1;
+    memset(&_toothAcc, 0, sizeof(_toothAcc));
+    memset(&_sparkAcc, 0, sizeof(_sparkAcc));
+    memset(&_injAcc, 0, sizeof(_injAcc));
+    memset(&_mapSyncAcc, 0, sizeof(_mapSyncAcc));
+    memset(&_mapTimedAcc, 0, sizeof(_mapTimedAcc));
+    _rng = _profile.seed ? _profile.seed : 1;
+    host::reset();
+}
+
+void TriggerSimulator::finish(uint32_t runMs) {
+    _result.runMs = runMs;
+    _toothAcc.store(_result.toothErr);
+    _sparkAcc.store(_result.sparkErr);
+    _injAcc.store(_result.injErr);
+    _mapSyncAcc.store(_result.mapSyncErr);
+    _mapTimedAcc.store(_result.mapTimedErr);
+}
+
+uint32_t TriggerSimulator::random32() {
+    // xorshift32 — reproducible for a given seed
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    return _rng;
+}
+
+static uint32_t wallMs() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Signed angle difference wrapped to [-180, 180)
+static float wrapDeg(float d) {
+    while (d >= 180.0f) d -= 360.0f;
+    while (d < -180.0f) d += 360.0f;
+    return d;
+}
+
+// Frames records the way the TriggerLogger drain task does, to a host file
+struct CaptureWriter {
+    FILE* file;
+    TriggerLogger::Record buf[TriggerLogger::FRAME_RECORDS];
+    uint16_t count;
+
+    void add(int64_t timeUs, TriggerLogger::EventType type, uint8_t id, uint16_t value) {
+        if (!file) return;
+        buf[count++] = { (uint32_t)timeUs, type, id, value };
+        if (count == TriggerLogger::FRAME_RECORDS) flush();
+    }
+    void flush() {
+        if (!file || count == 0) return;
+        TriggerLogger::FrameHeader hdr = { 'T', TriggerLogger::FRAME_VERSION, count, 0 };
+        fwrite(&hdr, sizeof(hdr), 1, file);
+        fwrite(buf, sizeof(buf[0]), count, file);
+        count = 0;
+    }
+};
+
+const TriggerSimulator::Result& TriggerSimulator::runProfile(const Engine& engine, const Profile& profile,
+                                                             FILE* capture) {
+    enum EdgeKind : uint8_t { EDGE_CRANK, EDGE_CAM };
+    struct Edge {
+        float angle;        // Engine-cycle degrees ATDC #1 compression
+        uint8_t kind;
+        bool operator<(const Edge& o) const { return angle < o.angle; }
+    };
+
+    _engine = engine;
+    _profile = profile;
+    if (_profile.durationMs == 0 || _profile.durationMs > MAX_DURATION_MS) _profile.durationMs = 10000;
+    if (_profile.rpmStart == 0) _profile.rpmStart = 1000;
+    if (_profile.rpmEnd == 0) _profile.rpmEnd = _profile.rpmStart;
+    reset();
+    uint32_t wall0 = wallMs();
+    CaptureWriter* cap = new CaptureWriter();
+    cap->file = capture;
+
+    CrankSensor crank;
+    crank.begin(CRANK_PIN, _engine.triggerType, _engine.crankTeeth, _engine.crankMissing);
+    crank.setNoiseBlanking(_engine.blankPct);
+    crank.enableStallDetect(STALL_TIMER);
+    CamSensor cam;
+    cam.setCrankSensor(&crank);
+    cam.begin(CAM_PIN, _engine.camType, _engine.camOffsetDeg);
+
+    // The scheduler does the angle maths for the spark/injection targets; only the MAP sample
+    // events are armed, on a fake backend the loop below dispatches on the virtual clock
+    struct SimBackend : EventScheduler::TimerBackend {
+        int64_t alarm = EventScheduler::NO_ALARM;
+        int64_t nowUs() override { return esp_timer_get_time(); }
+        void armAt(int64_t whenUs) override { alarm = whenUs; }
+        void disarm() override { alarm = EventScheduler::NO_ALARM; }
+    } backend;
+    EventScheduler sched;
+    sched.begin(&backend);
+
+    // Physical wheel in the decoder's own angle convention, so truth and decoder frames agree
+    const TriggerDecoder::Geometry& geo = crank.getGeometry();
+    const CamDecoder* camDec = cam.getDecoder();
+    uint16_t maxEdges = 2 * geo.teeth + 2 + CamDecoder::MAX_TEETH;
+    Edge* edges = new Edge[maxEdges];
+    uint16_t n = 0;
+    for (uint8_t rev = 0; rev < 2; rev++) {
+        for (uint16_t pos = 0; pos < geo.teeth - geo.missing; pos++) {
+            float a = rev * 360.0f + crank.getToothAngleDeg(pos);
+            edges[n++] = { fmodf(a, 720.0f), EDGE_CRANK };
+        }
+        // 4+1: the extra sync tooth a fifth of a tooth after position 0
+        if (_engine.triggerType == TRIG_4_PLUS_1)
+            edges[n++] = { fmodf(rev * 360.0f + crank.getToothAngleDeg(0) + geo.degPerTooth * 0.2f, 720.0f), EDGE_CRANK };
+    }
+    if (_engine.hasCam) {
+        for (uint8_t i = 0; i < camDec->getToothCount(); i++) {
+            float a = camDec->getToothAngleUnits(i) / (float)CamDecoder::ANGLE_UNITS_PER_DEG
+                      + _engine.camOffsetDeg - _profile.vvtDeg;
+            a = fmodf(a, 720.0f);
+            if (a < 0) a += 720.0f;
+            edges[n++] = { a, EDGE_CAM };
+        }
+    }
+    std::sort(edges, edges + n);
+
+    uint8_t cyl = constrain(_engine.cylinders, (uint8_t)1, MAX_CYLINDERS);
+    const uint8_t PLAN_INJ = 0x80;
+    EventPlan plan;
+    plan.setGeometry(geo, 2 * MAX_CYLINDERS);
+    bool planBuilt = false;
+    Target spark[MAX_CYLINDERS];
+    Target inj[MAX_CYLINDERS];
+    memset(spark, 0, sizeof(spark));
+    memset(inj, 0, sizeof(inj));
+
+    // Engine truth: absolute crank angle and time, random start position
+    const double t0 = 1000000.0;
+    double t = t0;
+    double theta = (random32() % 72000) / 100.0;
+    const double tEnd = t0 + _profile.durationMs * 1000.0;
+    const double maxStep = geo.degPerTooth / 4.0;
+    host::setTime((int64_t)t);
+
+    auto rpmAt = [&](double tt, double th) -> double {
+        switch (_profile.type) {
+            case PROFILE_ACCEL: {
+                double f = (tt - t0) / (tEnd - t0);
+                return _profile.rpmStart + (_profile.rpmEnd - (double)_profile.rpmStart) * (f > 1.0 ? 1.0 : f);
+            }
+            case PROFILE_CRANKING:
+                // cyl/2 compression strokes per revolution
+                return _profile.rpmStart * (1.0 + _profile.ripple * sin(th * (cyl / 2.0) * (M_PI / 180.0)));
+            default:
+                return _profile.rpmStart;
+        }
+    };
+    auto degPerUs = [&](double tt, double th) -> double {
+        double r = rpmAt(tt, th);
+        return (r < 10.0 ? 10.0 : r) * 6.0e-6;
+    };
+
+    // First edge ahead of the start angle
+    double cycleBase = floor(theta / 720.0) * 720.0;
+    uint16_t idx = 0;
+    while (idx < n && cycleBase + edges[idx].angle <= theta) idx++;
+    if (idx == n) { idx = 0; cycleBase += 720.0; }
+    double noiseAt = -1.0;
+
+    // MAP truth: mean plus an intake pulsation locked to the cylinder events (with some second
+    // harmonic). The sampler's converter has no latency — a sample is the truth at the angle
+    // its event fired. The 10 ms path samples the same truth through SensorManager's EMA.
+    struct MapTruth {
+        const double* theta;
+        MapSampler* sampler;
+        double meanKpa;
+        double pulseKpa;
+        double spacingDeg;
+        double at(double th) const {
+            double ph = th * (2.0 * M_PI / spacingDeg);
+            return meanKpa + pulseKpa * (sin(ph) + 0.3 * sin(2.0 * ph + 1.0));
+        }
+    };
+    MapSampler sampler;
+    MapTruth mapTruth = { &theta, &sampler, _profile.mapKpa, _profile.mapPulseKpa, 720.0 / cyl };
+    sampler.setScheduler(&sched);
+    sampler.setTriggerGeometry(geo);
+    sampler.begin(cyl);
+    sampler.setConverter([](void* arg, uint8_t tag) -> bool {
+        MapTruth* m = (MapTruth*)arg;
+        m->sampler->addSample(tag, (float)m->at(*m->theta));
+        return true;
+    }, &mapTruth);
+    sampler.setWindow(_engine.mapStartDeg, _engine.mapWindowDeg, _engine.mapSamples);
+    const double MAP_EMA_ALPHA = 0.3;
+    uint32_t mapWindows = 0;
+    double mapTickUs = t0 + 10000.0;
+    double mapEma = _profile.mapKpa;
+
+    auto arm = [&](Target& tg, float targetDeg, float cycleDeg, int64_t predictedUs) {
+        double rel = fmod((double)targetDeg - fmod(theta, (double)cycleDeg) + cycleDeg, (double)cycleDeg);
+        tg.armed = true;
+        tg.predictedUs = predictedUs;
+        tg.trueAngle = theta + rel;
+    };
+
+    // Real-time task, as in ECU: tooth reference -> scheduler -> per-cylinder targets in the window
+    int64_t lastRefUs = 0;
+    auto realtime = [&]() {
+        CrankSensor::ToothReference ref;
+        if (crank.getRpm() == 0 || !crank.isPositionKnown() || !crank.getToothReference(ref)) return;
+        if (ref.timeUs == lastRefUs) return;
+        lastRefUs = ref.timeUs;
+        sched.setAngleReference(ref.timeUs, ref.angle, ref.usPerUnitQ, ref.cycleUnits);
+        // Same event plan as the managers: spark and injector open per cylinder, by tooth
+        bool sequential = ref.isSequential();
+        if (!planBuilt || sequential != plan.isSequential()) {
+            plan.clear(sequential);
+            int32_t interval = CrankAngle::UNITS_PER_CYCLE / cyl;
+            int32_t advance = CrankAngle::fromDeg(_profile.advanceDeg).units;
+            for (uint8_t i = 0; i < cyl; i++) {
+                plan.add(i, i * interval - advance);
+                plan.add(i | PLAN_INJ, sequential ? i * interval + CrankAngle::UNITS_PER_REV : 0);
+            }
+            plan.build();
+            planBuilt = true;
+        }
+        uint8_t count;
+        const EventPlan::Entry* e = plan.entries(ref.cycleTooth, count);
+        for (uint8_t k = 0; k < count; k++) {
+            Target& tg = (e[k].tag & PLAN_INJ) ? inj[e[k].tag & ~PLAN_INJ] : spark[e[k].tag];
+            arm(tg, ref.angle.toDeg() + e[k].offset.toDeg(), ref.cycleUnits / (float)CrankAngle::UNITS_PER_DEG,
+                sched.offsetToTimeUs(e[k].offset));
+        }
+        sampler.update(crank.getRpm(), ref, true);
+    };
+
+    uint32_t stalls = 0;
+    auto logStalls = [&]() {
+        for (; stalls < crank.getStallCount(); stalls++)
+            cap->add((int64_t)t, TriggerLogger::EVT_STALL, 0, 0);
+    };
+
+    // One crank edge through the pin interrupt, logged as the ISR would log it
+    auto tooth = [&](bool noise) {
+        if (!noise && crank.isPositionKnown() && crank.getRpm() > 0) {
+            float predicted = crank.getCrankAngleAt((int64_t)t) / (float)CrankSensor::ANGLE_UNITS_PER_DEG;
+            _toothAcc.add(wrapDeg(predicted - (float)fmod(theta, 360.0)));
+        }
+        CrankSensor::SyncState prevSync = crank.getSyncState();
+        uint32_t rejected = crank.getRejectedEdgeCount();
+        host::fireInterrupt(CRANK_PIN);
+        uint16_t flags = crank.getRejectedEdgeCount() != rejected ? TriggerLogger::EVT_FLAG_NOISE
+                       : crank.getLastToothTimeUs() != (int64_t)t ? TriggerLogger::EVT_FLAG_EXTRA : 0;
+        cap->add((int64_t)t, TriggerLogger::EVT_CRANK, (uint8_t)crank.getToothPosition(),
+                 crank.getSyncState() | flags);
+        if (prevSync == TriggerDecoder::SYNCED && crank.getSyncState() != TriggerDecoder::SYNCED)
+            _result.syncLosses++;
+        realtime();
+    };
+
+    while (t < tEnd) {
+        // Virtual clock to now: the stall alarm and MAP sample events due by now fire first
+        host::setTime((int64_t)t);
+        logStalls();
+        if (backend.alarm <= (int64_t)t + EventScheduler::DISPATCH_SLACK_US) sched.dispatch();
+
+        // Step to the next edge, target crossing, sample event or integration limit, whichever is first
+        double next = theta + maxStep;
+        double edgeAt = cycleBase + edges[idx].angle;
+        if (edgeAt < next) next = edgeAt;
+        if (noiseAt > theta && noiseAt < next) next = noiseAt;
+        if (backend.alarm != EventScheduler::NO_ALARM) {
+            double alarmAt = theta + (backend.alarm - t) * degPerUs(t, theta);
+            if (alarmAt > theta && alarmAt < next) next = alarmAt;
+        }
+        for (uint8_t i = 0; i < cyl; i++) {
+            if (spark[i].armed && spark[i].trueAngle < next) next = spark[i].trueAngle;
+            if (inj[i].armed && inj[i].trueAngle < next) next = inj[i].trueAngle;
+        }
+        double d = next - theta;
+        double w = degPerUs(t, theta);
+        w = degPerUs(t + d / w / 2.0, theta + d / 2.0);   // Midpoint speed
+        t += d / w;
+        theta = next;
+        host::setTime((int64_t)t);
+        logStalls();
+
+        // Score targets the truth just crossed against where the scheduler put them
+        for (uint8_t i = 0; i < cyl; i++) {
+            if (spark[i].armed && spark[i].trueAngle <= theta) {
+                _sparkAcc.add((float)((spark[i].predictedUs - t) * w));
+                spark[i].armed = false;
+                _result.events++;
+            }
+            if (inj[i].armed && inj[i].trueAngle <= theta) {
+                _injAcc.add((float)((inj[i].predictedUs - t) * w));
+                inj[i].armed = false;
+                _result.events++;
+            }
+        }
+
+        // Score each completed window, and the 10 ms sample it replaces, against the mean
+        MapSampler::Window win;
+        if (sampler.readWindow(win) && win.count != mapWindows) {
+            mapWindows = win.count;
+            _mapSyncAcc.add(win.load - _profile.mapKpa);
+        }
+        if (t >= mapTickUs) {
+            mapEma += MAP_EMA_ALPHA * (mapTruth.at(theta) - mapEma);
+            _mapTimedAcc.add((float)(mapEma - _profile.mapKpa));
+            mapTickUs += 10000.0;
+        }
+
+        if (theta == noiseAt) {
+            noiseAt = -1.0;
+            _result.noiseEdges++;
+            tooth(true);
+        }
+
+        if (theta == edgeAt) {
+            if (edges[idx].kind == EDGE_CAM) {
+                host::fireInterrupt(CAM_PIN);
+                cap->add((int64_t)t, TriggerLogger::EVT_CAM, (uint8_t)cam.getLastTooth(), cam.getLastPulseAngle());
+                _result.camEdges++;
+            } else if (chance(_profile.dropPpm)) {
+                _result.droppedTeeth++;
+            } else {
+                _result.teeth++;
+                tooth(false);
+                if (chance(_profile.noisePpm))
+                    noiseAt = theta + geo.degPerTooth * (0.2 + 0.6 * (random32() % 1000) / 1000.0);
+            }
+            if (++idx >= n) { idx = 0; cycleBase += 720.0; }
+
+            int32_t since = (int32_t)(t - t0);
+            if (_result.positionUs < 0 && crank.isPositionKnown()) _result.positionUs = since;
+            if (_result.syncUs < 0 && crank.isSynced()) _result.syncUs = since;
+            if (_result.phaseUs < 0 && crank.isPhaseKnown()) _result.phaseUs = since;
+        }
+    }
+    cap->flush();
+    delete cap;
+
+    _result.rejectedEdges = crank.getRejectedEdgeCount();
+    _result.camSyncLosses = camDec->getSyncLossCount();
+    _result.stalls = crank.getStallCount();
+    _result.vvtDeg = cam.getVvtAngleDeg();
+    _result.engineMs = _profile.durationMs;
+    delete[] edges;
+    finish(wallMs() - wall0);
+    return _result;
+}
+
+bool TriggerSimulator::runReplay(const Engine& engine, const char* path) {
+    _engine = engine;
+    memset(&_profile, 0, sizeof(_profile));
+    reset();
+    FILE* f = path ? fopen(path, "rb") : nullptr;
+    if (!f) {
+        _error = "cannot open file";
+        return false;
+    }
+    uint32_t wall0 = wallMs();
+
+    CrankSensor crank;
+    crank.begin(CRANK_PIN, _engine.triggerType, _engine.crankTeeth, _engine.crankMissing);
+    crank.setNoiseBlanking(_engine.blankPct);
+    crank.enableStallDetect(STALL_TIMER);
+    CamSensor cam;
+    cam.setCrankSensor(&crank);
+    cam.begin(CAM_PIN, _engine.camType, _engine.camOffsetDeg);
+
+    // Records carry the low 32 bits of the capture clock — rebuild a monotonic 64-bit time
+    int64_t t = 1000000;
+    int64_t tFirst = 0;
+    uint32_t lastLow = 0;
+    bool first = true;
+
+    TriggerLogger::FrameHeader hdr;
+    TriggerLogger::Record rec;
+    while (fread(&hdr, sizeof(hdr), 1, f) == 1) {
+        if (hdr.magic != 'T' || hdr.version != TriggerLogger::FRAME_VERSION) {
+            _error = "not a trigger log";
+            break;
+        }
+        for (uint16_t i = 0; i < hdr.count; i++) {
+            if (fread(&rec, sizeof(rec), 1, f) != 1) break;
+            if (first) {
+                first = false;
+                tFirst = t;
+            } else {
+                t += (uint32_t)(rec.timeUs - lastLow);
+            }
+            lastLow = rec.timeUs;
+            // Stall records are not replayed: the emulated stall timer fires on the same gaps
+            host::setTime(t);
+
+            if (rec.type == TriggerLogger::EVT_CRANK) {
+                bool hadPosition = crank.isPositionKnown() && crank.getRpm() > 0;
+                float predicted = crank.getCrankAngleAt(t) / (float)CrankSensor::ANGLE_UNITS_PER_DEG;
+                CrankSensor::SyncState prevSync = crank.getSyncState();
+                uint32_t rejected = crank.getRejectedEdgeCount();
+                host::fireInterrupt(CRANK_PIN);
+                _result.teeth++;
+                if (crank.getRejectedEdgeCount() != rejected) continue;   // Blanked — nothing moved
+                if (prevSync == TriggerDecoder::SYNCED && !crank.isSynced()) _result.syncLosses++;
+                // No truth here: score the extrapolation against the tooth the decoder then assigns
+                if (hadPosition && crank.isPositionKnown() && !(rec.value & TriggerLogger::EVT_FLAG_EXTRA))
+                    _toothAcc.add(wrapDeg(predicted - crank.getToothAngleDeg(crank.getToothPosition())));
+                // Both synced but on different teeth = decoder behaviour changed since the capture
+                if ((rec.value & 0xFF) == TriggerDecoder::SYNCED && crank.isSynced() &&
+                    rec.id != (uint8_t)crank.getToothPosition())
+                    _result.positionMismatches++;
+            } else if (rec.type == TriggerLogger::EVT_CAM) {
+                host::fireInterrupt(CAM_PIN);
+                _result.camEdges++;
+            } else {
+                continue;
+            }
+
+            int32_t since = (int32_t)(t - tFirst);
+            if (_result.positionUs < 0 && crank.isPositionKnown()) _result.positionUs = since;
+            if (_result.syncUs < 0 && crank.isSynced()) _result.syncUs = since;
+            if (_result.phaseUs < 0 && crank.isPhaseKnown()) _result.phaseUs = since;
+        }
+    }
+    fclose(f);
+
+    _result.rejectedEdges = crank.getRejectedEdgeCount();
+    _result.camSyncLosses = cam.getDecoder()->getSyncLossCount();
+    _result.stalls = crank.getStallCount();
+    _result.vvtDeg = cam.getVvtAngleDeg();
+    _result.engineMs = (uint32_t)((t - tFirst) / 1000);
+    finish(wallMs() - wall0);
+    return _error[0] == '\0';
+}
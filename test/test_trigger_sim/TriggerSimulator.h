@@ -0,0 +1,137 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdio.h>
+
+// Offline trigger bench for the native env. Drives CrankSensor and CamSensor through their
+// public API on the host's virtual clock: each generated (or replayed) edge sets the time
+// and fires the pin interrupt the sensor attached, and the stall alarm runs on the host's
+// emulated hardware timer. Spark and injection targets go through an EventScheduler on a
+// fake TimerBackend, with the same tooth reference -> EventPlan path as the real-time task.
+//
+// A profile run generates crank and cam edges from the wheel and a speed profile, and scores
+// sync, the per-tooth angle extrapolation, and scheduled vs true target crossings. It also
+// runs a MapSampler against a pulsating MAP and scores its per-event load next to the 10 ms
+// sample + EMA it replaced. A replay feeds a TriggerLogger capture (/teeth?sd=1) back
+// through the decoders.
+class TriggerSimulator {
+public:
+    enum ProfileType : uint8_t {
+        PROFILE_STEADY   = 0,
+        PROFILE_ACCEL    = 1,   // rpmStart -> rpmEnd, linear over the run
+        PROFILE_CRANKING = 2    // rpmStart with a speed ripple per compression stroke
+    };
+
+    // Wheel and engine under test (ProjectInfo fields)
+    struct Engine {
+        uint8_t triggerType;
+        uint8_t crankTeeth;
+        uint8_t crankMissing;
+        bool hasCam;
+        uint8_t camType;
+        float camOffsetDeg;
+        uint8_t cylinders;
+        uint8_t blankPct;       // Crank noise-blanking window, % of the predicted tooth period
+        uint8_t mapSamples;     // Crank-synchronous MAP window (MapSampler::setWindow), 0 = off
+        float mapStartDeg;
+        float mapWindowDeg;
+    };
+
+    struct Profile {
+        ProfileType type;
+        uint16_t rpmStart;
+        uint16_t rpmEnd;
+        uint32_t durationMs;    // Engine time to simulate
+        float ripple;           // CRANKING: peak speed swing per compression (0.3 = +/-30%)
+        float advanceDeg;       // Spark target BTDC
+        float vvtDeg;           // Cam advance applied to the generated cam edges
+        uint32_t noisePpm;      // Spurious crank edges per million teeth
+        uint32_t dropPpm;       // Missed crank teeth per million
+        uint32_t seed;
+        float mapKpa;           // Mean manifold pressure
+        float mapPulseKpa;      // Intake pulsation amplitude, one cycle per cylinder event
+    };
+
+    struct ErrorStat {
+        float meanDeg;
+        float maxDeg;
+        uint32_t count;
+    };
+
+    struct MapStat {
+        float meanKpa;          // Mean / worst distance of a load value from the true mean MAP
+        float maxKpa;
+        uint32_t count;
+    };
+
+    struct Result {
+        uint32_t teeth;
+        uint32_t camEdges;
+        uint32_t noiseEdges;
+        uint32_t droppedTeeth;
+        uint32_t rejectedEdges; // Crank edges the blanking window dropped
+        int32_t positionUs;     // Engine time to first usable position / full sync / cam phase (-1 = never)
+        int32_t syncUs;
+        int32_t phaseUs;
+        uint32_t syncLosses;
+        uint32_t camSyncLosses;
+        uint32_t stalls;        // Stall alarms the emulated hardware timer fired
+        uint32_t positionMismatches;    // Replay: decoder position differs from the logged one
+        uint32_t events;        // Spark + injection targets scored
+        ErrorStat toothErr;     // Extrapolated crank angle vs actual, at each tooth
+        ErrorStat sparkErr;     // Scheduled time vs true crossing of the target angle
+        ErrorStat injErr;
+        MapStat mapSyncErr;     // Per cylinder-event window means
+        MapStat mapTimedErr;    // 10 ms samples through the 0.3 EMA
+        float vvtDeg;           // Last measured cam angle
+        uint32_t engineMs;
+        uint32_t runMs;         // Wall time
+    };
+
+    static const uint32_t MAX_DURATION_MS = 600000;
+    static const uint8_t MAX_CYLINDERS = 12;
+    static const uint8_t CRANK_PIN = 4;     // Host pins the sensors attach to
+    static const uint8_t CAM_PIN = 5;
+    static const uint8_t STALL_TIMER = 0;
+
+    TriggerSimulator();
+
+    // capture (optional): the run's crank/cam/stall edges, written in the TriggerLogger
+    // frame format with what the ISRs log, so runReplay() can read it back
+    const Result& runProfile(const Engine& engine, const Profile& profile, FILE* capture = nullptr);
+    // False if the file can't be opened or isn't a trigger log (see getError())
+    bool runReplay(const Engine& engine, const char* path);
+
+    const char* getError() const { return _error; }
+    const Result& getResult() const { return _result; }
+
+private:
+    struct Accum {
+        double sum;
+        float max;
+        uint32_t count;
+        void add(float errDeg);
+        void store(ErrorStat& out) const;
+        void store(MapStat& out) const;
+    };
+
+    // One spark or injection target per cylinder, re-armed on every tooth like the managers
+    struct Target {
+        bool armed;
+        int64_t predictedUs;
+        double trueAngle;       // Absolute engine angle of the crossing it was armed for
+    };
+
+    Engine _engine;
+    Profile _profile;
+    const char* _error;
+    Result _result;
+    Accum _toothAcc, _sparkAcc, _injAcc;
+    Accum _mapSyncAcc, _mapTimedAcc;
+    uint32_t _rng;
+
+    void reset();
+    void finish(uint32_t runMs);
+    uint32_t random32();
+    bool chance(uint32_t ppm) { return ppm > 0 && random32() % 1000000 < ppm; }
+};
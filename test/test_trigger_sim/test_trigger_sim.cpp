@@ -0,0 +1,273 @@
+// Trigger bench: synthetic engine profiles and tooth-log replay through CrankSensor, CamSensor
+// and the EventScheduler angle maths, on the host's virtual clock.
+//
+//   pio test -e native -f test_trigger_sim
+//
+// A capture from the car replays with
+//   TRIGGER_REPLAY=/path/trig_123.bin pio test -e native -f test_trigger_sim
+// against the wheel in TRIGGER_WHEEL="triggerType,teeth,missing,camType,camOffsetDeg"
+// (default 36-1 with a single-tooth cam at 0 deg).
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "TriggerSimulator.h"
+#include "CamDecoder.h"
+#include "TriggerDecoder.h"
+
+static TriggerSimulator sim;
+
+// V8 on a 36-1 crank wheel with a single-tooth cam, at the config defaults
+static TriggerSimulator::Engine v8() {
+    TriggerSimulator::Engine e;
+    memset(&e, 0, sizeof(e));
+    e.triggerType = TRIG_MISSING_TOOTH;
+    e.crankTeeth = 36;
+    e.crankMissing = 1;
+    e.hasCam = true;
+    e.camType = CAM_SINGLE;
+    e.camOffsetDeg = 0.0f;
+    e.cylinders = 8;
+    e.blankPct = 25;
+    e.mapSamples = 4;
+    return e;
+}
+
+static TriggerSimulator::Profile steady(uint16_t rpm, uint32_t ms) {
+    TriggerSimulator::Profile p;
+    memset(&p, 0, sizeof(p));
+    p.type = TriggerSimulator::PROFILE_STEADY;
+    p.rpmStart = rpm;
+    p.durationMs = ms;
+    p.advanceDeg = 10.0f;
+    p.seed = 1;
+    p.mapKpa = 40.0f;
+    p.mapPulseKpa = 6.0f;
+    return p;
+}
+
+static void report(const char* name, const TriggerSimulator::Result& r) {
+    char line[320];
+    snprintf(line, sizeof(line),
+             "%s: %lu teeth, sync %ld us, phase %ld us, %lu losses, %lu stalls, tooth max %.3f deg, "
+             "spark mean %.4f max %.4f deg, inj max %.4f deg, map sync %.3f/%.3f timed %.3f/%.3f kPa (%lu ms)",
+             name, (unsigned long)r.teeth, (long)r.syncUs, (long)r.phaseUs, (unsigned long)r.syncLosses,
+             (unsigned long)r.stalls, r.toothErr.maxDeg, r.sparkErr.meanDeg, r.sparkErr.maxDeg,
+             r.injErr.maxDeg, r.mapSyncErr.meanKpa, r.mapSyncErr.maxKpa, r.mapTimedErr.meanKpa,
+             r.mapTimedErr.maxKpa, (unsigned long)r.runMs);
+    TEST_MESSAGE(line);
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Settled engine: synced within two revolutions, no losses, targets within bound
+static void assertClean(const TriggerSimulator::Result& r, uint32_t syncBoundUs, float sparkBoundDeg) {
+    TEST_ASSERT_GREATER_OR_EQUAL(0, r.syncUs);
+    TEST_ASSERT_LESS_THAN(syncBoundUs, (uint32_t)r.syncUs);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, r.phaseUs);
+    TEST_ASSERT_EQUAL_UINT32(0, r.syncLosses);
+    TEST_ASSERT_EQUAL_UINT32(0, r.camSyncLosses);
+    TEST_ASSERT_EQUAL_UINT32(0, r.stalls);
+    TEST_ASSERT_GREATER_THAN(0, r.sparkErr.count);
+    TEST_ASSERT_LESS_THAN_FLOAT(sparkBoundDeg, r.sparkErr.maxDeg);
+}
+
+static void test_steady() {
+    const TriggerSimulator::Result& r = sim.runProfile(v8(), steady(3000, 5000));
+    report("36-1 3000 rpm", r);
+    assertClean(r, 40000, 0.1f);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.01f, r.toothErr.maxDeg);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.1f, r.injErr.maxDeg);
+}
+
+static void test_accel() {
+    TriggerSimulator::Profile p = steady(800, 3000);
+    p.type = TriggerSimulator::PROFILE_ACCEL;
+    p.rpmEnd = 7000;
+    const TriggerSimulator::Result& r = sim.runProfile(v8(), p);
+    report("800->7000 rpm in 3 s", r);
+    assertClean(r, 150000, 0.25f);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.4f, r.injErr.maxDeg);
+}
+
+static void test_cranking() {
+    TriggerSimulator::Profile p = steady(250, 5000);
+    p.type = TriggerSimulator::PROFILE_CRANKING;
+    p.ripple = 0.3f;
+    const TriggerSimulator::Result& r = sim.runProfile(v8(), p);
+    report("cranking 250 rpm +/-30%", r);
+    // The stall alarm runs on the emulated timer: compression ripple must not trip it
+    assertClean(r, 500000, 1.0f);
+}
+
+static void test_other_wheels() {
+    TriggerSimulator::Engine e = v8();
+    e.crankTeeth = 60;
+    e.crankMissing = 2;
+    e.camType = CAM_4_PLUS_1;
+    e.cylinders = 4;
+    const TriggerSimulator::Result& a = sim.runProfile(e, steady(3000, 3000));
+    report("60-2 + 4+1 cam", a);
+    assertClean(a, 40000, 0.1f);
+
+    e = v8();
+    e.triggerType = TRIG_4_PLUS_1;
+    e.camType = CAM_3_TOOTH;
+    e.cylinders = 4;
+    const TriggerSimulator::Result& b = sim.runProfile(e, steady(3000, 3000));
+    report("4+1 + 3-tooth cam", b);
+    assertClean(b, 40000, 0.1f);
+
+    // Position 0 is the first crank tooth after the cam edge: the edge sits half a tooth before it
+    e = v8();
+    e.triggerType = TRIG_GM_24X;
+    e.camOffsetDeg = -7.5f;
+    const TriggerSimulator::Result& c = sim.runProfile(e, steady(3000, 3000));
+    report("GM 24x", c);
+    assertClean(c, 40000, 0.1f);
+}
+
+static void test_vvt_readback() {
+    TriggerSimulator::Engine e = v8();
+    e.camType = CAM_4_PLUS_1;
+    TriggerSimulator::Profile p = steady(3000, 3000);
+    p.vvtDeg = 20.0f;
+    const TriggerSimulator::Result& r = sim.runProfile(e, p);
+    report("4+1 cam, 20 deg advance", r);
+    assertClean(r, 40000, 0.1f);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 20.0f, r.vvtDeg);
+}
+
+// Crank-synchronous MAP against the 10 ms sample + EMA it replaced, on a 40 kPa +/-6 kPa
+// pulsation: the window mean holds the true mean at any speed, the timed sample aliases
+static void test_map_window_mean() {
+    const TriggerSimulator::Result& idle = sim.runProfile(v8(), steady(800, 5000));
+    report("MAP idle 800 rpm", idle);
+    TEST_ASSERT_GREATER_THAN(0, idle.mapSyncErr.count);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.05f, idle.mapSyncErr.maxKpa);
+    TEST_ASSERT_GREATER_THAN_FLOAT(0.5f, idle.mapTimedErr.meanKpa);
+
+    // 200 Hz pulsation against a 100 Hz sample: a fixed offset the EMA can't average out
+    const TriggerSimulator::Result& cruise = sim.runProfile(v8(), steady(3000, 5000));
+    report("MAP 3000 rpm", cruise);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.05f, cruise.mapSyncErr.maxKpa);
+    TEST_ASSERT_GREATER_THAN_FLOAT(3.0f, cruise.mapTimedErr.meanKpa);
+
+    TriggerSimulator::Profile p = steady(800, 5000);
+    p.type = TriggerSimulator::PROFILE_ACCEL;
+    p.rpmEnd = 6000;
+    const TriggerSimulator::Result& sweep = sim.runProfile(v8(), p);
+    report("MAP 800->6000 rpm", sweep);
+    TEST_ASSERT_GREATER_THAN(0, sweep.mapSyncErr.count);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.05f, sweep.mapSyncErr.maxKpa);
+}
+
+// Noise inside the blanking window is dropped; later noise and missed teeth cost sync,
+// and the decoder has to find it again each time
+static void test_noise_and_drops() {
+    TriggerSimulator::Profile p = steady(3000, 10000);
+    p.noisePpm = 20000;
+    const TriggerSimulator::Result& n = sim.runProfile(v8(), p);
+    report("2% noise edges", n);
+    TEST_ASSERT_GREATER_THAN(0, n.rejectedEdges);
+    TEST_ASSERT_LESS_OR_EQUAL(n.noiseEdges - n.rejectedEdges, n.syncLosses);
+    TEST_ASSERT_LESS_THAN_FLOAT(2.0f, n.sparkErr.meanDeg);
+
+    p.noisePpm = 0;
+    p.dropPpm = 2000;
+    const TriggerSimulator::Result& d = sim.runProfile(v8(), p);
+    report("0.2% dropped teeth", d);
+    TEST_ASSERT_GREATER_THAN(0, d.droppedTeeth);
+    TEST_ASSERT_LESS_OR_EQUAL(d.droppedTeeth, d.syncLosses);
+    TEST_ASSERT_EQUAL_UINT32(0, d.stalls);
+    TEST_ASSERT_LESS_THAN_FLOAT(0.5f, d.sparkErr.meanDeg);
+}
+
+// At a noise rate that leaves the decoder synced most of the time (2% saturates it: losses
+// barely move with the window), every edge the window rejects is a resync that doesn't
+// happen: fewer losses than with blanking off
+static void test_blanking_vs_off() {
+    TriggerSimulator::Profile p = steady(3000, 10000);
+    p.noisePpm = 2000;
+    const uint8_t pcts[] = { 0, 25, 50, 75 };
+    uint32_t losses[4];
+    for (uint8_t i = 0; i < 4; i++) {
+        TriggerSimulator::Engine e = v8();
+        e.blankPct = pcts[i];
+        const TriggerSimulator::Result& r = sim.runProfile(e, p);
+        char name[80];
+        snprintf(name, sizeof(name), "0.2%% noise, blanking %u%% (%lu noise, %lu rejected)", pcts[i],
+                 (unsigned long)r.noiseEdges, (unsigned long)r.rejectedEdges);
+        report(name, r);
+        losses[i] = r.syncLosses;
+        TEST_ASSERT_GREATER_THAN(0, r.noiseEdges);
+    }
+    // Noise lands 20-80% into a tooth; the 36-1 decoder caps the window near 50%
+    TEST_ASSERT_GREATER_THAN(0, losses[0]);
+    TEST_ASSERT_LESS_THAN(losses[0], losses[1]);
+    TEST_ASSERT_LESS_THAN(losses[1], losses[2]);
+    TEST_ASSERT_LESS_OR_EQUAL(losses[0] * 2 / 3, losses[2]);
+    TEST_ASSERT_LESS_OR_EQUAL(losses[2], losses[3]);
+}
+
+// A profile run captured in the TriggerLogger frame format replays to the same positions
+static void test_replay_roundtrip() {
+    const char* path = "trigger_sim_capture.bin";
+    FILE* f = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    TriggerSimulator::Profile p = steady(800, 3000);
+    p.type = TriggerSimulator::PROFILE_ACCEL;
+    p.rpmEnd = 6000;
+    TriggerSimulator::Result prof = sim.runProfile(v8(), p, f);
+    fclose(f);
+
+    bool ok = sim.runReplay(v8(), path);
+    remove(path);
+    TEST_ASSERT_TRUE(ok);
+    const TriggerSimulator::Result& r = sim.getResult();
+    report("replay", r);
+    TEST_ASSERT_EQUAL_UINT32(prof.teeth, r.teeth);
+    TEST_ASSERT_EQUAL_UINT32(prof.camEdges, r.camEdges);
+    TEST_ASSERT_EQUAL_UINT32(0, r.positionMismatches);
+    TEST_ASSERT_EQUAL_UINT32(0, r.syncLosses);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, r.syncUs);
+}
+
+// A capture from the car, when one is given
+static void test_replay_capture() {
+    const char* path = getenv("TRIGGER_REPLAY");
+    if (!path || !path[0]) TEST_IGNORE_MESSAGE("TRIGGER_REPLAY not set");
+    TriggerSimulator::Engine e = v8();
+    const char* wheel = getenv("TRIGGER_WHEEL");
+    if (wheel) {
+        unsigned type = e.triggerType, teeth = e.crankTeeth, missing = e.crankMissing, cam = e.camType;
+        float offset = e.camOffsetDeg;
+        sscanf(wheel, "%u,%u,%u,%u,%f", &type, &teeth, &missing, &cam, &offset);
+        e.triggerType = type;
+        e.crankTeeth = teeth;
+        e.crankMissing = missing;
+        e.camType = cam;
+        e.camOffsetDeg = offset;
+    }
+    bool ok = sim.runReplay(e, path);
+    TEST_ASSERT_TRUE_MESSAGE(ok, sim.getError());
+    const TriggerSimulator::Result& r = sim.getResult();
+    report(path, r);
+    TEST_ASSERT_EQUAL_UINT32(0, r.positionMismatches);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_steady);
+    RUN_TEST(test_accel);
+    RUN_TEST(test_cranking);
+    RUN_TEST(test_other_wheels);
+    RUN_TEST(test_vvt_readback);
+    RUN_TEST(test_map_window_mean);
+    RUN_TEST(test_noise_and_drops);
+    RUN_TEST(test_blanking_vs_off);
+    RUN_TEST(test_replay_roundtrip);
+    RUN_TEST(test_replay_capture);
+    return UNITY_END();
+}